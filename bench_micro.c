@@ -0,0 +1,449 @@
+/*******************************************************
+ * File: bench_micro.c
+ *
+ * Zestaw mikrobenchmarków gorących ścieżek:
+ *   queue_*   - PassQueue (passqueue.h), jeden wątek, bez rywalizacji
+ *   split_*   - wejście sternika: dzielenie bufora na linie i parsowanie
+ *               QUEUE (dawne strchr+strncpy+sscanf vs lineparse.h)
+ *   buy_*     - wejście kasjera: linie BUY z jednego odczytu (dawne
+ *               kopiowanie do line[512] + sscanf vs parse_buy_line)
+ *   kasa_*    - decyzja kasjera dla BUY (kasa.h), z parsowaniem i bez
+ *   fifo_*    - pełna wymiana BUY -> OK przez FIFO z procesem-kasą
+ *
+ * Każdy przypadek: przebieg rozgrzewkowy, potem R powtórzeń po N operacji.
+ * Wynik: mediana i minimum ns/op oraz ops/s (z mediany). Wyniki trafiają
+ * też do pliku JSON (do porównań między wersjami).
+ *
+ * Użycie: ./bench_micro [wynik.json] [skala]   (domyślnie bench.json, 1)
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "passqueue.h"
+#include "lineparse.h"
+#include "kasa.h"
+
+#define REPS   7
+#define MAX_RESULTS 32
+
+typedef struct {
+    const char *name;
+    long   iters;
+    double ns_med, ns_min, ops_s;
+} Result;
+
+static Result results[MAX_RESULTS];
+static int    nresults;
+
+/* Ujście dla wyników, żeby kompilator nie wyrzucił mierzonego kodu */
+static volatile long sink;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+static int cmp_d(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* fn wykonuje 'iters' operacji; zwraca liczbę faktycznie wykonanych */
+typedef long (*BenchFn)(long iters);
+
+static void bench(const char *name, BenchFn fn, long iters)
+{
+    double ns[REPS];
+    fn(iters / 10 > 0 ? iters / 10 : 1);   // rozgrzewka (cache, strony, predyktory)
+    long done = iters;
+    for(int r=0; r<REPS; r++){
+        long long t0 = now_ns();
+        done = fn(iters);
+        long long t1 = now_ns();
+        ns[r] = (double)(t1 - t0) / (done > 0 ? done : 1);
+    }
+    qsort(ns, REPS, sizeof(double), cmp_d);
+
+    Result *res = &results[nresults++];
+    res->name   = name;
+    res->iters  = done;
+    res->ns_med = ns[REPS/2];
+    res->ns_min = ns[0];
+    res->ops_s  = ns[REPS/2] > 0 ? 1e9 / ns[REPS/2] : 0;
+    printf("%-24s %10ld %12.1f %12.1f %14.0f\n",
+           name, done, res->ns_med, res->ns_min, res->ops_s);
+}
+
+/* ---------- PassQueue ---------- */
+static PassQueue q;
+
+/* enqueue + dequeue jednego pasażera (kolejka prawie pusta) */
+static long b_queue_pair(long iters)
+{
+    PassengerItem p, out;
+    memset(&p, 0, sizeof(p));
+    strcpy(p.pass_fifo, "fifo_pasazer_1234");
+    initQueue(&q);
+    for(long i=0; i<iters; i++){
+        p.pid = (int)i;
+        enqueue(&q, &p);
+        dequeue(&q, &out);
+        sink += out.pid;
+    }
+    return iters;
+}
+
+/* napełnienie do QSIZE i opróżnienie (skip przed zwykłą - dequeue_prio) */
+static long b_queue_fill(long iters)
+{
+    static PassQueue qs;
+    PassengerItem p, out;
+    memset(&p, 0, sizeof(p));
+    strcpy(p.pass_fifo, "fifo_pasazer_1234");
+    initQueue(&q);
+    initQueue(&qs);
+    long done = 0;
+    while(done < iters){
+        for(int i=0; i<QSIZE; i++){
+            p.pid = i;
+            enqueue((i & 7) ? &q : &qs, &p);
+        }
+        while(dequeue_prio(&qs, &q, &out)==0) sink += out.pid;
+        done += QSIZE;
+    }
+    return done;
+}
+
+/* ---------- wejście sternika ---------- */
+#define SPLIT_LINES 512
+static char   split_buf[SPLIT_LINES * 64];
+static size_t split_len;
+
+static void split_prepare(void)
+{
+    split_len = 0;
+    for(int i=0; i<SPLIT_LINES; i++){
+        split_len += sprintf(split_buf + split_len, "%s %d %d %d fifo_pasazer_%d\n",
+                             (i % 5) ? "QUEUE" : "QUEUE_SKIP",
+                             1000 + i, 1 + (i & 1), (i % 5) ? 0 : 50, 1000 + i);
+    }
+}
+
+/* Dawne wejście (do 026): strchr po '\0'-zakończonym buforze, kopia linii, sscanf */
+static long b_split_sscanf(long iters)
+{
+    static char work[sizeof(split_buf) + 1];
+    long done = 0;
+    while(done < iters){
+        memcpy(work, split_buf, split_len);
+        work[split_len] = '\0';
+        char *start = work, *nl;
+        while((nl = strchr(start, '\n')) != NULL){
+            *nl = '\0';
+            char line[256];
+            strncpy(line, start, sizeof(line));
+            line[sizeof(line)-1] = '\0';
+            start = nl + 1;
+
+            int pid=0, bno=0, disc=0;
+            char p_fifo[128];
+            int c;
+            if(!strncmp(line, "QUEUE_SKIP", 10)){
+                c = sscanf(line, "QUEUE_SKIP %d %d %d %s", &pid, &bno, &disc, p_fifo);
+            } else {
+                c = sscanf(line, "QUEUE %d %d %d %s", &pid, &bno, &disc, p_fifo);
+            }
+            if(c==4) sink += pid + bno;
+            done++;
+        }
+    }
+    return done;
+}
+
+/* Obecne wejście: memchr w buforze + parse_queue_line w miejscu.
+   Kopia bufora zostaje, żeby oba warianty robiły tę samą pracę wokół. */
+static long b_split_inplace(long iters)
+{
+    static char work[sizeof(split_buf)];
+    QueueRec r;
+    long done = 0;
+    while(done < iters){
+        memcpy(work, split_buf, split_len);
+        const char *p = work, *end = work + split_len, *nl;
+        while((nl = memchr(p, '\n', end - p)) != NULL){
+            if(parse_queue_line(p, nl, &r) > 0) sink += r.pid + r.bno + r.fifo_len;
+            p = nl + 1;
+            done++;
+        }
+    }
+    return done;
+}
+
+/* ---------- wejście kasjera ---------- */
+static char   buy_buf[SPLIT_LINES * 64];
+static size_t buy_len;
+
+static void buy_prepare(void)
+{
+    buy_len = 0;
+    for(int i=0; i<SPLIT_LINES; i++){
+        buy_len += sprintf(buy_buf + buy_len, "BUY %d %d %d fifo_pasazer_%d\n",
+                           1000 + i, 1 + (i * 7) % 80, (i % 9) ? 0 : 30000 + i, 1000 + i);
+    }
+}
+
+/* Dawna pętla kasjera: memchr, kopia linii do line[512], sscanf */
+static long b_buy_sscanf(long iters)
+{
+    long done = 0;
+    while(done < iters){
+        const char *p = buy_buf, *end = buy_buf + buy_len, *nl;
+        while((nl = memchr(p, '\n', end - p)) != NULL){
+            char line[512];
+            int line_len = (int)(nl - p);
+            if(line_len >= (int)sizeof(line)) line_len = (int)sizeof(line) - 1;
+            memcpy(line, p, line_len);
+            line[line_len] = '\0';
+            int pid, age, group;
+            char fifo[128];
+            if(sscanf(line, "BUY %d %d %d %s", &pid, &age, &group, fifo) >= 3) sink += pid + age;
+            p = nl + 1;
+            done++;
+        }
+    }
+    return done;
+}
+
+/* Obecna pętla kasjera: parse_buy_line w buforze odczytu */
+static long b_buy_inplace(long iters)
+{
+    BuyRec r;
+    long done = 0;
+    while(done < iters){
+        const char *p = buy_buf, *end = buy_buf + buy_len, *nl;
+        while((nl = memchr(p, '\n', end - p)) != NULL){
+            if(parse_buy_line(p, nl, &r) > 0) sink += r.pid + r.age + r.fifo_len;
+            p = nl + 1;
+            done++;
+        }
+    }
+    return done;
+}
+
+/* ---------- decyzja kasjera ---------- */
+static Kasa kasa;
+
+/* sama decyzja + zapamiętanie; pid-y się powtarzają -> mieszanka
+   pierwszych i kolejnych rejsów, wiek i grupy jak w generatorze */
+static long b_kasa_decide(long iters)
+{
+    kasa_init(&kasa);
+    kasa.credit[1] = kasa.credit[2] = 1000000;
+    for(long i=0; i<iters; i++){
+        int pid   = (int)(i % 3000) + 1000;
+        int age   = (int)((i * 7) % 80) + 1;
+        int group = (i % 9 == 0) ? (int)(i % 100) + 1 : 0;
+        Sale s = kasa_decide(&kasa, pid, age, group);
+        kasa_commit(&kasa, pid, &s);
+        sink += s.boat + s.disc;
+    }
+    kasa_free(&kasa);
+    return iters;
+}
+
+/* jak w kasjerze: sscanf linii BUY + decyzja + sformatowanie odpowiedzi */
+static long b_kasa_line(long iters)
+{
+    char line[128], resp[256], fifo[128];
+    kasa_init(&kasa);
+    kasa.credit[1] = kasa.credit[2] = 1000000;
+    for(long i=0; i<iters; i++){
+        int pid0 = (int)(i % 3000) + 1000;
+        snprintf(line, sizeof(line), "BUY %d %d %d fifo_pasazer_%d", pid0, (int)(i % 80) + 1, 0, pid0);
+        int pid, age, group;
+        if(sscanf(line, "BUY %d %d %d %s", &pid, &age, &group, fifo) < 3) continue;
+        Sale s = kasa_decide(&kasa, pid, age, group);
+        kasa_commit(&kasa, pid, &s);
+        snprintf(resp, sizeof(resp), "OK %d BOAT=%d DISC=%d SKIP=%d GROUP=%d\n",
+                 pid, s.boat, s.disc, s.skip, group);
+        sink += resp[3];
+    }
+    kasa_free(&kasa);
+    return iters;
+}
+
+/* to samo z parse_buy_line zamiast sscanf */
+static long b_kasa_line_inplace(long iters)
+{
+    char line[128], resp[256];
+    BuyRec br;
+    kasa_init(&kasa);
+    kasa.credit[1] = kasa.credit[2] = 1000000;
+    for(long i=0; i<iters; i++){
+        int pid0 = (int)(i % 3000) + 1000;
+        int m = snprintf(line, sizeof(line), "BUY %d %d %d fifo_pasazer_%d", pid0, (int)(i % 80) + 1, 0, pid0);
+        if(parse_buy_line(line, line + m, &br) <= 0) continue;
+        Sale s = kasa_decide(&kasa, br.pid, br.age, br.group);
+        kasa_commit(&kasa, br.pid, &s);
+        snprintf(resp, sizeof(resp), "OK %d BOAT=%d DISC=%d SKIP=%d GROUP=%d\n",
+                 br.pid, s.boat, s.disc, s.skip, br.group);
+        sink += resp[3];
+    }
+    kasa_free(&kasa);
+    return iters;
+}
+
+/* ---------- FIFO: BUY -> OK ---------- */
+#define FIFO_REQ  "fifo_bench_kasjer_in"
+#define FIFO_RESP "fifo_bench_pasazer"
+
+static int   fd_req = -1, fd_resp = -1;
+static pid_t responder;
+
+/* Proces-kasa: jak kasjer - czyta BUY, decyduje, otwiera FIFO pasażera
+   do zapisu na czas jednej odpowiedzi */
+static void responder_loop(void)
+{
+    int fd = open(FIFO_REQ, O_RDONLY);
+    if(fd<0) _exit(1);
+    Kasa k;
+    kasa_init(&k);
+    char buf[4096];
+    size_t len = 0;
+    for(;;){
+        ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+        if(n<=0) break;
+        len += n;
+        char *p = buf, *end = buf + len, *nl;
+        while((nl = memchr(p, '\n', end - p)) != NULL){
+            *nl = '\0';
+            int pid, age, group;
+            char fifo[128], resp[128];
+            if(sscanf(p, "BUY %d %d %d %127s", &pid, &age, &group, fifo)==4){
+                Sale s = kasa_decide(&k, pid, age, group);
+                kasa_commit(&k, pid, &s);
+                int fo = open(fifo, O_WRONLY);
+                if(fo>=0){
+                    int m = snprintf(resp, sizeof(resp), "OK %d BOAT=%d DISC=%d SKIP=%d GROUP=%d\n",
+                                     pid, s.boat, s.disc, s.skip, group);
+                    write(fo, resp, m);
+                    close(fo);
+                }
+            }
+            p = nl + 1;
+        }
+        len = end - p;
+        memmove(buf, p, len);
+    }
+    _exit(0);
+}
+
+static int fifo_setup(void)
+{
+    unlink(FIFO_REQ);
+    unlink(FIFO_RESP);
+    if(mkfifo(FIFO_REQ, 0666)<0 || mkfifo(FIFO_RESP, 0666)<0){
+        perror("mkfifo");
+        return -1;
+    }
+    responder = fork();
+    if(responder<0) return -1;
+    if(responder==0) responder_loop();
+
+    fd_req = open(FIFO_REQ, O_WRONLY);
+    /* O_RDWR - odpowiedzi nie giną między zamknięciem a otwarciem
+       przez kasę, a read() nie dostaje EOF */
+    fd_resp = open(FIFO_RESP, O_RDWR);
+    return (fd_req<0 || fd_resp<0) ? -1 : 0;
+}
+
+static void fifo_teardown(void)
+{
+    if(fd_req>=0) close(fd_req);   // kasa dostaje EOF i kończy
+    if(fd_resp>=0) close(fd_resp);
+    if(responder>0) waitpid(responder, NULL, 0);
+    unlink(FIFO_REQ);
+    unlink(FIFO_RESP);
+}
+
+static long b_fifo_roundtrip(long iters)
+{
+    char msg[128], resp[256];
+    for(long i=0; i<iters; i++){
+        int pid = (int)(i % 3000) + 1000;
+        int m = snprintf(msg, sizeof(msg), "BUY %d %d 0 " FIFO_RESP "\n", pid, 30);
+        if(write(fd_req, msg, m)!=m) return i;
+        ssize_t n = read(fd_resp, resp, sizeof(resp));
+        if(n<=0) return i;
+        sink += resp[0];
+    }
+    return iters;
+}
+
+/* ---------- wyniki ---------- */
+static int write_json(const char *path, double scale)
+{
+    FILE *f = fopen(path, "w");
+    if(!f){
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "{\n  \"timestamp\": %ld,\n  \"reps\": %d,\n  \"scale\": %g,\n  \"benchmarks\": [\n",
+            (long)time(NULL), REPS, scale);
+    for(int i=0; i<nresults; i++){
+        Result *r = &results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"iters\": %ld, \"ns_per_op_median\": %.2f, "
+                   "\"ns_per_op_min\": %.2f, \"ops_per_sec\": %.0f}%s\n",
+                r->name, r->iters, r->ns_med, r->ns_min, r->ops_s,
+                i+1<nresults ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *out = (argc>1) ? argv[1] : "bench.json";
+    double scale = (argc>2) ? atof(argv[2]) : 1.0;
+    if(scale<=0) scale = 1.0;
+    #define N(x) ((long)((x) * scale) > 0 ? (long)((x) * scale) : 1)
+
+    signal(SIGPIPE, SIG_IGN);
+    srand(1);
+    split_prepare();
+    buy_prepare();
+
+    printf("%-24s %10s %12s %12s %14s\n", "benchmark", "ops", "ns/op med", "ns/op min", "ops/s");
+    bench("queue_enq_deq",     b_queue_pair,    N(2000000));
+    bench("queue_fill_drain",  b_queue_fill,    N(2000000));
+    bench("split_sscanf",      b_split_sscanf,  N(200000));
+    bench("split_inplace",     b_split_inplace, N(200000));
+    bench("buy_sscanf",        b_buy_sscanf,    N(200000));
+    bench("buy_inplace",       b_buy_inplace,   N(200000));
+    bench("kasa_decide",       b_kasa_decide,   N(2000000));
+    bench("kasa_line_sscanf",  b_kasa_line,     N(200000));
+    bench("kasa_line_inplace", b_kasa_line_inplace, N(200000));
+
+    if(fifo_setup()==0){
+        bench("fifo_buy_roundtrip", b_fifo_roundtrip, N(5000));
+    } else {
+        fprintf(stderr, "fifo_buy_roundtrip: pominięty\n");
+    }
+    fifo_teardown();
+
+    if(write_json(out, scale)<0) return 1;
+    printf("Wyniki: %s\n", out);
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*******************************************************
+ * File: bench_queue.c
+ *
+ * Mikrobenchmark kolejek pasażerów:
+ *   mutex    - dawna kolejka sternika (pierścień + jeden pthread_mutex)
+ *   lockfree - pierścień MPMC z passqueue.h
+ * dla różnych liczb producentów/konsumentów. Wynik w ops/s
+ * (jedna operacja = enqueue + dequeue jednego pasażera).
+ *
+ * Użycie: ./bench_queue [ops_na_konfiguracje]
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "passqueue.h"
+
+/* ---------- dawna kolejka pod mutexem (punkt odniesienia) ---------- */
+typedef struct {
+    PassengerItem items[QSIZE];
+    int front, rear, count;
+    pthread_mutex_t mutex;
+} MutexQueue;
+
+static int mq_enqueue(MutexQueue *q, const PassengerItem *p)
+{
+    pthread_mutex_lock(&q->mutex);
+    if(q->count==QSIZE){
+        pthread_mutex_unlock(&q->mutex);
+        return -1;
+    }
+    q->items[q->rear] = *p;
+    q->rear = (q->rear + 1) % QSIZE;
+    q->count++;
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+static int mq_dequeue(MutexQueue *q, PassengerItem *out)
+{
+    pthread_mutex_lock(&q->mutex);
+    if(q->count==0){
+        pthread_mutex_unlock(&q->mutex);
+        return -1;
+    }
+    *out = q->items[q->front];
+    q->front = (q->front + 1) % QSIZE;
+    q->count--;
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+/* ---------- wspólny szkielet pomiaru ---------- */
+static MutexQueue mq;
+static PassQueue  lq;
+static int use_lockfree;
+static long ops_per_producer;
+static _Atomic long consumed;
+static long total_ops;
+
+static void *producer(void *arg)
+{
+    PassengerItem p;
+    memset(&p, 0, sizeof(p));
+    p.pid = (int)(long)arg;
+    strcpy(p.pass_fifo, "fifo_pasazer_bench");
+    for(long i=0; i<ops_per_producer; i++){
+        p.disc = (int)i;
+        if(use_lockfree){
+            while(enqueue(&lq, &p)<0) sched_yield();
+        } else {
+            while(mq_enqueue(&mq, &p)<0) sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    PassengerItem p;
+    (void)arg;
+    while(atomic_load(&consumed) < total_ops){
+        int r = use_lockfree ? dequeue(&lq, &p) : mq_dequeue(&mq, &p);
+        if(r==0) atomic_fetch_add(&consumed, 1);
+        else sched_yield();
+    }
+    return NULL;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static double run(int lockfree, int nprod, int ncons, long ops)
+{
+    pthread_t th[64];
+    use_lockfree = lockfree;
+    ops_per_producer = ops / nprod;
+    total_ops = ops_per_producer * nprod;
+    atomic_store(&consumed, 0);
+
+    memset(&mq, 0, sizeof(mq));
+    pthread_mutex_init(&mq.mutex, NULL);
+    initQueue(&lq);
+
+    double t0 = now_s();
+    for(int i=0; i<ncons; i++) pthread_create(&th[i], NULL, consumer, NULL);
+    for(int i=0; i<nprod; i++) pthread_create(&th[ncons+i], NULL, producer, (void*)(long)i);
+    for(int i=0; i<ncons+nprod; i++) pthread_join(th[i], NULL);
+    double t1 = now_s();
+
+    pthread_mutex_destroy(&mq.mutex);
+    return total_ops / (t1 - t0);
+}
+
+int main(int argc, char *argv[])
+{
+    long ops = (argc>1) ? atol(argv[1]) : 2000000;
+    static const int cfg[][2] = {
+        {1,1}, {2,1}, {4,1}, {8,1},   // MPSC: wiele wejść, jedna łódź
+        {2,2}, {4,4}, {8,8}           // MPMC
+    };
+
+    printf("%-5s %-5s %15s %15s %8s\n", "prod", "cons", "mutex ops/s", "lockfree ops/s", "x");
+    for(size_t i=0; i<sizeof(cfg)/sizeof(cfg[0]); i++){
+        int np = cfg[i][0], nc = cfg[i][1];
+        double m = run(0, np, nc, ops);
+        double l = run(1, np, nc, ops);
+        printf("%-5d %-5d %15.0f %15.0f %8.2f\n", np, nc, m, l, l/m);
+    }
+    return 0;
+}
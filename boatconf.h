@@ -0,0 +1,163 @@
+/*******************************************************
+ * File: boatconf.h
+ *
+ * Parametry łodzi sternika ustawiane w trakcie pracy (dotąd #define):
+ *   N1, T1 - pojemność i czas rejsu łodzi 1 (i nieparzystych z floty)
+ *   N2, T2 - to samo dla łodzi 2 (i parzystych)
+ *   K      - pojemność pomostu (K < N1, K < N2, K <= K_MAX)
+ *   LOAD_TIMEOUT - max czas okna załadunku w s (0 = bez limitu)
+ *   ADAPTIVE - 1: okno załadunku wg tempa przybyć (depart.h), 0: stałe
+ * Źródła: plik przy starcie (STERNIK_CONFIG, domyślnie sternik.conf;
+ * brak pliku = wartości domyślne) i komenda "CONFIG KLUCZ=wart ..."
+ * na fifo_sternik_in. Format pliku: te same pary KLUCZ=wart, dowolnie
+ * w liniach, '#' zaczyna komentarz.
+ * Zmiana jest albo przyjęta w całości, albo odrzucona (walidacja całego
+ * zestawu), a łodzie biorą nowe wartości na początku okna załadunku.
+ ******************************************************/
+
+#ifndef BOATCONF_H
+#define BOATCONF_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#define BOATCONF_ENV  "STERNIK_CONFIG"
+#define BOATCONF_FILE "sternik.conf"
+
+/* Górne limity (rozmiary tablic w sternik.c) */
+#define N_MAX  64
+#define K_MAX  32
+#define T_MAX  3600
+
+/* Stałe poza konfiguracją: czas przejścia jednej osoby po pomoście
+   i limit przyjęć - ilu pasażerów (normal+skip) może czekać na jedną
+   łódź; powyżej sternik odsyła REJECTED, a kasjer dostaje CREDIT=0 */
+#define WALK_MS     100
+#define QUEUE_LIMIT 200
+
+typedef struct {
+    int n1, t1;
+    int n2, t2;
+    int k;
+    int load_timeout;
+    int adaptive;
+} BoatConf;
+
+#define BOATCONF_DEFAULT { .n1 = 10, .t1 = 4, .n2 = 11, .t2 = 5, .k = 8, .load_timeout = 2, \
+                          .adaptive = 0 }
+
+/* Pole konfiguracji o danej nazwie albo NULL */
+static int *boatconf_field(BoatConf *c, const char *key, size_t len)
+{
+    static const struct { const char *name; size_t off; } keys[] = {
+        { "N1", offsetof(BoatConf, n1) }, { "T1", offsetof(BoatConf, t1) },
+        { "N2", offsetof(BoatConf, n2) }, { "T2", offsetof(BoatConf, t2) },
+        { "K",  offsetof(BoatConf, k)  },
+        { "LOAD_TIMEOUT", offsetof(BoatConf, load_timeout) },
+        { "ADAPTIVE", offsetof(BoatConf, adaptive) },
+    };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strlen(keys[i].name) == len && !memcmp(keys[i].name, key, len)) {
+            return (int *)((char *)c + keys[i].off);
+        }
+    }
+    return NULL;
+}
+
+/* Spójność całego zestawu; NULL gdy w porządku, inaczej opis błędu */
+static const char *boatconf_check(const BoatConf *c)
+{
+    if (c->n1 < 1 || c->n1 > N_MAX || c->n2 < 1 || c->n2 > N_MAX) return "N1/N2 poza 1..N_MAX";
+    if (c->t1 < 0 || c->t1 > T_MAX || c->t2 < 0 || c->t2 > T_MAX) return "T1/T2 poza 0..T_MAX";
+    if (c->k < 1 || c->k > K_MAX) return "K poza 1..K_MAX";
+    if (c->k >= c->n1 || c->k >= c->n2) return "wymagane K < N1 i K < N2";
+    if (c->load_timeout < 0 || c->load_timeout > T_MAX) return "LOAD_TIMEOUT poza 0..T_MAX";
+    if (c->adaptive != 0 && c->adaptive != 1) return "ADAPTIVE musi być 0 albo 1";
+    return NULL;
+}
+
+/* Pary KLUCZ=wart z [p, end) wpisywane do *c, bez walidacji całości.
+   Zwraca liczbę par albo -1 (opis w err). */
+static int boatconf_parse(BoatConf *c, const char *p, const char *end, char *err, size_t errsz)
+{
+    int n = 0;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+        if (p == end || *p == '#') break;
+        const char *key = p;
+        while (p < end && *p != '=' && *p != ' ' && *p != '\t') p++;
+        int klen = (int)(p - key);
+        int *f = boatconf_field(c, key, klen);
+        if (!f || p == end || *p != '=') {
+            snprintf(err, errsz, "nieznany klucz albo brak '=': %.*s", klen, key);
+            return -1;
+        }
+        p++;
+        int neg = (p < end && *p == '-'), v = 0, digits = 0;
+        if (neg) p++;
+        while (p < end && *p >= '0' && *p <= '9' && v < 1000000) {
+            v = v * 10 + (*p++ - '0');
+            digits++;
+        }
+        if (!digits || (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')) {
+            snprintf(err, errsz, "zła wartość dla %.*s", klen, key);
+            return -1;
+        }
+        *f = neg ? -v : v;
+        n++;
+    }
+    return n;
+}
+
+/* Jak boatconf_parse, ale *c zmienia się tylko, gdy cały wynik przejdzie
+   walidację (komenda CONFIG) */
+static int boatconf_apply(BoatConf *c, const char *p, const char *end, char *err, size_t errsz)
+{
+    BoatConf nc = *c;
+    int n = boatconf_parse(&nc, p, end, err, errsz);
+    if (n < 0) return -1;
+    const char *why = boatconf_check(&nc);
+    if (why) {
+        snprintf(err, errsz, "%s", why);
+        return -1;
+    }
+    *c = nc;
+    return n;
+}
+
+/* Wczytuje plik konfiguracji (walidacja po całym pliku - kolejność kluczy
+   dowolna). 0 - wczytany, 1 - brak pliku, -1 - błąd (opis w err);
+   *c zmienia się tylko przy 0. */
+static int boatconf_load(BoatConf *c, const char *path, char *err, size_t errsz)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return 1;
+    BoatConf nc = *c;
+    char line[256], e[128];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if (boatconf_parse(&nc, line, line + strlen(line), e, sizeof(e)) < 0) {
+            snprintf(err, errsz, "%s:%d: %s", path, lineno, e);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    const char *why = boatconf_check(&nc);
+    if (why) {
+        snprintf(err, errsz, "%s: %s", path, why);
+        return -1;
+    }
+    *c = nc;
+    return 0;
+}
+
+static int boatconf_format(const BoatConf *c, char *out, size_t sz)
+{
+    return snprintf(out, sz, "N1=%d T1=%d N2=%d T2=%d K=%d LOAD_TIMEOUT=%d ADAPTIVE=%d",
+                    c->n1, c->t1, c->n2, c->t2, c->k, c->load_timeout, c->adaptive);
+}
+
+#endif
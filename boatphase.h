@@ -0,0 +1,85 @@
+/*******************************************************
+ * File: boatphase.h
+ *
+ * Decyzje maszyny faz łodzi (IDLE -> LOADING -> SAILING -> UNLOADING)
+ * wspólne dla boat_step() sternika i symulacji plannera - model ma
+ * decydować dokładnie tak jak łódź, więc obie strony liczą to samo tutaj.
+ * Sam rachunek: bez blokad, kolejek i wiadomości do pasażerów (to zostaje
+ * u wołającego), czas w ms dowolnego zegara monotonicznego.
+ *   phase_admit      - czy kolejny wpis (osoba albo grupa) wejdzie na pomost
+ *   phase_load_until - koniec okna załadunku (LOAD_TIMEOUT / ADAPTIVE)
+ *   phase_load_open  - czy okno załadunku jeszcze trwa
+ *   phase_may_sail   - czy rejs z wyładunkiem zdąży przed końcem dnia
+ *   phase_presel     - czy na morzu wybierać dalej na następny rejs
+ ******************************************************/
+
+#ifndef BOATPHASE_H
+#define BOATPHASE_H
+
+#include "depart.h"
+
+#define PHASE_NEVER (1LL << 62)   // brak terminu
+
+/* Stan łodzi w boat_step */
+typedef enum {B_IDLE, B_LOADING, B_SAILING, B_UNLOADING, B_DONE} BoatPhase;
+
+/* Wynik phase_admit */
+enum { ADMIT_OK, ADMIT_FULL, ADMIT_NEVER };
+
+/* Wpis o size osobach przy taken miejscach zajętych (pokład + pomost).
+   Grupa wchodzi w całości albo wcale: ADMIT_FULL - łódź jest pełna, wpis
+   czeka pierwszy na następny rejs (nikt go nie wyprzedza); ADMIT_NEVER -
+   większy niż łódź, odrzucenie. */
+static int phase_admit(int taken, int size, int cap)
+{
+    if(size > cap) return ADMIT_NEVER;
+    if(taken + size > cap) return ADMIT_FULL;
+    return ADMIT_OK;
+}
+
+/* Do kiedy trwa okno załadunku. load_end - limit LOAD_TIMEOUT
+   (PHASE_NEVER - bez limitu); idle - nikt nie idzie po pomoście i nikt
+   nie czeka, wtedy przy ADAPTIVE decyduje kontroler z depart.h;
+   left_ms - ile zostało do końca dnia (PHASE_NEVER - bez końca dnia),
+   ostatni rejs może czekać cały zapas. *timed_out = 1 - okno się skończyło. */
+static long long phase_load_until(const DepartCtl *d, long long now, long long load_end,
+                                  int adaptive, int idle, int seats, int cap,
+                                  int trip_time, int k, long long left_ms, int *timed_out)
+{
+    long long until = load_end;
+    *timed_out = now >= load_end;
+    if(adaptive && !*timed_out && idle){
+        /* zapas liczony dla pełnej łodzi - czekanie nie może
+           zepsuć oceny "zdąży" przy wypłynięciu */
+        long long trip  = depart_trip_ms(trip_time, cap, k);
+        long long slack = left_ms - trip;
+        if(slack < 0 || slack >= trip) slack = -1;   // nie ostatni rejs
+        long long dl = depart_deadline(d, now, seats, cap, slack);
+        if(dl < until) until = dl;
+        if(until <= now) *timed_out = 1;
+    }
+    return until;
+}
+
+/* Okno trwa, dopóki ktoś idzie po pomoście albo łódź nie jest pełna
+   (full - pierwszy w kolejności się nie zmieścił) i okno nie minęło */
+static int phase_load_open(int walking, int full, int seats, int cap, int timed_out)
+{
+    return walking > 0 || (!full && seats < cap && !timed_out);
+}
+
+/* Rejs z n wpisami (wyładunek K-szeroki) zdąży przed końcem dnia
+   (left_ms jak wyżej) */
+static int phase_may_sail(int trip_time, int n, int k, long long left_ms)
+{
+    return depart_trip_ms(trip_time, n, k) <= left_ms;
+}
+
+/* Wybór na morzu: nentries wybranych wpisów zajmujących seats miejsc -
+   bierzemy dalej, dopóki następny rejs nie jest pełny */
+static int phase_presel(int nentries, int seats, int cap)
+{
+    return nentries < cap && seats < cap;
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*******************************************************
+ * File: checkpoint.h
+ *
+ * Plik stanu sternika (mmap, MAP_SHARED) z okresowymi snapshotami
+ * kolejek łodzi i liczników. Dwa sloty: snapshot zapisujemy zawsze do
+ * slotu nieaktualnego, a dopiero gotowy "publikujemy" zmieniając
+ * 'current'. Plik zawsze wskazuje więc na pełny, spójny snapshot -
+ * także gdy sternik zginie w trakcie zapisu.
+ *
+ * Strony pliku przeżywają śmierć procesu (page cache), więc nowy sternik
+ * podpina się w milisekundach: mmap + przejrzenie ostatniego slotu.
+ *
+ * Układ pliku:
+ *   CkptFile | slot0 | slot1
+ *   slot = CkptSlot | CkptBoat[max_boats] | CkptItem[max_boats*max_items]
+ ******************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "passqueue.h"
+
+#define CKPT_MAGIC   0x54504b43u   // "CKPT"
+#define CKPT_VERSION 3             // 2: PassengerItem z grupą (size, member[]), 3: bez CK_REJ_GROUP
+#define CKPT_NONE    2             // current: brak snapshotu
+#define CKPT_HDR_SIZE 4096         // nagłówek pliku na osobnej stronie
+
+/* Rodzaj wpisu - co zrobić z pasażerem po wznowieniu */
+enum {
+    CK_QUEUE,       // czeka w kolejce normalnej
+    CK_SKIP,        // czeka w kolejce skip
+    CK_NEXT,        // wybrany do wejścia (na pomoście / na pokładzie przed wypłynięciem)
+    CK_UNLOADED,    // rejs się odbył - należy mu się UNLOADED
+    CK_REJ_NOTIME   // schodził, bo zabrakło czasu na rejs
+};
+
+typedef struct {
+    int kind;
+    PassengerItem p;
+} CkptItem;
+
+/* Liczniki i wpisy jednej łodzi (items[first .. first+count-1]) */
+typedef struct {
+    int id, active;
+    int trips, carried;
+    int first, count;
+} CkptBoat;
+
+typedef struct {
+    uint64_t seq;        // numer snapshotu
+    int64_t  end_time;   // koniec symulacji (time_t) - wznowiony sternik go przejmuje
+    uint32_t nboats, nitems;
+} CkptSlot;
+
+typedef struct {
+    uint32_t magic, version;
+    _Atomic uint32_t current;   // 0/1 - ostatni pełny snapshot, CKPT_NONE - brak
+    uint32_t clean;             // 1 -> sternik skończył normalnie, nie wznawiamy
+    uint32_t max_boats, max_items;
+    uint64_t slot_size;
+} CkptFile;
+
+typedef struct {
+    int fd;
+    CkptFile *hdr;
+    size_t map_size;
+} Checkpoint;
+
+static size_t ckpt_slot_size(int max_boats, int max_items)
+{
+    size_t sz = sizeof(CkptSlot) + (size_t)max_boats*sizeof(CkptBoat)
+              + (size_t)max_boats*max_items*sizeof(CkptItem);
+    return (sz + 4095) & ~(size_t)4095;
+}
+
+static CkptSlot *ckpt_slot(Checkpoint *c, int i)
+{
+    return (CkptSlot*)((char*)c->hdr + CKPT_HDR_SIZE + (size_t)i*c->hdr->slot_size);
+}
+
+static CkptBoat *ckpt_boats(CkptSlot *s)
+{
+    return (CkptBoat*)(s + 1);
+}
+
+static CkptItem *ckpt_items(Checkpoint *c, CkptSlot *s)
+{
+    return (CkptItem*)(ckpt_boats(s) + c->hdr->max_boats);
+}
+
+/* Otwiera (albo zakłada) plik stanu. Plik o innych wymiarach jest
+   zakładany od nowa. 0 - ok, -1 - błąd. */
+static int ckpt_open(Checkpoint *c, const char *path, int max_boats, int max_items)
+{
+    size_t slot = ckpt_slot_size(max_boats, max_items);
+    size_t need = CKPT_HDR_SIZE + 2*slot;
+
+    c->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(c->fd<0) return -1;
+
+    struct stat st;
+    int fresh = 1;
+    if(fstat(c->fd, &st)==0 && (size_t)st.st_size==need){
+        CkptFile h;
+        if(pread(c->fd, &h, sizeof(h), 0)==(ssize_t)sizeof(h) &&
+           h.magic==CKPT_MAGIC && h.version==CKPT_VERSION &&
+           h.max_boats==(uint32_t)max_boats && h.max_items==(uint32_t)max_items &&
+           h.slot_size==slot){
+            fresh = 0;
+        }
+    }
+    if(fresh && ftruncate(c->fd, 0)<0) goto fail;
+    if(fresh && ftruncate(c->fd, need)<0) goto fail;   // plik rzadki - strony powstają przy zapisie
+
+    c->hdr = mmap(NULL, need, PROT_READ|PROT_WRITE, MAP_SHARED, c->fd, 0);
+    if(c->hdr==MAP_FAILED) goto fail;
+    c->map_size = need;
+
+    if(fresh){
+        c->hdr->magic     = CKPT_MAGIC;
+        c->hdr->version   = CKPT_VERSION;
+        c->hdr->clean     = 1;
+        c->hdr->max_boats = max_boats;
+        c->hdr->max_items = max_items;
+        c->hdr->slot_size = slot;
+        atomic_store(&c->hdr->current, CKPT_NONE);
+    }
+    return 0;
+
+fail:
+    close(c->fd);
+    c->fd = -1;
+    return -1;
+}
+
+/* Ostatni pełny snapshot do wznowienia albo NULL (brak / poprzedni
+   sternik skończył normalnie / uszkodzone wymiary). */
+static CkptSlot *ckpt_last(Checkpoint *c)
+{
+    uint32_t cur = atomic_load_explicit(&c->hdr->current, memory_order_acquire);
+    if(c->hdr->clean || cur>1) return NULL;
+    CkptSlot *s = ckpt_slot(c, cur);
+    if(s->nboats > c->hdr->max_boats) return NULL;
+    if(s->nitems > (uint64_t)c->hdr->max_boats*c->hdr->max_items) return NULL;
+    CkptBoat *cb = ckpt_boats(s);
+    for(uint32_t i=0; i<s->nboats; i++){
+        if(cb[i].first<0 || cb[i].count<0 || (uint32_t)(cb[i].first+cb[i].count) > s->nitems) return NULL;
+    }
+    return s;
+}
+
+/* Slot do zapisu kolejnego snapshotu (nigdy ten, który jest aktualny) */
+static int ckpt_write_slot(Checkpoint *c)
+{
+    uint32_t cur = atomic_load_explicit(&c->hdr->current, memory_order_relaxed);
+    return cur==0 ? 1 : 0;
+}
+
+/* Publikacja zapisanego slotu - od teraz to on jest "ostatnim snapshotem" */
+static void ckpt_publish(Checkpoint *c, int slot)
+{
+    c->hdr->clean = 0;
+    atomic_store_explicit(&c->hdr->current, (uint32_t)slot, memory_order_release);
+    msync(c->hdr, c->map_size, MS_ASYNC);
+}
+
+/* Normalny koniec - następny start nie wznawia */
+static void ckpt_mark_clean(Checkpoint *c)
+{
+    c->hdr->clean = 1;
+    atomic_store(&c->hdr->current, CKPT_NONE);
+    msync(c->hdr, CKPT_HDR_SIZE, MS_SYNC);
+}
+
+static void ckpt_close(Checkpoint *c)
+{
+    if(c->fd<0) return;
+    munmap(c->hdr, c->map_size);
+    close(c->fd);
+    c->fd = -1;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*******************************************************
+ * File: chrome_trace.h
+ *
+ * Opcjonalny eksport zdarzeń w formacie Chrome trace-event JSON
+ * (chrome://tracing, ui.perfetto.dev). Włączany zmienną środowiskową
+ * CHROME_TRACE=<plik.json>.
+ *
+ * Wszystkie procesy dopisują do jednego pliku (O_APPEND) całe linie
+ * "{...},\n" - format tablicowy nie wymaga zamykającego ']', więc plik
+ * można otworzyć w przeglądarce śladu w dowolnej chwili. Pierwszy
+ * proces (orchestrator) zapisuje '['. Zdarzenia są buforowane
+ * i zapisywane partiami (jeden write() na kilkadziesiąt KB).
+ *
+ * Czas: CLOCK_MONOTONIC w µs - wspólny dla procesów, więc spany
+ * sternika, kasjera i orchestratora układają się na jednej osi.
+ * pid = PID procesu, tid = ścieżka (np. numer łodzi).
+ ******************************************************/
+
+#ifndef CHROME_TRACE_H
+#define CHROME_TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define CT_BUFSZ (64*1024)
+
+static int             ct_fd = -1;
+static int             ct_pid;
+static pthread_mutex_t ct_mu = PTHREAD_MUTEX_INITIALIZER;
+static char            ct_buf[CT_BUFSZ];
+static size_t          ct_len;
+
+static long long ct_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+/* pod ct_mu */
+static void ct_flush_locked(void)
+{
+    size_t off = 0;
+    while(off < ct_len){
+        ssize_t w = write(ct_fd, ct_buf + off, ct_len - off);
+        if(w<=0) break;
+        off += (size_t)w;
+    }
+    ct_len = 0;
+}
+
+static void ct_flush(void)
+{
+    if(ct_fd<0) return;
+    pthread_mutex_lock(&ct_mu);
+    ct_flush_locked();
+    pthread_mutex_unlock(&ct_mu);
+}
+
+/* Jedna linia zdarzenia (bez ",\n") do bufora */
+static void ct_emit(const char *fmt, ...) __attribute__((format(printf,1,2)));
+static void ct_emit(const char *fmt, ...)
+{
+    if(ct_fd<0) return;
+    char line[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line) - 2, fmt, ap);
+    va_end(ap);
+    if(n<0) return;
+    if(n > (int)sizeof(line) - 3) n = sizeof(line) - 3;
+    line[n++] = ',';
+    line[n++] = '\n';
+
+    pthread_mutex_lock(&ct_mu);
+    if(ct_len + n > CT_BUFSZ) ct_flush_locked();
+    memcpy(ct_buf + ct_len, line, n);
+    ct_len += n;
+    pthread_mutex_unlock(&ct_mu);
+}
+
+/* Span (zdarzenie "X"): start ts_us, czas trwania dur_us.
+   args - gotowy obiekt JSON bez nawiasów (np. "\"n\":5") albo NULL. */
+static void ct_span(const char *name, const char *cat, int tid,
+                    long long ts_us, long long dur_us, const char *args)
+{
+    if(ct_fd<0) return;
+    ct_emit("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+            "\"ts\":%lld,\"dur\":%lld,\"args\":{%s}}",
+            name, cat, ct_pid, tid, ts_us, dur_us < 0 ? 0 : dur_us, args ? args : "");
+}
+
+/* Zdarzenie chwilowe ("i") */
+static void ct_instant(const char *name, const char *cat, int tid, const char *args)
+{
+    if(ct_fd<0) return;
+    ct_emit("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,"
+            "\"ts\":%lld,\"args\":{%s}}",
+            name, cat, ct_pid, tid, ct_now_us(), args ? args : "");
+}
+
+/* Nazwa ścieżki (wątku) w przeglądarce */
+static void ct_thread_name(int tid, const char *name)
+{
+    if(ct_fd<0) return;
+    ct_emit("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s\"}}", ct_pid, tid, name);
+}
+
+/* Otwiera wspólny plik śladu, jeśli ustawiono CHROME_TRACE.
+   fresh=1 (orchestrator, start przebiegu) - plik zakładany od nowa. */
+static void ct_open(const char *process_name, int fresh)
+{
+    const char *path = getenv("CHROME_TRACE");
+    if(!path || !*path) return;
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC | (fresh ? O_TRUNC : 0), 0644);
+    if(fd<0) return;
+    struct stat st;
+    if(fstat(fd, &st)==0 && st.st_size==0) write(fd, "[\n", 2);
+
+    ct_fd  = fd;
+    ct_pid = (int)getpid();
+    ct_emit("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+            "\"args\":{\"name\":\"%s\"}}", ct_pid, process_name);
+    atexit(ct_flush);
+}
+
+#endif
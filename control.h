@@ -0,0 +1,55 @@
+/*******************************************************
+ * File: control.h
+ *
+ * Gniazdo sterujące orchestratora (UNIX, SOCK_STREAM) w katalogu
+ * symulacji. Protokół tekstowy: jedna komenda w linii, odpowiedź
+ * to jedna linia "OK ..." albo "ERR ...":
+ *   INTERVAL [ms]        przerwa bazowa między turami generatora
+ *                        (faktyczna: 1-2 x bazowa x spowolnienie)
+ *   BATCH <min> <max>    liczba pasażerów w turze partii
+ *   PAUSE | RESUME       wstrzymanie / wznowienie generowania
+ *   POLICE               uruchomienie policjanta
+ *   STATS                liczniki (klucz=wartość)
+ *   SNAPSHOT             zrzut stanu do pliku + INFO do sternika
+ *   CONFIG K=v ...       parametry łodzi, przekazywane sternikowi
+ *                        (boatconf.h; wynik w logu sternika)
+ *   QUIT                 koniec symulacji
+ *   HELP
+ ******************************************************/
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define CTL_SOCKET   "orchestrator.sock"
+#define CTL_SNAPSHOT "orchestrator.snapshot"
+
+static int ctl_addr(struct sockaddr_un *a, const char *path)
+{
+    memset(a, 0, sizeof(*a));
+    a->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(a->sun_path)) return -1;
+    strcpy(a->sun_path, path);
+    return 0;
+}
+
+/* Połączenie klienta; -1 gdy orchestrator nie słucha */
+static int ctl_connect(const char *path)
+{
+    struct sockaddr_un a;
+    if(ctl_addr(&a, path) < 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+    if(connect(fd, (struct sockaddr*)&a, sizeof(a)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
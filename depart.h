@@ -0,0 +1,105 @@
+/*******************************************************
+ * File: depart.h
+ *
+ * Adaptacyjne wypłynięcie łodzi (ADAPTIVE=1 w boatconf.h).
+ * Zamiast stałego okna LOAD_TIMEOUT łódź ocenia na bieżąco:
+ *   - tempo przybyć do swoich kolejek - EWMA w czasie (zanik exp(-dt/TAU)),
+ *   - czas cyklu C - EWMA od wypłynięcia do końca wyładunku; tyle czeka
+ *     ktoś, kto przyszedł tuż po odpłynięciu,
+ * i trzyma okno otwarte, dopóki czekanie się opłaca: n osób na pokładzie
+ * traci n*w ms, a kolejna osoba zyskuje ~C ms, więc czekamy najwyżej C/n
+ * od ostatniego wejścia i tylko gdy następne przybycie (1/tempo) zdąży.
+ * Przy dużym ruchu (tempo*C >= N) łódź zawsze się zapełnia - przepływ,
+ * przy małym odpływa od razu - czas czekania.
+ * Ostatni rejs dnia (po nim następny już się nie zmieści) może czekać
+ * cały zapas czasu - kto nie wsiądzie teraz, i tak dostanie NOTIME.
+ * LOAD_TIMEOUT > 0 pozostaje górnym limitem okna.
+ *
+ * Ocena, czy rejs zdąży przed końcem: teoretyczny czas rejsu T, wyładunek
+ * K-szerokim pomostem (ceil(n/K) x WALK_MS) i zapas DEPART_MARGIN_MS.
+ * Bez blokad - woła się pod blokadą łodzi (sternik) albo w symulacji
+ * (planner); czas w ms dowolnego zegara monotonicznego.
+ ******************************************************/
+
+#ifndef DEPART_H
+#define DEPART_H
+
+#include <math.h>
+
+#include "boatconf.h"
+
+#define DEPART_TAU_MS    10000  // stała czasowa EWMA tempa przybyć
+#define DEPART_ALPHA     0.25   // waga nowego pomiaru cyklu
+#define DEPART_MARGIN_MS 500    // zapas przy ocenie, czy rejs zdąży
+
+typedef struct {
+    double    arr;       // przybycia z zanikiem exp(-dt/TAU)
+    long long arr_t;     // chwila ostatniej aktualizacji arr
+    long long t0;        // start pomiaru (korekta na krótką historię)
+    unsigned  seen;      // licznik przybyć łodzi przy ostatnim odczycie
+    double    cycle_ms;  // EWMA cyklu: wypłynięcie -> koniec wyładunku
+    long long since;     // ostatnie wejście na pokład albo start okna
+} DepartCtl;
+
+static void depart_init(DepartCtl *d, long long now, double cycle_guess)
+{
+    d->arr      = 0;
+    d->arr_t    = now;
+    d->t0       = now;
+    d->seen     = 0;
+    d->cycle_ms = cycle_guess;
+    d->since    = now;
+}
+
+/* Nowy stan licznika przybyć łodzi (rośnie monotonicznie, może się
+   przekręcić - liczy się różnica) */
+static void depart_observe(DepartCtl *d, unsigned arrivals, long long now)
+{
+    if(now > d->arr_t){
+        d->arr *= exp(-(double)(now - d->arr_t) / DEPART_TAU_MS);
+        d->arr_t = now;
+    }
+    d->arr  += (unsigned)(arrivals - d->seen);
+    d->seen  = arrivals;
+}
+
+/* Tempo przybyć w osobach na ms */
+static double depart_rate(const DepartCtl *d, long long now)
+{
+    double a = d->arr;
+    if(now > d->arr_t) a *= exp(-(double)(now - d->arr_t) / DEPART_TAU_MS);
+    /* przez pierwsze sekundy okno EWMA jest krótsze niż TAU */
+    double span = DEPART_TAU_MS * (1.0 - exp(-(double)(now - d->t0) / DEPART_TAU_MS));
+    return span > 1.0 ? a / span : 0;
+}
+
+static void depart_cycle(DepartCtl *d, long long ms)
+{
+    if(ms <= 0) return;
+    d->cycle_ms = d->cycle_ms > 0 ? d->cycle_ms + DEPART_ALPHA * (ms - d->cycle_ms) : ms;
+}
+
+/* Ile ms potrwa rejs z n osobami (rejs T s + wyładunek + zapas) */
+static long long depart_trip_ms(int trip_time, int n, int k)
+{
+    return trip_time * 1000LL + (long long)((n + k - 1) / k) * WALK_MS + DEPART_MARGIN_MS;
+}
+
+/* Do kiedy trzymać otwarte okno załadunku, gdy nikt nie czeka w kolejce
+   ani nie idzie po pomoście. <= now - odpływamy. slack_ms >= 0 tylko
+   dla ostatniego rejsu dnia: zapas czasu ponad ten rejs. */
+static long long depart_deadline(const DepartCtl *d, long long now, int onboard, int cap,
+                                 long long slack_ms)
+{
+    if(onboard <= 0 || onboard >= cap) return now;
+    double lam = depart_rate(d, now);
+    if(lam <= 0) return now;
+    double wmax = d->cycle_ms / onboard;
+    if(slack_ms >= 0 && slack_ms > wmax) wmax = slack_ms;
+    if(1.0 / lam > wmax) return now;      // następny raczej nie zdąży
+    long long until = d->since + (long long)wmax;
+    if(slack_ms >= 0 && until > now + slack_ms) until = now + slack_ms;
+    return until;
+}
+
+#endif
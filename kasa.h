@@ -0,0 +1,300 @@
+/*******************************************************
+ * File: kasa.h
+ *
+ * Logika sprzedaży biletu kasjera - bez wejścia/wyjścia, żeby dało się
+ * ją mierzyć i sprawdzać poza procesem kasjera (mikrobenchmarki).
+ *   kasa_decide - wybór łodzi, zniżki i skip dla BUY (nic nie zmienia)
+ *   kasa_commit - zapamiętuje sprzedaż (traveled, kredyt); kasjer woła ją
+ *                 od razu po decyzji - rezerwacja na czas doręczania odpowiedzi
+ *   kasa_release - cofa rezerwację, gdy odpowiedź nie dotarła
+ *   kasa_decide_group / kasa_commit_group / kasa_release_group - to samo
+ *                 dla biletu grupowego
+ * Kredyt: ile jeszcze pasażerów przyjmie kolejka każdej łodzi floty wg
+ * sternika. Łodzie nieparzyste są jak łódź 1, parzyste jak łódź 2 -
+ * kasa wybiera rodzaj łodzi (1/2), a potem łódź tego rodzaju z największym
+ * kredytem.
+ * Historia "kto już płynął" to rosnący zbiór pid-ów (adresowanie otwarte),
+ * więc kasjer-shard trzyma tylko swoich pasażerów i nie ma limitu id.
+ ******************************************************/
+
+#ifndef KASA_H
+#define KASA_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KASA_SET_INIT 1024   // początkowa pojemność zbioru (potęga dwójki)
+#define KASA_MAX_BOATS 1024  // jak MAX_BOATS sternika
+#define KASA_BOATS     2     // flota, zanim sternik ogłosi kredyt
+
+/* Cena biletu normalnego w groszach (zniżka liczona od niej) */
+#define TICKET_PRICE 2000
+
+typedef struct {
+    /* pid-y, które już płynęły: klucz pid+1, 0 = wolna komórka */
+    uint32_t *traveled;
+    size_t    cap, count;
+    /* credit[b] dla łodzi b = 1..nboats; -1 = brak informacji (sternik
+       jeszcze nic nie ogłosił) -> sprzedajemy. Sternik odświeża wartości
+       komunikatem "CREDIT <c1> .. <cN>", a każda sprzedaż zmniejsza
+       lokalny kredyt do czasu następnego ogłoszenia. */
+    int credit[KASA_MAX_BOATS + 1];
+    int nboats;
+} Kasa;
+
+/* Wynik decyzji; boat == 0 -> odmowa (brak miejsc w kolejkach) */
+typedef struct {
+    int boat;
+    int disc;
+    int skip;        // 1 => pasażer omija kolejkę
+    int first_trip;
+} Sale;
+
+static void kasa_init(Kasa *k)
+{
+    k->cap = KASA_SET_INIT;
+    k->count = 0;
+    k->traveled = calloc(k->cap, sizeof(uint32_t));
+    for (int b = 0; b <= KASA_MAX_BOATS; b++) k->credit[b] = -1;
+    k->nboats = KASA_BOATS;
+}
+
+/* Kredyt z linii CREDIT: n wartości od łodzi 'from'. Ogłoszenie od łodzi 1
+   zaczyna nowy stan floty, dalsze kawałki ("CREDIT @from ...") go rozszerzają. */
+static void kasa_set_credit(Kasa *k, int from, const int *c, int n)
+{
+    if (from < 1) return;
+    if (from == 1) k->nboats = 0;
+    for (int i = 0; i < n && from + i <= KASA_MAX_BOATS; i++) {
+        k->credit[from + i] = c[i];
+        if (from + i > k->nboats) k->nboats = from + i;
+    }
+}
+
+static void kasa_free(Kasa *k)
+{
+    free(k->traveled);
+    k->traveled = NULL;
+    k->cap = k->count = 0;
+}
+
+static size_t kasa_slot(uint32_t key, size_t cap)
+{
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+}
+
+static int kasa_traveled(const Kasa *k, int pid)
+{
+    if (pid < 0 || !k->traveled) return 0;
+    uint32_t key = (uint32_t)pid + 1;
+    for (size_t i = kasa_slot(key, k->cap); ; i = (i + 1) & (k->cap - 1)) {
+        if (k->traveled[i] == key) return 1;
+        if (k->traveled[i] == 0) return 0;
+    }
+}
+
+static void kasa_set_put(uint32_t *tab, size_t cap, uint32_t key)
+{
+    size_t i = kasa_slot(key, cap);
+    while (tab[i] != 0 && tab[i] != key) i = (i + 1) & (cap - 1);
+    tab[i] = key;
+}
+
+/* Zapamiętuje, że pid płynął; zbiór rośnie x2 przy zapełnieniu w 1/2 */
+static void kasa_mark_traveled(Kasa *k, int pid)
+{
+    if (pid < 0 || !k->traveled || kasa_traveled(k, pid)) return;
+    if ((k->count + 1) * 2 > k->cap) {
+        size_t ncap = k->cap * 2;
+        uint32_t *nt = calloc(ncap, sizeof(uint32_t));
+        if (!nt) return;   // brak pamięci - pasażer po prostu nie dostanie zniżki
+        for (size_t i = 0; i < k->cap; i++) {
+            if (k->traveled[i]) kasa_set_put(nt, ncap, k->traveled[i]);
+        }
+        free(k->traveled);
+        k->traveled = nt;
+        k->cap = ncap;
+    }
+    kasa_set_put(k->traveled, k->cap, (uint32_t)pid + 1);
+    k->count++;
+}
+
+/* Usuwa pid ze zbioru (cofnięta sprzedaż). Adresowanie liniowe, więc bez
+   znaczników usunięcia: kolejne wpisy z tego samego ciągu przesuwamy
+   w zwolnione miejsce, jeśli ich pozycja domowa na to pozwala. */
+static void kasa_unmark_traveled(Kasa *k, int pid)
+{
+    if (pid < 0 || !k->traveled) return;
+    uint32_t key = (uint32_t)pid + 1;
+    size_t mask = k->cap - 1, i = kasa_slot(key, k->cap);
+    while (k->traveled[i] != key) {
+        if (k->traveled[i] == 0) return;
+        i = (i + 1) & mask;
+    }
+    for (size_t j = (i + 1) & mask; k->traveled[j] != 0; j = (j + 1) & mask) {
+        size_t h = kasa_slot(k->traveled[j], k->cap);
+        /* wpis z j zostaje, gdy jego pozycja domowa leży w (i, j] */
+        if (i <= j ? (i < h && h <= j) : (i < h || h <= j)) continue;
+        k->traveled[i] = k->traveled[j];
+        i = j;
+    }
+    k->traveled[i] = 0;
+    k->count--;
+}
+
+/* Łódź rodzaju 'type' (1 - nieparzyste, 2 - parzyste), której kolejka
+   przyjmie jeszcze 'need' osób: ta z największym kredytem (brak informacji
+   = bez limitu). Remisy rozstrzyga losowy start, żeby ruch rozkładał się
+   po flocie. 0 - żadna. */
+static int kasa_pick(const Kasa *k, int type, int need)
+{
+    if (type > k->nboats) return 0;
+    int nt = (k->nboats - type) / 2 + 1;
+    int start = rand() % nt, best = 0, best_c = 0;
+    for (int j = 0; j < nt; j++) {
+        int b = type + 2 * ((start + j) % nt);
+        int c = k->credit[b] < 0 ? INT_MAX : k->credit[b];
+        if (c >= need && c > best_c) {
+            best = b;
+            best_c = c;
+        }
+    }
+    return best;
+}
+
+static Sale kasa_decide(const Kasa *k, int pid, int age, int group)
+{
+    Sale s = {0, 0, 0, 0};
+
+    // Wybór rodzaju łodzi (boat = 1 lub 2) na pierwszy rejs
+    // Domyślnie losujemy, ale zmienimy wg warunków:
+    //   - if group>0 => boat = 2
+    //   - if age<15 => boat = 2
+    //   - if age>70 => boat = 2
+    //   - inaczej boat = 1 lub 2 wylosowane
+    int boat = (rand() % 2) + 1;
+
+    if (group > 0) {
+        // Dziecko + dorosły => łódź 2
+        boat = 2;
+    } else {
+        // Bez grupy
+        if (age < 15 || age > 70) {
+            // Dzieci < 15 i seniorzy > 70 => tylko łódź 2
+            boat = 2;
+        }
+    }
+
+    // Sprawdzamy, czy to pierwszy rejs, czy już drugi
+    // (tzn. passenger o PID-ie 'pid' już pływał?)
+    if (pid >= 0) {
+        if (!kasa_traveled(k, pid)) {
+            // Pierwszy rejs tego pid-a (zapisujemy dopiero po sprzedaży)
+            s.first_trip = 1;
+
+            // Jeśli maluch < 3 lat => 100% zniżki
+            if (age < 3) {
+                s.disc = 100;
+            }
+        } else {
+            // Ten pid już pływał => to drugi (lub kolejny) rejs
+            s.skip = 1;  // omija kolejkę
+            // Ustalamy zniżkę
+            if (age < 3) {
+                s.disc = 100;  // maluch zawsze za darmo
+            } else {
+                s.disc = 50;   // pozostali 50% zniżki
+            }
+
+            // Zgodnie z wymaganiami "drugi rejs = dowolna łódź"
+            // Więc bez względu na wiek/grupę – teraz może pójść 1 lub 2
+            boat = (rand() % 2) + 1;
+        }
+    }
+
+    // Konkretna łódź tego rodzaju z wolnym miejscem w kolejce. Kontrola
+    // przyjęć: jeśli wszystkie są pełne, a pasażer może płynąć obiema
+    // (dorosły bez grupy albo drugi rejs) - łódź drugiego rodzaju.
+    int type = boat;
+    boat = kasa_pick(k, type, 1);
+    if (!boat && (s.skip || (group == 0 && age >= 15 && age <= 70))) {
+        boat = kasa_pick(k, 3 - type, 1);   // 0 - brak miejsc w kolejkach
+    }
+    s.boat = boat;
+    return s;
+}
+
+/* Bilet grupowy (BUY_GROUP): jedna decyzja dla całej grupy, zniżki
+   osobno dla każdego członka (each[i].disc, each[i].first_trip).
+   Grupa płynie łodzią rodzaju 2, chyba że wszyscy już płynęli - wtedy
+   skip i dowolna łódź. Kredyt łodzi musi starczyć na n miejsc naraz. */
+static Sale kasa_decide_group(const Kasa *k, const int *pid, const int *age, int n, Sale *each)
+{
+    Sale g = {0, 0, 0, 0};
+    int returning = 1;
+    for (int i = 0; i < n; i++) {
+        Sale s = {0, 0, 0, 0};
+        s.first_trip = !kasa_traveled(k, pid[i]);
+        if (age[i] < 3)          s.disc = 100;
+        else if (!s.first_trip)  s.disc = 50;
+        if (s.first_trip) returning = 0;
+        each[i] = s;
+    }
+    int type = returning ? (rand() % 2) + 1 : 2;
+    int boat = kasa_pick(k, type, n);
+    if (!boat && returning) boat = kasa_pick(k, 3 - type, n);
+    g.boat = boat;
+    g.skip = returning;
+    for (int i = 0; i < n; i++) {
+        each[i].boat = boat;
+        each[i].skip = returning;
+    }
+    return g;
+}
+
+/* Sprzedaż (rezerwacja do czasu doręczenia odpowiedzi) */
+static void kasa_commit(Kasa *k, int pid, const Sale *s)
+{
+    if (s->boat == 0) return;
+    if (s->first_trip) kasa_mark_traveled(k, pid);
+    if (k->credit[s->boat] > 0) k->credit[s->boat]--;
+}
+
+/* Grupowa sprzedaż (rezerwacja jak wyżej) */
+static void kasa_commit_group(Kasa *k, const int *pid, const Sale *each, int n)
+{
+    if (n < 1 || each[0].boat == 0) return;
+    int boat = each[0].boat;
+    for (int i = 0; i < n; i++) {
+        if (each[i].first_trip) kasa_mark_traveled(k, pid[i]);
+    }
+    k->credit[boat] = k->credit[boat] > n ? k->credit[boat] - n : (k->credit[boat] < 0 ? -1 : 0);
+}
+
+/* Odpowiedź nie dotarła - sprzedaż anulowana: pid znów "nie płynął",
+   miejsce wraca do kredytu (do następnego ogłoszenia sternika) */
+static void kasa_release(Kasa *k, int pid, const Sale *s)
+{
+    if (s->boat == 0) return;
+    if (s->first_trip) kasa_unmark_traveled(k, pid);
+    if (k->credit[s->boat] >= 0) k->credit[s->boat]++;
+}
+
+static void kasa_release_group(Kasa *k, const int *pid, const Sale *each, int n)
+{
+    if (n < 1 || each[0].boat == 0) return;
+    int boat = each[0].boat;
+    for (int i = 0; i < n; i++) {
+        if (each[i].first_trip) kasa_unmark_traveled(k, pid[i]);
+    }
+    if (k->credit[boat] >= 0) k->credit[boat] += n;
+}
+
+static int kasa_price(const Sale *s)
+{
+    return TICKET_PRICE * (100 - s->disc) / 100;
+}
+
+#endif
@@ -8,122 +8,310 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/stat.h>
 
-#define MAX_PIDS  5000
-#define BUFSZ     4096  // Bufor do czytania z FIFO
+#include "kasa.h"
+#include "lineparse.h"
+#include "shard.h"
+#include "rundir.h"
+#include "ledger.h"
+#include "trace.h"
+#include "chrome_trace.h"
 
-/* Tablica, która zapamiętuje, czy dany pid już płynął: 
-   traveled[pid] = 0 (nie płynął), 1 (już płynął) */
-static int traveled[MAX_PIDS];
+#define BUFSZ     (64*1024)  // Bufor do czytania z FIFO
+
+/* Odpowiedzi do pasażerów idą przez open(O_NONBLOCK): jeśli FIFO nie ma
+   jeszcze czytelnika (ENXIO) albo jest pełne (EAGAIN), odpowiedź czeka
+   w kolejce i pętla główna ponawia ją co REPLY_RETRY_MS (x2 do
+   REPLY_RETRY_MAX_MS). Po REPLY_TTL_MS (KASJER_REPLY_TTL_MS) albo gdy
+   FIFO zniknęło - rezygnujemy. Miejsce w kredycie i "już płynął"
+   rezerwujemy od razu przy decyzji (kasa_commit), żeby kolejne BUY nie
+   sprzedawały na ten sam kredyt; rejestr dostaje sprzedaż po doręczeniu.
+   Niedoręczona nie przepada po cichu - rezerwacja jest cofana
+   (kasa_release), a sprzedaż anulowana. */
+#define REPLY_RETRY_MS      5
+#define REPLY_RETRY_MAX_MS  100
+#define REPLY_TTL_MS        5000
+#define REPLY_TTL_ENV       "KASJER_REPLY_TTL_MS"
+
+/* Sprzedaż do rozliczenia po dostarczeniu odpowiedzi: pojedynczy bilet
+   (n = 1) albo grupowy (BUY_GROUP, id = id grupy) */
+typedef struct {
+    int  id, group, n;
+    int  pid[GROUP_MAX], age[GROUP_MAX];
+    Sale each[GROUP_MAX];
+} Ticket;
+
+typedef struct {
+    char fifo[64];
+    char msg[96];
+    Ticket t;
+    long long deadline, next_try;   // ms zegara monotonicznego
+    int  backoff;
+} PendingReply;
+
+static PendingReply *pending;
+static size_t npending, cap_pending;
+static long long reply_ttl_ms = REPLY_TTL_MS;
+static unsigned long long replies_now, replies_late, replies_lost;
+
+/* Rejestr sprzedaży (kasjer.ledger, patrz ledger.h) */
+static Ledger ledger = { .fd = -1 };
+
+/* Stan sprzedaży: kto już płynął i kredyt od sternika (kasa.h) */
+static Kasa kasa;
 
 /* Flaga kończąca pętlę główną kasjera */
 static volatile int end_kasjer = 0;
 
+/* SIGTERM (orchestrator zaraz po QUIT) - kończymy pętlę normalnie,
+   żeby rejestr zdążył zapisać ostatnią partię sprzedaży */
+static void sigterm_handler(int s)
+{
+    (void)s;
+    end_kasjer = 1;
+}
+
+static long long mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/* Jedna próba wysłania: 1 - wysłane, 0 - spróbować później
+   (brak czytelnika albo pełne FIFO), -1 - nie ma komu wysłać */
+static int reply_try(const char *fifo, const char *msg)
+{
+    int fd = open(fifo, O_WRONLY | O_NONBLOCK);
+    if (fd < 0) return (errno == ENXIO || errno == EINTR) ? 0 : -1;
+    size_t len = strlen(msg);     // < PIPE_BUF: zapis w całości albo EAGAIN
+    ssize_t w = write(fd, msg, len);
+    int err = errno;
+    close(fd);
+    errno = err;
+    if (w == (ssize_t)len) return 1;
+    return (w < 0 && (err == EAGAIN || err == EINTR)) ? 0 : -1;
+}
+
+/* Decyzja zapadła - rezerwujemy miejsce i "już płynął" do czasu doręczenia */
+static void sale_reserve(const Ticket *t)
+{
+    if (t->n == 1) kasa_commit(&kasa, t->pid[0], &t->each[0]);
+    else           kasa_commit_group(&kasa, t->pid, t->each, t->n);
+}
+
+/* Odpowiedź dotarła - dopiero teraz sprzedaż jest ważna.
+   W rejestrze każdy członek grupy ma własny wpis (z id grupy). */
+static void sale_delivered(const Ticket *t)
+{
+    if (t->each[0].boat == 0) return;
+
+    // Sprzedaż do rejestru (zapis na dysk partiami, w tle)
+    for (int i = 0; i < t->n; i++) {
+        const Sale *sale = &t->each[i];
+        LedgerRec rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.ts_us = ledger_now_us();
+        rec.pid   = t->pid[i];
+        rec.age   = t->age[i];
+        rec.group = t->group;
+        rec.price = kasa_price(sale);
+        rec.boat  = (uint16_t)sale->boat;
+        rec.disc  = (uint8_t)sale->disc;
+        rec.skip  = (uint8_t)sale->skip;
+        ledger_append(&ledger, &rec);
+        trace_ev(TE_OK, t->pid[i], sale->boat, sale->disc, sale->skip);
+    }
+}
+
+static void reply_lost(const Ticket *t, const char *why)
+{
+    replies_lost++;
+    if (t->n == 1) kasa_release(&kasa, t->pid[0], &t->each[0]);
+    else           kasa_release_group(&kasa, t->pid, t->each, t->n);
+    printf("[KASJER] Odpowiedź dla %d niedoręczona (%s)%s\n", t->id, why,
+           t->each[0].boat ? " -> sprzedaż anulowana" : "");
+}
+
+/* Wysyła odpowiedź na BUY/BUY_GROUP albo odkłada ją do ponowienia;
+   sprzedaż jest zarezerwowana, zanim odpowiedź wyjdzie */
+static void reply_send(const char *fifo, const char *msg, const Ticket *t)
+{
+    sale_reserve(t);
+    int r = reply_try(fifo, msg);
+    if (r > 0) {
+        replies_now++;
+        sale_delivered(t);
+        return;
+    }
+    if (r < 0) {
+        reply_lost(t, strerror(errno));
+        return;
+    }
+    if (strlen(fifo) >= sizeof(pending->fifo)) {
+        reply_lost(t, "za długa nazwa FIFO");
+        return;
+    }
+    if (npending == cap_pending) {
+        size_t nc = cap_pending ? cap_pending * 2 : 64;
+        PendingReply *np = realloc(pending, nc * sizeof(*np));
+        if (!np) {
+            reply_lost(t, "brak pamięci");
+            return;
+        }
+        pending = np;
+        cap_pending = nc;
+    }
+    long long now = mono_ms();
+    PendingReply *p = &pending[npending++];
+    snprintf(p->fifo, sizeof(p->fifo), "%s", fifo);
+    snprintf(p->msg, sizeof(p->msg), "%s", msg);
+    p->t = *t;
+    p->backoff  = REPLY_RETRY_MS;
+    p->next_try = now + p->backoff;
+    p->deadline = now + reply_ttl_ms;
+}
+
+/* Ponawia odpowiedzi, którym minął termin próby (kolejność zachowana).
+   Zwraca ms do następnej próby albo -1, gdy kolejka jest pusta. */
+static int pending_flush(void)
+{
+    long long now = mono_ms(), next = -1;
+    size_t keep = 0;
+    for (size_t i = 0; i < npending; i++) {
+        PendingReply *p = &pending[i];
+        if (p->next_try <= now) {
+            int r = reply_try(p->fifo, p->msg);
+            if (r > 0) {
+                replies_late++;
+                sale_delivered(&p->t);
+                continue;
+            }
+            if (r < 0 || now >= p->deadline) {
+                reply_lost(&p->t, r < 0 ? strerror(errno) : "minął czas");
+                continue;
+            }
+            p->backoff = p->backoff * 2 < REPLY_RETRY_MAX_MS ? p->backoff * 2 : REPLY_RETRY_MAX_MS;
+            p->next_try = now + p->backoff;
+            if (p->next_try > p->deadline) p->next_try = p->deadline;
+        }
+        if (next < 0 || p->next_try < next) next = p->next_try;
+        if (keep != i) pending[keep] = *p;
+        keep++;
+    }
+    npending = keep;
+    return next < 0 ? -1 : (int)(next > now ? next - now : 0);
+}
+
 /* --------------------------------------------------- *
- * Funkcja obsługująca pojedynczą linię komendy.
- * line może mieć postać:
+ * Funkcja obsługująca pojedynczą linię komendy - zakres [p,end)
+ * wewnątrz bufora odczytu (bez '\n', bez kopiowania).
+ * Linia może mieć postać:
  *   "BUY 1234 27 0 fifo_pasazer_1234"
  *   "BUY 1001 10 50 fifo_inne"
+ *   "BUY_GROUP 900 2 1234 27 1235 2 fifo_pasazer_1234"  (bilet grupowy)
+ *   "CREDIT 150 200"   (od sternika: wolne miejsca w kolejkach łodzi 1..N)
+ *   "CREDIT @257 10 0 .." (dalszy kawałek dużej floty)
  *   "QUIT"
  * itd.
  * --------------------------------------------------- */
-static void handle_line(char *line)
+static void handle_line(char *p, char *end)
 {
-    // Usuwamy ewentualne znaki \r na końcu (Windowsowe)
-    char *cr = strchr(line, '\r');
-    if (cr) *cr = '\0';
-
-    // Sprawdzamy, czy to komenda BUY
-    if (strncmp(line, "BUY", 3) == 0) {
-        int pid, age, group;
-        char fifo_response[128]; // nazwa FIFO pasażera do odpowiedzi
-        // Parsujemy: "BUY %d %d %d %s"
-        int c = sscanf(line, "BUY %d %d %d %s", &pid, &age, &group, fifo_response);
-        if (c < 3) {
-            printf("[KASJER] Błędne: %s\n", line);
-            return;
-        }
-        // Jeśli nie podano nazwy FIFO, ustawiamy domyślną (opcjonalne)
-        if (c < 4) {
-            strcpy(fifo_response, "fifo_kasjer_out");
+    // Usuwamy ewentualny znak \r na końcu (Windowsowe)
+    if (end > p && end[-1] == '\r') end--;
+    int len = (int)(end - p);
+
+    BuyRec br;
+    BuyGroupRec bg;
+    int from, credit[CREDIT_CHUNK];
+    int pr = parse_buy_line(p, end, &br);
+    if (pr > 0) {
+        int pid = br.pid, age = br.age, group = br.group;
+        // Nazwa FIFO pasażera do odpowiedzi: kończymy ją '\0' w miejscu
+        // (za nazwą jest spacja, '\r' albo '\n' - bajt należy do bufora).
+        // Jeśli jej nie podano, ustawiamy domyślną (opcjonalne).
+        const char *fifo_response = "fifo_kasjer_out";
+        if (br.fifo_len > 0) {
+            ((char *)br.fifo)[br.fifo_len] = '\0';
+            fifo_response = br.fifo;
         }
 
         printf("[KASJER] Pasażer %d (wiek=%d), group=%d\n", pid, age, group);
+        trace_ev(TE_BUY, pid, 0, age, group);
 
-        // Wybór łodzi (boat = 1 lub 2) na pierwszy rejs
-        // Domyślnie losujemy, ale zmienimy wg warunków:
-        //   - if group>0 => boat = 2
-        //   - if age<15 => boat = 2
-        //   - if age>70 => boat = 2
-        //   - inaczej boat = 1 lub 2 wylosowane
-        int boat = (rand() % 2) + 1;
-
-        if (group > 0) {
-            // Dziecko + dorosły => łódź 2
-            boat = 2;
-        } else {
-            // Bez grupy
-            if (age < 15 || age > 70) {
-                // Dzieci < 15 i seniorzy > 70 => tylko łódź 2
-                boat = 2;
-            }
-        }
+        // Wybór łodzi, zniżki i pominięcia kolejki (kasa.h)
+        Sale sale = kasa_decide(&kasa, pid, age, group);
 
-        // Sprawdzamy, czy to pierwszy rejs, czy już drugi
-        // (tzn. passenger o PID-ie 'pid' już pływał?)
-        int discount = 0;
-        int skip = 0;  // skip=1 => pasażer omija kolejkę
-
-        if (pid >= 0 && pid < MAX_PIDS) {
-            if (!traveled[pid]) {
-                // Pierwszy rejs tego pid-a
-                traveled[pid] = 1;
-                
-                // Jeśli maluch < 3 lat => 100% zniżki
-                if (age < 3) {
-                    discount = 100;
-                }
-            } else {
-                // Ten pid już pływał => to drugi (lub kolejny) rejs
-                skip = 1;  // omija kolejkę
-                // Ustalamy zniżkę
-                if (age < 3) {
-                    discount = 100;  // maluch zawsze za darmo
-                } else {
-                    discount = 50;   // pozostali 50% zniżki
-                }
-
-                // Zgodnie z wymaganiami "drugi rejs = dowolna łódź"
-                // Więc bez względu na wiek/grupę – teraz może pójść 1 lub 2
-                boat = (rand() % 2) + 1;
-            }
+        char resp_buf[96];
+        if (sale.boat == 0) {
+            // Jawna odmowa: "NO <pid> FULL" - pasażer kończy zamiast czekać
+            printf("[KASJER] Brak miejsc w kolejkach -> odmowa dla %d\n", pid);
+            trace_ev(TE_NO, pid, 0, 0, 0);
+            snprintf(resp_buf, sizeof(resp_buf), "NO %d FULL\n", pid);
+        } else {
+            // Odpowiedź (sprzedaż zapisujemy po jej dostarczeniu):
+            // "OK <pid> BOAT=<1|2> DISC=<discount> SKIP=<0|1> GROUP=<group>"
+            snprintf(resp_buf, sizeof(resp_buf),
+                     "OK %d BOAT=%d DISC=%d SKIP=%d GROUP=%d\n",
+                     pid, sale.boat, sale.disc, sale.skip, group);
         }
-
-        // Otwieramy FIFO pasażera w trybie zapisu
-        int fd_resp = open(fifo_response, O_WRONLY);
-        if (fd_resp < 0) {
-            perror("[KASJER] open fifo_response");
+        Ticket t = { .id = pid, .group = group, .n = 1 };
+        t.pid[0] = pid;
+        t.age[0] = age;
+        t.each[0] = sale;
+        reply_send(fifo_response, resp_buf, &t);
+    }
+    else if (pr < 0) {
+        printf("[KASJER] Błędne: %.*s\n", len, p);
+    }
+    else if ((pr = parse_buy_group_line(p, end, &bg)) != 0) {
+        if (pr < 0) {
+            printf("[KASJER] Błędne: %.*s\n", len, p);
             return;
         }
+        ((char *)bg.fifo)[bg.fifo_len] = '\0';
+        printf("[KASJER] Grupa %d (%d osób)\n", bg.group, bg.n);
+        for (int i = 0; i < bg.n; i++) trace_ev(TE_BUY, bg.pid[i], 0, bg.age[i], bg.group);
 
-        // Wysyłamy odpowiedź:
-        // "OK <pid> BOAT=<1|2> DISC=<discount> SKIP=<0|1> GROUP=<group>"
-        char resp_buf[256];
-        snprintf(resp_buf, sizeof(resp_buf),
-                 "OK %d BOAT=%d DISC=%d SKIP=%d GROUP=%d\n",
-                 pid, boat, discount, skip, group);
-        write(fd_resp, resp_buf, strlen(resp_buf));
-        close(fd_resp);
+        // Jedna decyzja dla całej grupy, zniżki osobno dla każdego
+        Ticket t = { .id = bg.group, .group = bg.group, .n = bg.n };
+        memcpy(t.pid, bg.pid, sizeof(t.pid));
+        memcpy(t.age, bg.age, sizeof(t.age));
+        Sale sale = kasa_decide_group(&kasa, t.pid, t.age, t.n, t.each);
+
+        char resp_buf[96];
+        if (sale.boat == 0) {
+            printf("[KASJER] Brak %d miejsc w kolejce -> odmowa dla grupy %d\n", bg.n, bg.group);
+            for (int i = 0; i < bg.n; i++) trace_ev(TE_NO, bg.pid[i], 0, 0, 0);
+            snprintf(resp_buf, sizeof(resp_buf), "NO %d FULL\n", bg.group);
+        } else {
+            // "OK <gid> BOAT= DISC= SKIP= GROUP=<gid> N=<n> PRICE=<grosze>";
+            // DISC - zniżka dla grupy jako całości (z cen członków)
+            int price = 0;
+            for (int i = 0; i < t.n; i++) price += kasa_price(&t.each[i]);
+            int disc = 100 - price * 100 / (t.n * TICKET_PRICE);
+            snprintf(resp_buf, sizeof(resp_buf),
+                     "OK %d BOAT=%d DISC=%d SKIP=%d GROUP=%d N=%d PRICE=%d\n",
+                     bg.group, sale.boat, disc, sale.skip, bg.group, t.n, price);
+        }
+        reply_send(bg.fifo, resp_buf, &t);
     }
-    else if (strncmp(line, "QUIT", 4) == 0) {
+    else if ((pr = parse_credit_line(p, end, &from, credit)) != 0) {
+        // "CREDIT <c1> .. <cN>" od sternika - wolne miejsca w kolejkach łodzi
+        if (pr > 0) kasa_set_credit(&kasa, from, credit, pr);
+    }
+    else if (len >= 4 && memcmp(p, "QUIT", 4) == 0) {
         printf("[KASJER] QUIT => end.\n");
         end_kasjer = 1;
     }
     else {
         // Być może pusta linia lub nieznana komenda
-        if (line[0] != '\0') {
-            printf("[KASJER] Nieznane: %s\n", line);
+        if (len > 0) {
+            printf("[KASJER] Nieznane: %.*s\n", len, p);
         }
     }
 }
@@ -131,42 +319,84 @@ static void handle_line(char *line)
 /* --------------------------------------------------- *
  * Główny program kasjera
  * --------------------------------------------------- */
-int main(void)
+int main(int argc, char *argv[])
 {
+    // Pliki (FIFO, ledger) względem katalogu przebiegu (rundir.h)
+    if (rundir_enter(0) < 0) {
+        perror("[KASJER] " RUN_DIR_ENV);
+        return 1;
+    }
+    // Numer sharda (./kasjer [shard]); liczba shardów z KASJER_SHARDS (shard.h)
+    int nshards = kasjer_shards();
+    int shard = (argc > 1) ? atoi(argv[1]) : 0;
+    if (shard < 0 || shard >= nshards) {
+        fprintf(stderr, "[KASJER] shard %d poza zakresem 0..%d\n", shard, nshards - 1);
+        return 1;
+    }
+    char fifo_in[64], ledger_path[64];
+    kasjer_fifo_name(fifo_in, sizeof(fifo_in), shard, nshards);
+    kasjer_ledger_name(ledger_path, sizeof(ledger_path), shard, nshards);
+
     // Tworzymy FIFO do komunikacji (o ile nie istnieje)
-    mkfifo("fifo_kasjer_in", 0666);
+    mkfifo(fifo_in, 0666);
     // (Jeśli korzystamy z jednego wspólnego FIFO wyjściowego, można by tu też
     //  je utworzyć, np. mkfifo("fifo_kasjer_out", 0666);)
 
     // Otwieramy FIFO we/wy w odpowiednich trybach
-    int fd_in = open("fifo_kasjer_in", O_RDONLY);
+    int fd_in = open(fifo_in, O_RDONLY);
     if (fd_in < 0) {
         perror("[KASJER] open fifo_kasjer_in");
         return 1;
     }
 
     // Dummy-writer do tego samego FIFO, by zapobiec zamknięciu przy braku piszących
-    int fd_dummy = open("fifo_kasjer_in", O_WRONLY);
+    int fd_dummy = open(fifo_in, O_WRONLY);
     if (fd_dummy < 0) {
         perror("[KASJER] open fifo_kasjer_in (dummy)");
         close(fd_in);
         return 1;
     }
 
-    // Zerujemy tablicę traveled
-    for (int i = 0; i < MAX_PIDS; i++) {
-        traveled[i] = 0;
-    }
+    // Zerujemy stan sprzedaży (traveled, kredyt)
+    kasa_init(&kasa);
 
-    printf("[KASJER] Start.\n");
+    printf("[KASJER] Start (shard %d/%d, %s).\n", shard, nshards, fifo_in);
     setbuf(stdout, NULL);
+    trace_open(TP_KASJER, "kasjer", 1<<21);
+    char ct_name[32];
+    snprintf(ct_name, sizeof(ct_name), "kasjer %d", shard);
+    ct_open(ct_name, 0);
+    ct_thread_name(0, "handle_line");
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigterm_handler;   // bez SA_RESTART: read() wraca z EINTR
+    sigaction(SIGTERM, &sa, NULL);
+    // Pasażer może zamknąć FIFO między open a write - wtedy EPIPE, nie śmierć
+    signal(SIGPIPE, SIG_IGN);
+
+    const char *ttl = getenv(REPLY_TTL_ENV);
+    if (ttl && *ttl) reply_ttl_ms = atoll(ttl);
+
+    if (ledger_open(&ledger, ledger_path) < 0) {
+        fprintf(stderr, "[KASJER] %s (sprzedaż bez rejestru): %s\n", ledger_path, strerror(errno));
+    }
 
     // Bufor do czytania i zmienna rbuf_len - ile mamy danych w buforze
     static char rbuf[BUFSZ];
     int rbuf_len = 0;
 
-    // Główna pętla odczytu z FIFO
+    // Główna pętla: poll na FIFO wejściowym, z budzeniem na ponowienie
+    // odłożonych odpowiedzi
     while (!end_kasjer) {
+        struct pollfd pfd = { .fd = fd_in, .events = POLLIN };
+        int pr = poll(&pfd, 1, pending_flush());
+        if (pr < 0) {
+            if (errno == EINTR) continue;
+            perror("[KASJER] poll");
+            break;
+        }
+        if (pr == 0) continue;   // tylko termin ponowienia
         ssize_t n = read(fd_in, rbuf + rbuf_len, sizeof(rbuf) - rbuf_len);
         if (n < 0) {
             if (errno == EINTR) {
@@ -185,46 +415,55 @@ int main(void)
         // Mamy n bajtów świeżo wczytanych. Zwiększamy rbuf_len
         rbuf_len += n;
 
-        // Szukamy wszystkich linii zakończonych '\n'
-        int start = 0;
-        while (1) {
-            char *nl = memchr(rbuf + start, '\n', rbuf_len - start);
-            if (!nl) {
-                // Brak kolejnego newline => przerywamy
-                break;
-            }
-            // Pozycja newline
-            int line_len = (int)(nl - (rbuf + start));
-            // Kopiujemy tę linijkę do tymczasowego bufora
-            char line[512];
-            if (line_len >= (int)sizeof(line)) {
-                // Linia za długa -> ucinamy
-                line_len = (int)sizeof(line) - 1;
+        // Wszystkie pełne linie z tego odczytu obsługujemy w miejscu,
+        // w buforze - bez kopiowania do osobnej tablicy
+        char *p = rbuf, *end = rbuf + rbuf_len, *nl;
+        while ((nl = memchr(p, '\n', end - p)) != NULL) {
+            // Obsługujemy linię (ze śladem Chrome - czas każdej komendy)
+            if (ct_fd >= 0) {
+                long long t0 = ct_now_us();
+                char cmd[8], args[48];
+                int k = 0;
+                while (k < 6 && p + k < nl && p[k] >= 'A' && p[k] <= 'Z') { cmd[k] = p[k]; k++; }
+                cmd[k] = '\0';
+                handle_line(p, nl);
+                snprintf(args, sizeof(args), "\"cmd\":\"%s\"", cmd);
+                ct_span("handle_line", "kasjer", 0, t0, ct_now_us() - t0, args);
+            } else {
+                handle_line(p, nl);
             }
-            memcpy(line, rbuf + start, line_len);
-            line[line_len] = '\0';
-
-            // Obsługujemy linię
-            handle_line(line);
-
-            // Przesuwamy start za newline
-            start += line_len + 1;
+            p = nl + 1;
         }
 
         // Jeśli zostały niedokończone bajty na końcu,
         // przesuwamy je na początek bufora
-        if (start < rbuf_len) {
-            int leftover = rbuf_len - start;
-            memmove(rbuf, rbuf + start, leftover);
-            rbuf_len = leftover;
-        } else {
+        rbuf_len = (int)(end - p);
+        if (rbuf_len > 0 && p != rbuf) {
+            memmove(rbuf, p, rbuf_len);
+        }
+        if (rbuf_len == (int)sizeof(rbuf)) {
+            // Cały bufor bez '\n' - linia za długa, odrzucamy
+            printf("[KASJER] linia dłuższa niż bufor -> odrzucam.\n");
             rbuf_len = 0;
         }
     }
 
-    // Kończymy
+    // Ostatnia próba dla odłożonych odpowiedzi; reszta przepada
+    pending_flush();
+    for (size_t i = 0; i < npending; i++) reply_lost(&pending[i].t, "koniec pracy");
+    free(pending);
+    printf("[KASJER] odpowiedzi: od razu %llu, po ponowieniu %llu, niedoręczone %llu.\n",
+           replies_now, replies_late, replies_lost);
+
+    // Kończymy - reszta sprzedaży do rejestru
+    if (ledger.fd >= 0) {
+        ledger_close(&ledger);
+        printf("[KASJER] rejestr: %llu sprzedaży w %llu zapisach.\n",
+               (unsigned long long)ledger.records, (unsigned long long)ledger.batches);
+    }
     close(fd_in);
     close(fd_dummy);
-    printf("[KASJER] end.\n");
+    printf("[KASJER] end (shard %d, pasażerów w historii: %zu).\n", shard, kasa.count);
+    kasa_free(&kasa);
     return 0;
 }
@@ -0,0 +1,209 @@
+/*******************************************************
+ * File: ledger.h
+ *
+ * Rejestr sprzedaży kasjera - binarny plik tylko do dopisywania.
+ *   nagłówek LedgerHdr, potem rekordy LedgerRec (stały rozmiar)
+ *
+ * Zapis grupowy: sprzedaż tylko kopiuje rekord do bufora w pamięci.
+ * Osobny wątek co LEDGER_SYNC_MS (albo gdy bufor się zapełnia) zamienia
+ * bufory, zapisuje całą partię jednym write() i robi jedno fdatasync()
+ * dla wszystkich sprzedaży z partii - bez fsync na każdą sprzedaż.
+ *
+ * Po awarii na końcu pliku może zostać niepełny rekord - czytelnik
+ * (ledger_report) go pomija. Plik w innym formacie (starsza wersja)
+ * kasjer odkłada obok jako <plik>.old i zaczyna nowy.
+ ******************************************************/
+
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define LEDGER_FILE    "kasjer.ledger"
+#define LEDGER_MAGIC   0x4744454cu   // "LEDG"
+#define LEDGER_VERSION 2             // 2: boat 16-bitowy (duża flota)
+#define LEDGER_BATCH   4096          // rekordów w jednym buforze
+#define LEDGER_SYNC_MS 100           // max opóźnienie utrwalenia sprzedaży
+
+typedef struct {
+    uint32_t magic, version;
+    uint32_t rec_size, reserved;
+} LedgerHdr;
+
+/* Jedna sprzedaż (32 bajty) */
+typedef struct {
+    int64_t  ts_us;      // czas sprzedaży (CLOCK_REALTIME, µs)
+    int32_t  pid, age, group;
+    int32_t  price;      // zapłacono (grosze)
+    uint16_t boat;
+    uint8_t  disc, skip;
+} LedgerRec;
+
+typedef struct {
+    int fd;
+    LedgerRec bufs[2][LEDGER_BATCH];
+    LedgerRec *fill;     // tu dopisuje kasjer
+    int nfill;
+    pthread_mutex_t m;
+    pthread_cond_t  wake, room;
+    int stop;
+    pthread_t th;
+    uint64_t records, batches;   // statystyka zapisów
+} Ledger;
+
+static int64_t ledger_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static int ledger_write_all(int fd, const void *p, size_t len)
+{
+    const char *c = (const char*)p;
+    while(len>0){
+        ssize_t w = write(fd, c, len);
+        if(w<0){
+            if(errno==EINTR) continue;
+            return -1;
+        }
+        c += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+/* Wątek zapisu: partia z bufora -> write() + jedno fdatasync() */
+static void *ledger_thread(void *arg)
+{
+    Ledger *l = (Ledger*)arg;
+    pthread_mutex_lock(&l->m);
+    while(1){
+        if(l->nfill==0 && !l->stop){
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += LEDGER_SYNC_MS*1000000L;
+            ts.tv_sec  += ts.tv_nsec/1000000000;
+            ts.tv_nsec %= 1000000000;
+            pthread_cond_timedwait(&l->wake, &l->m, &ts);
+        }
+        if(l->nfill==0){
+            if(l->stop) break;
+            continue;
+        }
+
+        /* zamiana buforów - kasjer od razu pisze dalej do drugiego */
+        LedgerRec *batch = l->fill;
+        int n = l->nfill;
+        l->fill  = (batch==l->bufs[0]) ? l->bufs[1] : l->bufs[0];
+        l->nfill = 0;
+        pthread_cond_broadcast(&l->room);
+        pthread_mutex_unlock(&l->m);
+
+        if(ledger_write_all(l->fd, batch, (size_t)n*sizeof(LedgerRec))==0){
+            fdatasync(l->fd);
+        }
+
+        pthread_mutex_lock(&l->m);
+        l->records += n;
+        l->batches++;
+        if(!l->stop){
+            /* zbieramy kolejną grupę sprzedaży przez LEDGER_SYNC_MS */
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += LEDGER_SYNC_MS*1000000L;
+            ts.tv_sec  += ts.tv_nsec/1000000000;
+            ts.tv_nsec %= 1000000000;
+            while(!l->stop && l->nfill < LEDGER_BATCH/2){
+                if(pthread_cond_timedwait(&l->wake, &l->m, &ts)==ETIMEDOUT) break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&l->m);
+    return NULL;
+}
+
+/* Otwiera rejestr do dopisywania (nowy plik dostaje nagłówek).
+   0 - ok, -1 - błąd (kasjer działa wtedy bez rejestru). */
+static int ledger_open(Ledger *l, const char *path)
+{
+    memset(l, 0, sizeof(*l));
+    l->fd = open(path, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if(l->fd<0) return -1;
+
+    struct stat st;
+    LedgerHdr h;
+    if(fstat(l->fd, &st)<0) goto fail;
+    if(st.st_size >= (off_t)sizeof(LedgerHdr) &&
+       (pread(l->fd, &h, sizeof(h), 0)!=(ssize_t)sizeof(h) || h.magic!=LEDGER_MAGIC ||
+        h.version!=LEDGER_VERSION || h.rec_size!=sizeof(LedgerRec))){
+        /* inny format - nie dopisujemy do niego, odkładamy go obok */
+        char old[512];
+        snprintf(old, sizeof(old), "%s.old", path);
+        close(l->fd);
+        l->fd = -1;
+        if(rename(path, old)<0) return -1;
+        l->fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_TRUNC, 0644);
+        if(l->fd<0) return -1;
+        st.st_size = 0;
+    }
+    if(st.st_size < (off_t)sizeof(LedgerHdr)){
+        /* nowy plik albo urwany nagłówek (awaria przy tworzeniu) - od nowa */
+        h = (LedgerHdr){ LEDGER_MAGIC, LEDGER_VERSION, sizeof(LedgerRec), 0 };
+        if(ftruncate(l->fd, 0)<0 || ledger_write_all(l->fd, &h, sizeof(h))<0) goto fail;
+    } else if(st.st_size > (off_t)sizeof(LedgerHdr) &&
+              (st.st_size - sizeof(LedgerHdr)) % sizeof(LedgerRec)){
+        /* niepełny rekord po awarii - ucinamy, żeby nowe rekordy były wyrównane */
+        ftruncate(l->fd, st.st_size - (st.st_size - sizeof(LedgerHdr)) % sizeof(LedgerRec));
+    }
+
+    l->fill = l->bufs[0];
+    pthread_mutex_init(&l->m, NULL);
+    pthread_cond_init(&l->wake, NULL);
+    pthread_cond_init(&l->room, NULL);
+    pthread_create(&l->th, NULL, ledger_thread, l);
+    return 0;
+
+fail:
+    close(l->fd);
+    l->fd = -1;
+    return -1;
+}
+
+/* Dopisanie sprzedaży - tylko kopia do bufora (czeka wyłącznie wtedy,
+   gdy oba bufory są pełne, czyli dysk nie nadąża) */
+static void ledger_append(Ledger *l, const LedgerRec *r)
+{
+    if(l->fd<0) return;
+    pthread_mutex_lock(&l->m);
+    while(l->nfill==LEDGER_BATCH){
+        pthread_cond_signal(&l->wake);
+        pthread_cond_wait(&l->room, &l->m);
+    }
+    l->fill[l->nfill++] = *r;
+    if(l->nfill==LEDGER_BATCH/2) pthread_cond_signal(&l->wake);
+    pthread_mutex_unlock(&l->m);
+}
+
+/* Zapis reszty i zamknięcie */
+static void ledger_close(Ledger *l)
+{
+    if(l->fd<0) return;
+    pthread_mutex_lock(&l->m);
+    l->stop = 1;
+    pthread_cond_signal(&l->wake);
+    pthread_mutex_unlock(&l->m);
+    pthread_join(l->th, NULL);
+    close(l->fd);
+    l->fd = -1;
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*******************************************************
+ * File: ledger_report.c
+ *
+ * Czytnik rejestru sprzedaży kasjera (ledger.h).
+ * Sumuje sprzedaż i przychód:
+ *   - wg łodzi
+ *   - wg klasy zniżki (0%, 50%, 100%, inne)
+ *   - wg godziny (czas lokalny)
+ *
+ * Użycie: ./ledger_report [plik_rejestru...]   (domyślnie kasjer.ledger)
+ * Przy kilku kasjerach (shard.h) podajemy wszystkie kasjer_<k>.ledger -
+ * raport sumuje je razem.
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ledger.h"
+
+#define MAX_BOAT  1025   // łodzie 1..1024 (MAX_BOATS sternika)
+#define MAX_HOURS 4096
+
+typedef struct {
+    long count;
+    long long revenue;   // grosze
+} Sum;
+
+typedef struct {
+    long long hour;      // ts (s) / 3600
+    Sum s;
+} HourSum;
+
+static void add(Sum *s, const LedgerRec *r)
+{
+    s->count++;
+    s->revenue += r->price;
+}
+
+static void print_row(const char *label, const Sum *s)
+{
+    printf("  %-18s %8ld  %12lld.%02lld zł\n", label, s->count,
+           s->revenue/100, s->revenue%100);
+}
+
+static Sum total, by_boat[MAX_BOAT], by_disc[4];
+static HourSum hours[MAX_HOURS];
+static int nhours = 0;
+static int64_t first_ts = 0, last_ts = 0;
+
+/* Dolicza jeden plik rejestru. 0 - ok, -1 - błąd */
+static int load_ledger(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if(!f){
+        perror(path);
+        return -1;
+    }
+
+    LedgerHdr h;
+    if(fread(&h, sizeof(h), 1, f)!=1 || h.magic!=LEDGER_MAGIC){
+        fprintf(stderr, "%s: to nie jest rejestr sprzedaży\n", path);
+        fclose(f);
+        return -1;
+    }
+    if(h.version!=LEDGER_VERSION || h.rec_size!=sizeof(LedgerRec)){
+        fprintf(stderr, "%s: nieobsługiwana wersja %u (rekord %u B)\n",
+                path, h.version, h.rec_size);
+        fclose(f);
+        return -1;
+    }
+
+    LedgerRec buf[1024];
+    size_t n;
+    while((n = fread(buf, sizeof(LedgerRec), 1024, f)) > 0){
+        for(size_t i=0; i<n; i++){
+            LedgerRec *r = &buf[i];
+            add(&total, r);
+            if(r->boat < MAX_BOAT) add(&by_boat[r->boat], r);
+            add(&by_disc[r->disc==0 ? 0 : r->disc==50 ? 1 : r->disc==100 ? 2 : 3], r);
+
+            /* rekordy są w kolejności czasu - zwykle ta sama godzina co poprzednio */
+            long long hr = (r->ts_us/1000000) / 3600;
+            int k = nhours-1;
+            while(k>=0 && hours[k].hour!=hr) k--;
+            if(k<0 && nhours<MAX_HOURS){
+                k = nhours++;
+                hours[k].hour = hr;
+            }
+            if(k>=0) add(&hours[k].s, r);
+
+            if(!first_ts || r->ts_us < first_ts) first_ts = r->ts_us;
+            if(r->ts_us > last_ts) last_ts = r->ts_us;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = (argc>1) ? argv[1] : LEDGER_FILE;
+    if(argc<=2){
+        if(load_ledger(path)<0) return 1;
+    } else {
+        for(int i=1; i<argc; i++){
+            if(load_ledger(argv[i])<0) return 1;
+        }
+        path = "(wiele plików)";
+    }
+
+    printf("Rejestr %s: %ld sprzedaży", path, total.count);
+    if(total.count>0){
+        printf(" w %.1f s", (last_ts - first_ts)/1e6);
+    }
+    printf("\n");
+    print_row("RAZEM", &total);
+
+    printf("\nWg łodzi:\n");
+    for(int b=0; b<MAX_BOAT; b++){
+        if(!by_boat[b].count) continue;
+        char lbl[32];
+        snprintf(lbl, sizeof(lbl), "łódź %d", b);
+        print_row(lbl, &by_boat[b]);
+    }
+
+    printf("\nWg zniżki:\n");
+    static const char *disc_lbl[4] = {"normalny (0%)", "powrót (50%)", "maluch (100%)", "inna"};
+    for(int d=0; d<4; d++){
+        if(by_disc[d].count) print_row(disc_lbl[d], &by_disc[d]);
+    }
+
+    printf("\nWg godziny:\n");
+    for(int i=0; i<nhours; i++){
+        time_t t = (time_t)(hours[i].hour*3600);
+        struct tm tm;
+        localtime_r(&t, &tm);
+        char lbl[32];
+        strftime(lbl, sizeof(lbl), "%Y-%m-%d %H:00", &tm);
+        print_row(lbl, &hours[i].s);
+    }
+    return 0;
+}
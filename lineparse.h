@@ -0,0 +1,173 @@
+/*******************************************************
+ * File: lineparse.h
+ *
+ * Parsowanie komend tekstowych w miejscu - na zakresie [p,end)
+ * wewnątrz bufora odczytu, bez kopiowania linii i bez sscanf.
+ * Używane przez pętle wejścia sternika i kasjera oraz mikrobenchmarki.
+ * Każdy odczyt jest ograniczony przez end - linia nie musi kończyć się '\0'.
+ ******************************************************/
+
+#ifndef LINEPARSE_H
+#define LINEPARSE_H
+
+#include <string.h>
+
+#include "passqueue.h"
+
+/* Długość nazwy FIFO pasażera (z '\0') - jak w PassengerItem */
+#define FIFO_NAME_MAX ((int)sizeof(((PassengerItem*)0)->pass_fifo))
+
+/* Sparsowana komenda QUEUE/QUEUE_SKIP/QUEUE_GROUP[_SKIP] - fifo wskazuje
+   do readbuf; pojedynczy pasażer: size = 1 */
+typedef struct {
+    int  skip;
+    int  pid, bno, disc;
+    int  size, member[GROUP_MAX];
+    const char *fifo;
+    int  fifo_len;
+    const char *why;   // wynik wstawiania: NULL = przyjęty, inaczej powód odrzucenia
+} QueueRec;
+
+static const char *skip_ws(const char *p, const char *end)
+{
+    while(p<end && (*p==' ' || *p=='\t')) p++;
+    return p;
+}
+
+/* Liczba całkowita ze znakiem; NULL gdy brak cyfr lub przepełnienie */
+static const char *parse_int(const char *p, const char *end, int *out)
+{
+    p = skip_ws(p, end);
+    int neg = 0;
+    if(p<end && (*p=='-' || *p=='+')){
+        neg = (*p=='-');
+        p++;
+    }
+    if(p>=end || *p<'0' || *p>'9') return NULL;
+    long v = 0;
+    while(p<end && *p>='0' && *p<='9'){
+        v = v*10 + (*p - '0');
+        if(v > 0x7fffffffL) return NULL;
+        p++;
+    }
+    *out = neg ? (int)-v : (int)v;
+    return p;
+}
+
+/* Nazwa FIFO (do spacji) - fifo wskazuje do bufora; koniec nazwy */
+static const char *parse_word(const char *p, const char *end, const char **w, int *len)
+{
+    p = skip_ws(p, end);
+    const char *f = p;
+    while(p<end && *p!=' ' && *p!='\t') p++;
+    *w = f;
+    *len = (int)(p - f);
+    return p;
+}
+
+/* "QUEUE[_SKIP] pid boat disc pass_fifo" albo bilet grupowy
+   "QUEUE_GROUP[_SKIP] gid boat disc n pid1 .. pidn pass_fifo" w zakresie [p,end).
+   Zwraca 1 - poprawna komenda, 0 - to nie QUEUE, -1 - błędny format. */
+static int parse_queue_line(const char *p, const char *end, QueueRec *r)
+{
+    if(end-p < 5 || memcmp(p, "QUEUE", 5)) return 0;
+    p += 5;
+    int group = 0;
+    if(end-p >= 6 && !memcmp(p, "_GROUP", 6)){
+        group = 1;
+        p += 6;
+    }
+    r->skip = 0;
+    if(end-p >= 5 && !memcmp(p, "_SKIP", 5)){
+        r->skip = 1;
+        p += 5;
+    }
+    if((p = parse_int(p, end, &r->pid))==NULL) return -1;
+    if((p = parse_int(p, end, &r->bno))==NULL) return -1;
+    if((p = parse_int(p, end, &r->disc))==NULL) return -1;
+    r->size = 1;
+    if(group){
+        if((p = parse_int(p, end, &r->size))==NULL) return -1;
+        if(r->size < 1 || r->size > GROUP_MAX) return -1;
+        for(int i=0; i<r->size; i++){
+            if((p = parse_int(p, end, &r->member[i]))==NULL) return -1;
+        }
+    }
+    parse_word(p, end, &r->fifo, &r->fifo_len);
+    if(r->fifo_len<=0 || r->fifo_len >= FIFO_NAME_MAX) return -1;
+    return 1;
+}
+
+/* Sparsowana komenda BUY - fifo wskazuje do bufora odczytu */
+typedef struct {
+    int  pid, age, group;
+    const char *fifo;   // fifo_len == 0 -> nie podano
+    int  fifo_len;
+} BuyRec;
+
+/* Sparsowana komenda BUY_GROUP - bilet dla całej grupy */
+typedef struct {
+    int  group, n;
+    int  pid[GROUP_MAX], age[GROUP_MAX];
+    const char *fifo;
+    int  fifo_len;
+} BuyGroupRec;
+
+/* "BUY pid age group [pass_fifo]" w zakresie [p,end).
+   Zwraca 1 - poprawna komenda, 0 - to nie BUY, -1 - błędny format. */
+static int parse_buy_line(const char *p, const char *end, BuyRec *r)
+{
+    if(end-p < 3 || memcmp(p, "BUY", 3) || (end-p > 3 && p[3]=='_')) return 0;
+    p += 3;
+    if((p = parse_int(p, end, &r->pid))==NULL) return -1;
+    if((p = parse_int(p, end, &r->age))==NULL) return -1;
+    if((p = parse_int(p, end, &r->group))==NULL) return -1;
+    parse_word(p, end, &r->fifo, &r->fifo_len);
+    if(r->fifo_len >= FIFO_NAME_MAX) return -1;
+    return 1;
+}
+
+/* "BUY_GROUP gid n pid1 age1 .. pidn agen pass_fifo" w zakresie [p,end).
+   1 / 0 / -1 jak wyżej. */
+static int parse_buy_group_line(const char *p, const char *end, BuyGroupRec *r)
+{
+    if(end-p < 9 || memcmp(p, "BUY_GROUP", 9)) return 0;
+    p += 9;
+    if((p = parse_int(p, end, &r->group))==NULL) return -1;
+    if((p = parse_int(p, end, &r->n))==NULL) return -1;
+    if(r->n < 1 || r->n > GROUP_MAX) return -1;
+    for(int i=0; i<r->n; i++){
+        if((p = parse_int(p, end, &r->pid[i]))==NULL) return -1;
+        if((p = parse_int(p, end, &r->age[i]))==NULL) return -1;
+    }
+    parse_word(p, end, &r->fifo, &r->fifo_len);
+    if(r->fifo_len<=0 || r->fifo_len >= FIFO_NAME_MAX) return -1;
+    return 1;
+}
+
+/* Najwięcej łodzi w jednej linii CREDIT - linia (~1 KB) mieści się
+   w PIPE_BUF, więc zapis sternika nie przeplata się z BUY pasażerów */
+#define CREDIT_CHUNK 256
+
+/* "CREDIT c1 .. cn" albo kawałek dużej floty "CREDIT @from c_from .."
+   (sternik -> kasjer): *from - numer pierwszej łodzi, c[] - kredyty.
+   Zwraca n (1..CREDIT_CHUNK), 0 - to nie CREDIT, -1 - błędny format. */
+static int parse_credit_line(const char *p, const char *end, int *from, int *c)
+{
+    if(end-p < 6 || memcmp(p, "CREDIT", 6)) return 0;
+    p = skip_ws(p + 6, end);
+    *from = 1;
+    if(p<end && *p=='@'){
+        if((p = parse_int(p+1, end, from))==NULL || *from < 1) return -1;
+    }
+    int n = 0;
+    for(;;){
+        p = skip_ws(p, end);
+        if(p==end) break;
+        if(n==CREDIT_CHUNK || (p = parse_int(p, end, &c[n]))==NULL) return -1;
+        n++;
+    }
+    return n>0 ? n : -1;
+}
+
+#endif
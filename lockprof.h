@@ -0,0 +1,191 @@
+/*******************************************************
+ * File: lockprof.h
+ *
+ * Opcjonalny profiler blokad: dla każdego miejsca wywołania (site)
+ * histogram czasu czekania na mutex i czasu jego trzymania.
+ * Włączany zmienną LOCKPROF=1 (lp_init); bez niej lp_lock/lp_unlock to
+ * zwykłe pthread_mutex_lock/unlock plus jeden test flagi.
+ *
+ * Każdy wątek ma własne liczniki (tworzone przy pierwszej blokadzie,
+ * wpinane raz do listy globalnej), więc pomiar nie dokłada współdzielenia
+ * linii pamięci. Histogramy log2 w ns (przedział i: [2^i, 2^(i+1)) ns).
+ * lp_dump sumuje wątki - w trakcie pracy wynik jest przybliżony
+ * (liczniki czytane bez zatrzymywania wątków).
+ *
+ * Użycie:
+ *   LpHeld h = lp_lock(&m);
+ *   ...
+ *   lp_unlock(&m, h, SITE);   // miejsce można wybrać dopiero pod blokadą
+ ******************************************************/
+
+#ifndef LOCKPROF_H
+#define LOCKPROF_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOCKPROF_ENV  "LOCKPROF"
+#define LP_MAX_SITES  32
+#define LP_BUCKETS    40        // do 2^40 ns (~18 min)
+
+typedef struct {
+    _Atomic uint64_t n, wait_sum, hold_sum, wait_max, hold_max;
+    _Atomic uint32_t wait_h[LP_BUCKETS], hold_h[LP_BUCKETS];
+} LpSite;
+
+typedef struct LpThread {
+    struct LpThread *next;
+    int id;
+    LpSite site[LP_MAX_SITES];
+} LpThread;
+
+typedef struct {
+    long long t_acq;   // chwila zajęcia (ns), 0 - profiler wyłączony
+    long long wait;    // czekanie na zajęcie (ns)
+} LpHeld;
+
+static int              lp_on = 0;
+static const char      *const *lp_names;
+static int              lp_nsites;
+static LpThread        *lp_threads;
+static int              lp_nthreads;
+static pthread_mutex_t  lp_list_mu = PTHREAD_MUTEX_INITIALIZER;
+static __thread LpThread *lp_me;
+
+/* Nazwy miejsc (indeks = site); włącza profiler, jeśli LOCKPROF=1 */
+static void lp_init(const char *const *names, int nsites)
+{
+    const char *e = getenv(LOCKPROF_ENV);
+    lp_names  = names;
+    lp_nsites = nsites < LP_MAX_SITES ? nsites : LP_MAX_SITES;
+    lp_on     = e && *e && *e != '0';
+}
+
+static long long lp_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+static LpThread *lp_thread(void)
+{
+    if(lp_me) return lp_me;
+    LpThread *t = calloc(1, sizeof(*t));
+    if(!t) return NULL;
+    pthread_mutex_lock(&lp_list_mu);
+    t->id = ++lp_nthreads;
+    t->next = lp_threads;
+    lp_threads = t;
+    pthread_mutex_unlock(&lp_list_mu);
+    lp_me = t;
+    return t;
+}
+
+static int lp_bucket(long long ns)
+{
+    int b = 0;
+    while(ns > 1 && b < LP_BUCKETS-1){
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/* Pisze tylko właściciel wątku - wystarczy load+store (bez lock add) */
+#define LP_ADD(x, v)  atomic_store_explicit(&(x), atomic_load_explicit(&(x), memory_order_relaxed) + (v), \
+                                            memory_order_relaxed)
+#define LP_MAX(x, v)  do{ if((uint64_t)(v) > atomic_load_explicit(&(x), memory_order_relaxed)) \
+                              atomic_store_explicit(&(x), (v), memory_order_relaxed); }while(0)
+
+static LpHeld lp_lock(pthread_mutex_t *m)
+{
+    LpHeld h = {0, 0};
+    if(!lp_on){
+        pthread_mutex_lock(m);
+        return h;
+    }
+    long long t0 = lp_ns();
+    pthread_mutex_lock(m);
+    h.t_acq = lp_ns();
+    h.wait  = h.t_acq - t0;
+    return h;
+}
+
+static void lp_unlock(pthread_mutex_t *m, LpHeld h, int site)
+{
+    if(!h.t_acq){
+        pthread_mutex_unlock(m);
+        return;
+    }
+    long long hold = lp_ns() - h.t_acq;
+    pthread_mutex_unlock(m);
+
+    LpThread *t = lp_thread();
+    if(!t || site < 0 || site >= lp_nsites) return;
+    LpSite *s = &t->site[site];
+    LP_ADD(s->n, 1);
+    LP_ADD(s->wait_sum, h.wait);
+    LP_ADD(s->hold_sum, hold);
+    LP_MAX(s->wait_max, h.wait);
+    LP_MAX(s->hold_max, hold);
+    LP_ADD(s->wait_h[lp_bucket(h.wait)], 1);
+    LP_ADD(s->hold_h[lp_bucket(hold)], 1);
+}
+
+/* Percentyl z histogramu log2 - górna granica przedziału, nie ponad max */
+static double lp_pct_us(const uint64_t *h, uint64_t n, uint64_t max, double pct)
+{
+    uint64_t want = (uint64_t)(pct / 100.0 * n + 0.5), acc = 0;
+    if(want < 1) want = 1;
+    for(int i=0; i<LP_BUCKETS; i++){
+        acc += h[i];
+        if(acc >= want){
+            uint64_t up = 2ULL << i;
+            return (up > max ? max : up) / 1000.0;
+        }
+    }
+    return max / 1000.0;
+}
+
+/* Zestawienie wszystkich miejsc (suma po wątkach); czasy w µs */
+static void lp_dump(FILE *f, const char *tag)
+{
+    if(!lp_on) return;
+    pthread_mutex_lock(&lp_list_mu);
+    fprintf(f, "[%s] blokady: %d wątków; czekanie i trzymanie w us (avg p50 p99 max)\n",
+            tag, lp_nthreads);
+    for(int s=0; s<lp_nsites; s++){
+        uint64_t n = 0, ws = 0, hs = 0, wm = 0, hm = 0;
+        uint64_t wh[LP_BUCKETS] = {0}, hh[LP_BUCKETS] = {0};
+        for(LpThread *t = lp_threads; t; t = t->next){
+            LpSite *x = &t->site[s];
+            n  += atomic_load_explicit(&x->n, memory_order_relaxed);
+            ws += atomic_load_explicit(&x->wait_sum, memory_order_relaxed);
+            hs += atomic_load_explicit(&x->hold_sum, memory_order_relaxed);
+            uint64_t v = atomic_load_explicit(&x->wait_max, memory_order_relaxed);
+            if(v > wm) wm = v;
+            v = atomic_load_explicit(&x->hold_max, memory_order_relaxed);
+            if(v > hm) hm = v;
+            for(int i=0; i<LP_BUCKETS; i++){
+                wh[i] += atomic_load_explicit(&x->wait_h[i], memory_order_relaxed);
+                hh[i] += atomic_load_explicit(&x->hold_h[i], memory_order_relaxed);
+            }
+        }
+        if(n == 0) continue;
+        fprintf(f, "[%s] %-24s n=%-8llu czekanie %8.1f %8.1f %8.1f %9.1f (suma %.1fms)"
+                   "  trzymanie %8.1f %8.1f %8.1f %9.1f\n",
+                tag, lp_names[s], (unsigned long long)n,
+                ws / 1000.0 / n, lp_pct_us(wh, n, wm, 50), lp_pct_us(wh, n, wm, 99), wm / 1000.0,
+                ws / 1e6,
+                hs / 1000.0 / n, lp_pct_us(hh, n, hm, 50), lp_pct_us(hh, n, hm, 99), hm / 1000.0);
+    }
+    pthread_mutex_unlock(&lp_list_mu);
+    fflush(f);
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*******************************************************
+ * File: orchctl.c
+ *
+ * Klient gniazda sterującego orchestratora (control.h).
+ * Każdy argument to jedna komenda; odpowiedzi na stdout.
+ *
+ * Użycie: ./orchctl [-s gniazdo] KOMENDA [KOMENDA ...]
+ *   gniazdo domyślnie w SIM_RUN_DIR (rundir.h), jeśli ustawiona
+ *   np.   ./orchctl "INTERVAL 250" "BATCH 5 10" STATS
+ * Kod wyjścia: 0 - wszystkie OK, 1 - któraś ERR, 2 - brak połączenia.
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "control.h"
+#include "rundir.h"
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    int i = 1;
+    if(argc > 2 && !strcmp(argv[1], "-s")){
+        path = argv[2];
+        i = 3;
+    }
+    if(i >= argc){
+        fprintf(stderr, "Użycie: %s [-s gniazdo] KOMENDA [KOMENDA ...]\n", argv[0]);
+        return 1;
+    }
+
+    if(!path){
+        path = CTL_SOCKET;
+        if(rundir_enter(0) < 0){
+            perror(RUN_DIR_ENV);
+            return 2;
+        }
+    }
+    int fd = ctl_connect(path);
+    if(fd < 0){
+        perror(path);
+        return 2;
+    }
+
+    int rc = 0;
+    char buf[4096];
+    size_t len = 0;
+    for(; i<argc; i++){
+        char line[512];
+        int m = snprintf(line, sizeof(line), "%s\n", argv[i]);
+        if(m >= (int)sizeof(line) || write(fd, line, m) != m){
+            fprintf(stderr, "%s: za długa komenda albo błąd zapisu\n", argv[i]);
+            rc = 1;
+            break;
+        }
+        /* jedna linia odpowiedzi na komendę */
+        char *nl;
+        while(!(nl = memchr(buf, '\n', len))){
+            ssize_t n = read(fd, buf + len, sizeof(buf) - 1 - len);
+            if(n <= 0){
+                fprintf(stderr, "%s: orchestrator zamknął połączenie\n", argv[i]);
+                close(fd);
+                return 2;
+            }
+            len += n;
+        }
+        fwrite(buf, 1, nl - buf + 1, stdout);
+        if(strncmp(buf, "OK", 2)) rc = 1;
+        len -= nl - buf + 1;
+        memmove(buf, nl + 1, len);
+    }
+    close(fd);
+    return rc;
+}
@@ -5,6 +5,20 @@
  *   p -> uruchom policjanta
  *   q -> zakończ symulację
  *
+ * Sterowanie w trakcie symulacji: gniazdo UNIX CTL_SOCKET (control.h,
+ * klient ./orchctl) - tempo i wielkość tur generatora, pauza, policjant,
+ * liczniki, zrzut stanu. Obsługiwane w pętli głównej razem ze stdin.
+ *
+ * Liczba kasjerów: zmienna KASJER_SHARDS (domyślnie 1, patrz shard.h).
+ *
+ * Katalog przebiegu: ./orchestrator [katalog] albo SIM_RUN_DIR (rundir.h) -
+ * wszystkie pliki symulacji powstają tam, programy są brane z katalogu
+ * orchestratora. ORCH_INTERVAL_MS - początkowa przerwa bazowa generatora.
+ * Na koniec podsumowanie (liczniki jak STATS) trafia do SUMMARY_FILE.
+ *
+ * Gdy sternik padnie (sygnał / błąd), orchestrator uruchamia go ponownie
+ * (max MAX_RESTARTS razy) - nowy sternik wznawia kolejki z pliku stanu.
+ *
  ******************************************************/
 
 #include <stdio.h>
@@ -20,44 +34,89 @@
 #include <pthread.h>
 #include <sys/stat.h>
 #include <sys/select.h>
-
-/* Ścieżki do plików wykonywalnych */
-#define PATH_STERNIK   "./sternik"
-#define PATH_KASJER    "./kasjer"
-#define PATH_PASAZER   "./pasazer"
-#define PATH_POLICJANT "./policjant"
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "trace.h"
+#include "chrome_trace.h"
+#include "shard.h"
+#include "registry.h"
+#include "control.h"
+#include "rundir.h"
+#include "passqueue.h"
+
+/* Ścieżki do plików wykonywalnych - obok orchestratora (bin_path),
+   ustalane w main, bo cwd to katalog przebiegu */
+static char path_sternik[PATH_MAX], path_kasjer[PATH_MAX];
+static char path_pasazer[PATH_MAX], path_policjant[PATH_MAX];
+
+/* Podsumowanie przebiegu (dla sweep) */
+#define SUMMARY_FILE "orchestrator.summary"
+#define INTERVAL_ENV "ORCH_INTERVAL_MS"
 
 /* Nazwane FIFO */
 #define FIFO_STERNIK_IN  "fifo_sternik_in"
-#define FIFO_KASJER_IN   "fifo_kasjer_in"
 
-/* Maksymalna liczba pasażerów */
-#define MAX_PASS 2000
+/* Plik stanu sternika (checkpoint) i limit restartów po awarii */
+#define STERNIK_STATE    "sternik.state"
+#define MAX_RESTARTS     3
+
+#define BASE_PID 1000 // pid bazowy (kolejni pasażerowie: BASE_PID, BASE_PID+1, ...)
+/* Kontrola przeciążenia: max żyjących procesów pasażerów naraz,
+   maksymalny mnożnik przerwy generatora i kody wyjścia pasażera,
+   któremu kasjer/sternik odmówił albo który nie doczekał się odpowiedzi
+   (PASAZER_TIMEOUT, patrz pasazer.c) - oba liczymy jako przeciążenie */
+#define MAX_INFLIGHT 300
+#define MAX_THROTTLE 4
+#define PASS_EXIT_REJECTED 2
+#define PASS_EXIT_TIMEOUT  3
 
-#define MAX_PID 50000 // limit pid-ow
-#define BASE_PID 1000 // pid bazowy
 /* Czas symulacji – ustalany przez usera */
 static int TIMEOUT;
+static time_t sim_start;
+
+/* Nasz koniec fifo_sternik_in (O_RDWR, nic z niego nie czytamy): FIFO ma
+   zawsze czytelnika, więc gdy sternik leży, pasażerowie nie blokują się,
+   a ich komendy czekają w buforze na nowego sternika. */
+static int fd_sternik_hold = -1;
+static int sternik_restarts = 0;
 
 /* Flaga zakończenia */
 static volatile sig_atomic_t end_all = 0;
 
-/* Parametry sterujące generowaniem pasażerów */
-static int g_min_batch = 3;  /* minimalna liczba pasażerów (normal) w jednej turze */
-static int g_max_batch = 7;  /* maksymalna liczba pasażerów (normal) w jednej turze */
+/* Parametry sterujące generowaniem pasażerów (zmieniane przez gniazdo
+   sterujące z wątku głównego, czytane przez generator) */
+static volatile int g_min_batch = 3;  /* minimalna liczba pasażerów (normal) w jednej turze */
+static volatile int g_max_batch = 7;  /* maksymalna liczba pasażerów (normal) w jednej turze */
+static volatile int g_round_ms  = 1000; /* przerwa bazowa między turami (x1-2 losowo, x spowolnienie) */
+static volatile int g_paused    = 0;    /* 1 -> generator nie tworzy nowych pasażerów */
+static volatile int g_throttle  = 1;    /* bieżące spowolnienie generatora (do STATS) */
+#define ROUND_MS_MIN  10
+#define ROUND_MS_MAX  60000
+#define BATCH_MAX     100
 
 /* Licznik wszystkich wygenerowanych pasażerów */
 static int total_generated = 0; 
 
-static int passenger_pids[MAX_PASS+1];
-static int passenger_pids_count = 0; /// do czyszczenia fifo
-
 /* PID-y procesów: sternik, kasjer, policjant, pasażerowie */
 static pid_t pid_sternik = 0;
-static pid_t pid_kasjer  = 0;
+static pid_t pid_kasjer[KASJER_SHARDS_MAX];
+static int   nkasjer = 1;
 static pid_t pid_policjant = 0;
-static pid_t p_pass[MAX_PASS];
-static int   pass_count = 0;
+
+/* Żyjące procesy pasażerów (proces + id pasażera - do sprzątania FIFO).
+   Tablica rośnie w miarę potrzeb; reap_passengers usuwa zakończonych,
+   więc jej rozmiar to liczba pasażerów w systemie, nie wszystkich. */
+typedef struct {
+    pid_t proc;
+    int   pid;
+} PassProc;
+static PassProc *p_pass = NULL;
+static int   pass_count = 0, pass_cap = 0;
+static pthread_mutex_t pass_mu = PTHREAD_MUTEX_INITIALIZER;
+static int   pass_alive = 0;   /* ilu pasażerów jeszcze działa (po reap_passengers) */
+static int   pass_rejected = 0; /* ilu pasażerom odmówiono (przeciążenie) */
+static int   pass_timeouts = 0; /* ilu zrezygnowało po PASAZER_TIMEOUT */
 
 /* Wątek generatora i flaga sterująca jego pracą */
 static pthread_t generator_thread;
@@ -69,6 +128,7 @@ static pthread_t time_killer_thread;
 /* Deklaracje funkcji */
 void end_simulation(void);
 void cleanup_fifo(void);
+static void write_summary(void);
 
 /* Deklaracja (prototyp) */
 static pid_t run_child(const char *cmd, char *const argv[]);
@@ -91,145 +151,235 @@ static pid_t run_child(const char *cmd, char *const argv[])
 
 
 /* ------------------------------- */
-/* Funkcja tworząca pasażera z (pid,age,group) */
-static void run_passenger(int pid, int age, int group)
+/* Funkcja tworząca proces pasażera dla biletu: pojedynczy (n = 1)
+   albo grupowy - jeden proces za całą grupę (pasazer id age group id2 age2 ..) */
+static void run_ticket(const int *pid, const int *age, int n, int group)
 {
-    if (pass_count >= MAX_PASS) {
-        printf("[ORCH] Osiągnięto MAX_PASS.\n");
+    /* pod pass_mu aż do zapisania procesu: end_simulation (też pod pass_mu)
+       widzi wtedy każdego uruchomionego, a po nim nikt nowy nie startuje */
+    pthread_mutex_lock(&pass_mu);
+    if (end_all) {
+        pthread_mutex_unlock(&pass_mu);
         return;
     }
-    char arg1[32], arg2[32], arg3[32];
-    sprintf(arg1, "%d", pid);
-    sprintf(arg2, "%d", age);
-    sprintf(arg3, "%d", group);
-
-    char *args[] = { (char*)PATH_PASAZER, arg1, arg2, arg3, NULL };
+    if (pass_count == pass_cap) {
+        int ncap = pass_cap ? pass_cap * 2 : 256;
+        PassProc *np = realloc(p_pass, ncap * sizeof(PassProc));
+        if (!np) {
+            pthread_mutex_unlock(&pass_mu);
+            perror("[ORCH] realloc p_pass");
+            return;
+        }
+        p_pass = np;
+        pass_cap = ncap;
+    }
+
+    char argbuf[2 * GROUP_MAX + 1][16];
+    char *args[2 * GROUP_MAX + 3];
+    int na = 0;
+    args[na++] = path_pasazer;
+    for (int i = 0; i < n; i++) {
+        sprintf(argbuf[2 * i], "%d", pid[i]);
+        sprintf(argbuf[2 * i + 1], "%d", age[i]);
+        args[na++] = argbuf[2 * i];
+        args[na++] = argbuf[2 * i + 1];
+        if (i == 0) {
+            sprintf(argbuf[2 * GROUP_MAX], "%d", group);
+            args[na++] = argbuf[2 * GROUP_MAX];
+        }
+    }
+    args[na] = NULL;
 
     pid_t c = fork();
     if (c == 0) {
         /* Proces potomny -> pasazer */
-        execv(PATH_PASAZER, args);
+        execv(path_pasazer, args);
         perror("[ORCH] execv pasazer");
         _exit(1);
     } else if (c > 0) {
-        p_pass[pass_count++] = c;
-        passenger_pids[passenger_pids_count++] = pid;
-        printf("[ORCH] Passenger pid=%d age=%d group=%d -> procPID=%d\n",
-               pid, age, group, c);
-        total_generated++;
+        p_pass[pass_count].proc = c;
+        p_pass[pass_count].pid  = pid[0];
+        pass_count++;
+        for (int i = 0; i < n; i++) {
+            trace_ev(TE_SPAWN, pid[i], 0, age[i], group);
+            if (ct_fd >= 0) {
+                char args[64];
+                snprintf(args, sizeof(args), "\"pid\":%d,\"wiek\":%d,\"grupa\":%d",
+                         pid[i], age[i], group);
+                ct_instant("pasażer", "orch", 1, args);
+            }
+            printf("[ORCH] Passenger pid=%d age=%d group=%d -> procPID=%d\n",
+                   pid[i], age[i], group, c);
+        }
+        total_generated += n;
     } else {
         perror("[ORCH] fork pass");
     }
+    pthread_mutex_unlock(&pass_mu);
 }
 
+static void run_passenger(int pid, int age, int group)
+{
+    run_ticket(&pid, &age, 1, group);
+}
+
+
+/* ------------------------------- */
+/* Zbiera zakończonych pasażerów (bez blokowania), liczy żyjących.
+   Zwraca, ilu z nich skończyło z odmową albo po limicie czekania. */
+static int reap_passengers(void)
+{
+    int rejected = 0, timeouts = 0;
+    pthread_mutex_lock(&pass_mu);
+    for (int i = 0; i < pass_count; ) {
+        int st;
+        pid_t w = waitpid(p_pass[i].proc, &st, WNOHANG);
+        if (w == p_pass[i].proc) {
+            if (WIFEXITED(st) && WEXITSTATUS(st) == PASS_EXIT_REJECTED) rejected++;
+            if (WIFEXITED(st) && WEXITSTATUS(st) == PASS_EXIT_TIMEOUT)  timeouts++;
+            p_pass[i] = p_pass[--pass_count];   // zakończony - na jego miejsce ostatni
+        } else {
+            i++;
+        }
+    }
+    pass_alive = pass_count;
+    pthread_mutex_unlock(&pass_mu);
+    pass_rejected += rejected;
+    pass_timeouts += timeouts;
+    return rejected + timeouts;
+}
 
 /* ------------------------------- */
 /* Wątek generatora pasażerów */
-typedef struct {
-    int pid;
-    int group;
-    int age;  // Dodano pole do przechowywania wieku
-} PidEntry;
+
+/* Wszyscy wygenerowani pasażerowie - kandydaci do powrotu (registry.h) */
+static Registry reg;
+static int next_pid = BASE_PID;
+
+/* Nowa grupa (dziecko + rodzic): id grupy = id dziecka */
+static void new_group(int child_age)
+{
+    int child_pid  = next_pid++;
+    int parent_pid = next_pid++;
+    int grp = child_pid;
+    int parent_age = rand() % 50 + 20;   // rodzic 20-69
+
+    reg_add(&reg, child_pid, child_age, grp);
+    reg_add(&reg, parent_pid, parent_age, grp);
+    int pid[2] = { child_pid, parent_pid }, age[2] = { child_age, parent_age };
+    run_ticket(pid, age, 2, grp);   // bilet grupowy - jeden wpis w kolejce
+}
+
+/* Przerwa po turze: mult x g_round_ms x throttle, odcinkami po 100 ms,
+   żeby zmiana INTERVAL, pauza i koniec symulacji działały od razu */
+static void generator_pause(int mult, int throttle)
+{
+    for (long waited = 0; !end_all && generator_running && !g_paused &&
+                          waited < (long)mult * g_round_ms * throttle; waited += 100) {
+        long left = (long)mult * g_round_ms * throttle - waited;
+        usleep((left < 100 ? left : 100) * 1000);
+    }
+}
 
 void *generator_func(void *arg) {
-    static PidEntry used_pids[20000];
-    static int used_count = 0;
-    int base_pid = BASE_PID;
+    int throttle = 1; /* mnożnik przerwy między turami (1..MAX_THROTTLE) */
 
     srand(time(NULL) ^ getpid());
+    if (reg_init(&reg) < 0) {
+        perror("[ORCH] rejestr pasażerów");
+        return NULL;
+    }
 
     while (!end_all && generator_running) {
-        if (pass_count >= MAX_PASS) {
-            printf("[ORCH] Osiągnięto MAX_PASS, kończę generowanie pasażerów.\n");
-            break;
+        /* Backpressure: odmowy od kasjera/sternika -> zwalniamy dwukrotnie,
+           spokojne tury -> wracamy powoli do normalnego tempa. */
+        int rejected = reap_passengers();
+        if (rejected > 0) {
+            if (throttle < MAX_THROTTLE) throttle *= 2;
+            printf("[GEN] %d odmów/rezygnacji (przeciążenie) -> zwalniam x%d\n", rejected, throttle);
+        } else if (throttle > 1) {
+            throttle--;
+        }
+        g_throttle = throttle;
+        if (g_paused) {
+            usleep(100000);
+            continue;
+        }
+        if (pass_alive >= MAX_INFLIGHT) {
+            printf("[GEN] %d pasażerów w systemie -> wstrzymuję generowanie\n", pass_alive);
+            usleep(200000);
+            continue;
         }
 
         int dice = rand() % 3;
+        long long ct_t0 = ct_now_us();
+        int ct_gen0 = total_generated;
 
         if (dice == 0) {
             // Nowa grupa (dziecko + rodzic)
-            int grp = base_pid + used_count;
-            int child_pid = grp;
-            int parent_pid = grp + 30000;
-
-            // Generuj i zapisz wiek dziecka
-            int child_age = rand() % 14 + 1;
-            used_pids[used_count] = (PidEntry){child_pid, grp, child_age};
-            used_count++;
-            run_passenger(child_pid, child_age, grp);
-
-            // Generuj i zapisz wiek rodzica
-            int parent_age = rand() % 50 + 20;
-            used_pids[used_count] = (PidEntry){parent_pid, grp, parent_age};
-            used_count++;
-            run_passenger(parent_pid, parent_age, grp);
-
-        } else if (dice == 1 && used_count > 0) {
+            new_group(rand() % 14 + 1);
+
+        } else if (dice == 1 && reg.count > 0) {
             // Powrót pasażera/grupy (użyj ZAPISANEGO wieku dla grup)
-            int idx = rand() % used_count;
-            int old_group = used_pids[idx].group;
-
-            if (old_group != 0) {
-                printf("[GEN] WRACA GRUPA %d (oryginalne wieku)\n", old_group);
-                for (int i = 0; i < used_count; i++) {
-                    if (used_pids[i].group == old_group) {
-                        // Użyj ZAPISANEGO wieku zamiast losować nowy
-                        run_passenger(used_pids[i].pid, used_pids[i].age, old_group);
-                    }
+            RegEntry *e = reg_at(&reg, (size_t)rand() % reg.count);
+            RegGroup *g = reg_group(&reg, e->group);
+
+            if (g) {
+                printf("[GEN] WRACA GRUPA %d (oryginalne wieku)\n", g->group);
+                int pid[GROUP_MAX], age[GROUP_MAX], n = 0;
+                for (int i = g->head; i >= 0 && n < GROUP_MAX; i = reg_at(&reg, i)->next) {
+                    RegEntry *m = reg_at(&reg, i);
+                    // Użyj ZAPISANEGO wieku zamiast losować nowy
+                    pid[n] = m->pid;
+                    age[n] = m->age;
+                    n++;
                 }
+                run_ticket(pid, age, n, g->group);
             } else {
                 // Dla pojedynczych pasażerów: nowy wiek
                 int new_age = rand() % 80 + 1;
-                printf("[GEN] WRACA POJEDYNCZY pid=%d (nowy wiek=%d)\n", used_pids[idx].pid, new_age);
-                run_passenger(used_pids[idx].pid, new_age, 0);
+                printf("[GEN] WRACA POJEDYNCZY pid=%d (nowy wiek=%d)\n", e->pid, new_age);
+                run_passenger(e->pid, new_age, 0);
             }
 
         } else {
             // Partia pasażerów (tylko grupy dziecko+rodzic)
-            int how_many = rand() % (g_max_batch - g_min_batch + 1) + g_min_batch;
+            int lo = g_min_batch, hi = g_max_batch;
+            if (hi < lo) hi = lo;   // BATCH w trakcie zmiany obu wartości
+            int how_many = rand() % (hi - lo + 1) + lo;
             for (int i = 0; i < how_many; i++) {
                 int age = rand() % 80 + 1;
 
                 if (age < 15) {
-                    int grp = base_pid + used_count;
-                    int child_pid = grp;
-                    int parent_pid = grp + 30000;
-
-                    // Zapisz dziecko
-                    used_pids[used_count] = (PidEntry){child_pid, grp, age};
-                    used_count++;
-                    run_passenger(child_pid, age, grp);
-
-                    // Zapisz rodzica (wiek 20-69)
-                    int parent_age = rand() % 50 + 20;
-                    used_pids[used_count] = (PidEntry){parent_pid, grp, parent_age};
-                    used_count++;
-                    run_passenger(parent_pid, parent_age, grp);
+                    new_group(age);
                 } else {
-                    ///ZAKOMENTOWANA CZĘŚĆ DLA POJEDYNCZYCH PASAŻERÓW
-                     int new_pid = base_pid + used_count;
-                     used_pids[used_count] = (PidEntry){new_pid, 0, age};
-                     used_count++;
-                     run_passenger(new_pid, age, 0);
+                    int new_pid = next_pid++;
+                    reg_add(&reg, new_pid, age, 0);
+                    run_passenger(new_pid, age, 0);
                 }
             }
         }
 
-        if (used_count >= MAX_PID) {
-            printf("[GEN] Osiągnięto MAX_PID, stop.\n");
-            break;
+        if (ct_fd >= 0) {
+            char args[48];
+            snprintf(args, sizeof(args), "\"pasazerow\":%d", total_generated - ct_gen0);
+            ct_span("tura generatora", "orch", 1, ct_t0, ct_now_us() - ct_t0, args);
         }
 
-        usleep((rand() % 2 + 1) * 1000000);
+        generator_pause(rand() % 2 + 1, throttle);
     }
 
+    /* rejestr zwalnia main po zakończeniu symulacji (liczniki w podsumowaniu) */
+    printf("[GEN] Rejestr: %zu pasażerów, %zu grup.\n", reg.count, reg.gcount);
     return NULL;
 }
 /* ------------------------------- */
 /* Wątek time_killer -> kończy symulację po TIMEOUT sek. */
 void *time_killer_func(void *arg)
 {
-    sleep(TIMEOUT); // musi byc, nie ma udzial w sumilacji tylko ja konczy
+    // musi byc, nie ma udzial w sumilacji tylko ja konczy; po sekundzie,
+    // żeby wcześniejszy koniec (q, QUIT z gniazda) nie czekał na TIMEOUT
+    for (int t = 0; t < TIMEOUT && !end_all; t++) sleep(1);
 
     if (!end_all) {
         printf("\033[1;31m[ORCH/TIME] Time out =%d -> end.\033[0m\n", TIMEOUT);
@@ -242,19 +392,23 @@ void *time_killer_func(void *arg)
 void cleanup_fifo(void)
 {
     unlink(FIFO_STERNIK_IN);
-    unlink(FIFO_KASJER_IN);
+    for(int k=0; k<nkasjer; k++){
+        char name[64];
+        kasjer_fifo_name(name, sizeof(name), k, nkasjer);
+        unlink(name);
+    }
 }
 
 /* ------------------------------- */
 /* end_simulation -> QUIT do kasjera/sternika, potem kill, czekamy, sprzątamy */
 /* Funkcja do usuwania wszystkich FIFO pasażerów */
+/* (tylko tych, którzy żyli do końca - reszta usuwa swoje FIFO sama) */
 void cleanup_passenger_fifos(void)
 {
-    for(int i = BASE_PID - 1; i < MAX_PID + 1; i++) {
+    for(int i = 0; i < pass_count; i++) {
 
-        //int pid = passenger_pids[passenger_pids_count];
         char fifo_name[64];
-        snprintf(fifo_name, sizeof(fifo_name), "fifo_pasazer_%d", i);
+        snprintf(fifo_name, sizeof(fifo_name), "fifo_pasazer_%d", p_pass[i].pid);
         //printf("czyszcze fifo"); //do potestowania
         if(unlink(fifo_name) == 0){
             //printf("[ORCH] Usunięto FIFO: %s\n", fifo_name);
@@ -273,10 +427,13 @@ void cleanup_passenger_fifos(void)
 void end_simulation(void)
 {
     if (end_all) return;
+    long long ct_t0 = ct_now_us();
     end_all = 1;
     generator_running = 0;  
 
     printf("[ORCH] end_simulation() -> sprawdź, QUIT, kill -TERM, kill -9...\n");
+    printf("[ORCH] Odmowy (przeciążenie): %d, rezygnacje po limicie czekania: %d\n",
+           pass_rejected, pass_timeouts);
     //printf("[ORCH] W sumie wygenerowano %d pasażerów.\n", total_generated);
 
     /* 0) sprawdzamy, kto już nie żyje */
@@ -284,15 +441,19 @@ void end_simulation(void)
         pid_t w = waitpid(pid_policjant, NULL, WNOHANG);
         if (w == pid_policjant) pid_policjant = 0;
     }
-    for(int i=0; i<pass_count; i++){
-        if(p_pass[i] > 0){
-            pid_t w = waitpid(p_pass[i], NULL, WNOHANG);
-            if(w == p_pass[i]) p_pass[i] = 0;
+    pthread_mutex_lock(&pass_mu);
+    for(int i=0; i<pass_count; ){
+        if(waitpid(p_pass[i].proc, NULL, WNOHANG) == p_pass[i].proc){
+            p_pass[i] = p_pass[--pass_count];
+        } else {
+            i++;
         }
     }
-    if(pid_kasjer > 0){
-        pid_t w = waitpid(pid_kasjer, NULL, WNOHANG);
-        if(w == pid_kasjer) pid_kasjer = 0;
+    for(int k=0; k<nkasjer; k++){
+        if(pid_kasjer[k] > 0){
+            pid_t w = waitpid(pid_kasjer[k], NULL, WNOHANG);
+            if(w == pid_kasjer[k]) pid_kasjer[k] = 0;
+        }
     }
     if(pid_sternik > 0){
         pid_t w = waitpid(pid_sternik, NULL, WNOHANG);
@@ -300,13 +461,16 @@ void end_simulation(void)
     }
 
     /* 1) QUIT */
-    if(pid_kasjer > 0){
-        int fk = open(FIFO_KASJER_IN, O_WRONLY);
+    for(int k=0; k<nkasjer; k++){
+        if(pid_kasjer[k] <= 0) continue;
+        char name[64];
+        kasjer_fifo_name(name, sizeof(name), k, nkasjer);
+        int fk = open(name, O_WRONLY);
         if(fk >= 0){
             write(fk, "QUIT\n", 5);
             close(fk);
         }
-        printf("\033[1;32m[ORCH] (QUIT) kasjer pid=%d\033[0m\n", pid_kasjer);
+        printf("\033[1;32m[ORCH] (QUIT) kasjer %d pid=%d\033[0m\n", k, pid_kasjer[k]);
     }
     if(pid_sternik > 0){
         int fs = open(FIFO_STERNIK_IN, O_WRONLY | O_NONBLOCK);
@@ -320,11 +484,11 @@ void end_simulation(void)
     /* 2) SIGTERM */
     if(pid_policjant > 0) kill(pid_policjant, SIGTERM);
     for(int i=0; i<pass_count; i++){
-        if(p_pass[i] > 0){
-            kill(p_pass[i], SIGTERM);
-        }
+        kill(p_pass[i].proc, SIGTERM);
+    }
+    for(int k=0; k<nkasjer; k++){
+        if(pid_kasjer[k] > 0) kill(pid_kasjer[k], SIGTERM);
     }
-    if(pid_kasjer > 0) kill(pid_kasjer, SIGTERM);
     if(pid_sternik > 0) kill(pid_sternik, SIGTERM);
 
     usleep(500000); // pozwala na zamkniecie procesow
@@ -336,15 +500,17 @@ void end_simulation(void)
         }
     }
     for(int i=0; i<pass_count; i++){
-        if(p_pass[i] > 0){
-            if(0 == waitpid(p_pass[i], NULL, WNOHANG)){
-                kill(p_pass[i], SIGKILL);
-            }
+        if(0 == waitpid(p_pass[i].proc, NULL, WNOHANG)){
+            kill(p_pass[i].proc, SIGKILL);
+        } else {
+            p_pass[i].proc = 0;   // już zebrany
         }
     }
-    if(pid_kasjer > 0){
-        if(0 == waitpid(pid_kasjer, NULL, WNOHANG)){
-            kill(pid_kasjer, SIGKILL);
+    for(int k=0; k<nkasjer; k++){
+        if(pid_kasjer[k] > 0){
+            if(0 == waitpid(pid_kasjer[k], NULL, WNOHANG)){
+                kill(pid_kasjer[k], SIGKILL);
+            }
         }
     }
     if(pid_sternik > 0){
@@ -359,21 +525,33 @@ void end_simulation(void)
         pid_policjant = 0;
     }
     for(int i=0; i<pass_count; i++){
-        if(p_pass[i] > 0){
-            waitpid(p_pass[i], NULL, 0);
-            p_pass[i] = 0;
+        if(p_pass[i].proc > 0){
+            waitpid(p_pass[i].proc, NULL, 0);
+            p_pass[i].proc = 0;
         }
     }
-    if(pid_kasjer > 0){
-        waitpid(pid_kasjer, NULL, 0);
-        pid_kasjer = 0;
+    for(int k=0; k<nkasjer; k++){
+        if(pid_kasjer[k] > 0){
+            waitpid(pid_kasjer[k], NULL, 0);
+            pid_kasjer[k] = 0;
+        }
     }
     if(pid_sternik > 0){
         waitpid(pid_sternik, NULL, 0);
         pid_sternik = 0;
     }
     cleanup_passenger_fifos();
+    pass_count = pass_alive = 0;
+    pthread_mutex_unlock(&pass_mu);
+    if(fd_sternik_hold >= 0){
+        close(fd_sternik_hold);
+        fd_sternik_hold = -1;
+    }
     cleanup_fifo();
+    unlink(STERNIK_STATE);
+    write_summary();
+    ct_span("end_simulation", "orch", 0, ct_t0, ct_now_us() - ct_t0, NULL);
+    ct_flush();
     printf("\033[1;32m[ORCH] end_simulation -> done.\033[0m\n");
 }
 
@@ -385,28 +563,34 @@ static void start_sternik(void)
         printf("[ORCH] sternik already.\n");
         return;
     }
+    /* po restarcie - tylko pozostały czas (wznowiony sternik i tak
+       przejmuje koniec symulacji z pliku stanu) */
+    int left = TIMEOUT - (int)(time(NULL) - sim_start);
+    if(left < 1) left = 1;
     char arg[32];
-    sprintf(arg, "%d", TIMEOUT);
-    char *args[] = { (char*)PATH_STERNIK, arg, NULL };
-    pid_t c = run_child(PATH_STERNIK, args);
+    sprintf(arg, "%d", left);
+    char *args[] = { path_sternik, arg, NULL };
+    pid_t c = run_child(path_sternik, args);
     if(c > 0){
         pid_sternik = c;
         printf("[ORCH] sternik pid=%d.\n", c);
     }
 }
 
-/* start kasjer */
-static void start_kasjer(void)
+/* start kasjer (jeden shard) */
+static void start_kasjer(int k)
 {
-    if(pid_kasjer > 0){
-        printf("[ORCH] kasjer already.\n");
+    if(pid_kasjer[k] > 0){
+        printf("[ORCH] kasjer %d already.\n", k);
         return;
     }
-    char *args[] = { (char*)PATH_KASJER, NULL };
-    pid_t c = run_child(PATH_KASJER, args);
+    char arg[16];
+    sprintf(arg, "%d", k);
+    char *args[] = { path_kasjer, arg, NULL };
+    pid_t c = run_child(path_kasjer, args);
     if(c > 0){
-        pid_kasjer = c;
-        printf("[ORCH] kasjer pid=%d.\n", c);
+        pid_kasjer[k] = c;
+        printf("[ORCH] kasjer %d/%d pid=%d.\n", k, nkasjer, c);
     }
 }
 
@@ -423,20 +607,267 @@ static void start_policjant(void)
     }
     char arg[32];
     sprintf(arg, "%d", pid_sternik);
-    char *args[] = { (char*)PATH_POLICJANT, arg, NULL };
-    pid_t c = run_child(PATH_POLICJANT, args);
+    char *args[] = { path_policjant, arg, NULL };
+    pid_t c = run_child(path_policjant, args);
     if(c > 0){
         pid_policjant = c;
         printf("\033[1;32m[ORCH] policeman pid=%d, sternik=%d.\033[0m\n", c, pid_sternik);
     }
 }
 
+/* ------------------------------- */
+/* Gniazdo sterujące (control.h) */
+#define CTL_CLIENTS 16
+#define CTL_LINE    256
+
+typedef struct {
+    int    fd;               // -1 = wolne miejsce
+    size_t len;
+    char   buf[CTL_LINE];
+} CtlClient;
+static int       ctl_fd = -1;
+static CtlClient ctl_cl[CTL_CLIENTS];
+
+static void ctl_open(void)
+{
+    struct sockaddr_un a;
+    for (int i = 0; i < CTL_CLIENTS; i++) ctl_cl[i].fd = -1;
+    if (ctl_addr(&a, CTL_SOCKET) < 0) return;
+    unlink(CTL_SOCKET);   // po poprzedniej symulacji
+    ctl_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (ctl_fd < 0 || bind(ctl_fd, (struct sockaddr*)&a, sizeof(a)) < 0 ||
+        listen(ctl_fd, CTL_CLIENTS) < 0) {
+        perror("[ORCH] gniazdo sterujące");
+        if (ctl_fd >= 0) close(ctl_fd);
+        ctl_fd = -1;
+        return;
+    }
+    printf("[ORCH] Gniazdo sterujące: %s\n", CTL_SOCKET);
+}
+
+static void ctl_close(void)
+{
+    for (int i = 0; i < CTL_CLIENTS; i++) {
+        if (ctl_cl[i].fd >= 0) close(ctl_cl[i].fd);
+        ctl_cl[i].fd = -1;
+    }
+    if (ctl_fd >= 0) {
+        close(ctl_fd);
+        ctl_fd = -1;
+        unlink(CTL_SOCKET);
+    }
+}
+
+/* Liczniki jako klucz=wartość (STATS i nagłówek zrzutu) */
+static int ctl_stats(char *out, size_t sz)
+{
+    return snprintf(out, sz,
+        "uptime=%ld generated=%d alive=%d rejected=%d timeouts=%d registered=%zu groups=%zu "
+        "throttle=%d paused=%d interval_ms=%d batch=%d-%d "
+        "sternik=%d restarts=%d kasjer_shards=%d policjant=%d",
+        (long)(time(NULL) - sim_start), total_generated, pass_alive, pass_rejected, pass_timeouts,
+        reg.count, reg.gcount, g_throttle, g_paused, g_round_ms,
+        g_min_batch, g_max_batch, (int)pid_sternik, sternik_restarts, nkasjer,
+        (int)pid_policjant);
+}
+
+/* Liczniki na koniec przebiegu do SUMMARY_FILE (jedna linia klucz=wartość) */
+static void write_summary(void)
+{
+    char line[512];
+    ctl_stats(line, sizeof(line));
+    FILE *f = fopen(SUMMARY_FILE, "w");
+    if (!f) {
+        perror("[ORCH] " SUMMARY_FILE);
+        return;
+    }
+    fprintf(f, "%s timeout=%d\n", line, TIMEOUT);
+    fclose(f);
+}
+
+/* Zrzut stanu: liczniki + żyjący pasażerowie do CTL_SNAPSHOT, INFO do
+   sternika (stan łodzi w jego logu), opróżnienie bufora śladu JSON */
+static int ctl_snapshot(char *out, size_t sz)
+{
+    FILE *f = fopen(CTL_SNAPSHOT, "w");
+    if (!f) return snprintf(out, sz, "ERR %s: %s", CTL_SNAPSHOT, strerror(errno));
+
+    char line[512];
+    ctl_stats(line, sizeof(line));
+    fprintf(f, "# %s\n# pid procPID\n", line);
+    pthread_mutex_lock(&pass_mu);
+    int n = pass_count;
+    for (int i = 0; i < pass_count; i++) fprintf(f, "%d %d\n", p_pass[i].pid, (int)p_pass[i].proc);
+    pthread_mutex_unlock(&pass_mu);
+    fclose(f);
+
+    if (fd_sternik_hold >= 0) write(fd_sternik_hold, "INFO\n", 5);
+    ct_flush();
+    return snprintf(out, sz, "OK file=%s passengers=%d", CTL_SNAPSHOT, n);
+}
+
+/* Jedna komenda; odpowiedź (bez '\n') w out. Zwraca 1 dla QUIT. */
+static int ctl_command(char *line, char *out, size_t sz)
+{
+    char cmd[16] = "";
+    int a = 0, b = 0;
+    int n = sscanf(line, "%15s %d %d", cmd, &a, &b);
+    if (n < 1) {
+        snprintf(out, sz, "ERR pusta komenda");
+        return 0;
+    }
+
+    if (!strcmp(cmd, "INTERVAL")) {
+        if (n >= 2) {
+            if (a < ROUND_MS_MIN || a > ROUND_MS_MAX) {
+                snprintf(out, sz, "ERR INTERVAL %d..%d ms", ROUND_MS_MIN, ROUND_MS_MAX);
+                return 0;
+            }
+            g_round_ms = a;
+            printf("[ORCH/CTL] przerwa bazowa generatora = %d ms\n", a);
+        }
+        snprintf(out, sz, "OK interval_ms=%d", g_round_ms);
+    } else if (!strcmp(cmd, "BATCH")) {
+        if (n < 3 || a < 1 || b < a || b > BATCH_MAX) {
+            snprintf(out, sz, "ERR BATCH <min> <max>, 1 <= min <= max <= %d", BATCH_MAX);
+            return 0;
+        }
+        g_min_batch = a;
+        g_max_batch = b;
+        printf("[ORCH/CTL] tura partii = %d-%d pasażerów\n", a, b);
+        snprintf(out, sz, "OK batch=%d-%d", a, b);
+    } else if (!strcmp(cmd, "PAUSE") || !strcmp(cmd, "RESUME")) {
+        g_paused = (cmd[0] == 'P');
+        printf("[ORCH/CTL] generator %s\n", g_paused ? "wstrzymany" : "wznowiony");
+        snprintf(out, sz, "OK paused=%d", g_paused);
+    } else if (!strcmp(cmd, "POLICE")) {
+        if (pid_sternik <= 0) {
+            snprintf(out, sz, "ERR brak sternika");
+        } else if (pid_policjant > 0 && waitpid(pid_policjant, NULL, WNOHANG) == 0) {
+            snprintf(out, sz, "ERR policjant już działa pid=%d", (int)pid_policjant);
+        } else {
+            pid_policjant = 0;
+            start_policjant();
+            snprintf(out, sz, pid_policjant > 0 ? "OK policjant=%d" : "ERR fork", (int)pid_policjant);
+        }
+    } else if (!strcmp(cmd, "STATS")) {
+        size_t m = snprintf(out, sz, "OK ");
+        if (m < sz) ctl_stats(out + m, sz - m);
+    } else if (!strcmp(cmd, "SNAPSHOT")) {
+        ctl_snapshot(out, sz);
+    } else if (!strcmp(cmd, "CONFIG")) {
+        /* parametry łodzi - przekazujemy sternikowi; wynik (przyjęty /
+           odrzucony) jest w jego logu */
+        char fwd[CTL_LINE + 2];
+        int m = snprintf(fwd, sizeof(fwd), "%s\n", line);
+        if (fd_sternik_hold < 0 || write(fd_sternik_hold, fwd, m) != m) {
+            snprintf(out, sz, "ERR nie mogę przekazać do sternika");
+            return 0;
+        }
+        snprintf(out, sz, "OK przekazano sternikowi (od następnego załadunku)");
+    } else if (!strcmp(cmd, "QUIT")) {
+        snprintf(out, sz, "OK quit");
+        return 1;
+    } else if (!strcmp(cmd, "HELP")) {
+        snprintf(out, sz, "OK INTERVAL [ms] | BATCH min max | PAUSE | RESUME | POLICE | "
+                          "STATS | SNAPSHOT | CONFIG KLUCZ=wart... | QUIT");
+    } else {
+        snprintf(out, sz, "ERR nieznana komenda %s (HELP)", cmd);
+    }
+    return 0;
+}
+
+static void ctl_drop(CtlClient *c)
+{
+    close(c->fd);
+    c->fd = -1;
+    c->len = 0;
+}
+
+/* Czyta klienta i wykonuje pełne linie. Zwraca 1, gdy przyszło QUIT. */
+static int ctl_serve(CtlClient *c)
+{
+    ssize_t n = read(c->fd, c->buf + c->len, sizeof(c->buf) - c->len);
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return 0;
+        ctl_drop(c);
+        return 0;
+    }
+    c->len += n;
+
+    int quit = 0;
+    char *p = c->buf, *end = c->buf + c->len, *nl;
+    while (!quit && (nl = memchr(p, '\n', end - p))) {
+        *nl = '\0';
+        char out[768];
+        quit = ctl_command(p, out, sizeof(out) - 1);
+        size_t m = strlen(out);
+        out[m++] = '\n';
+        send(c->fd, out, m, MSG_NOSIGNAL | MSG_DONTWAIT);
+        p = nl + 1;
+    }
+    c->len = end - p;
+    memmove(c->buf, p, c->len);
+    if (c->len == sizeof(c->buf)) {   // linia dłuższa niż bufor
+        static const char msg[] = "ERR za długa linia\n";
+        send(c->fd, msg, sizeof(msg) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+        ctl_drop(c);
+    }
+    return quit;
+}
+
+static void ctl_accept(void)
+{
+    int fd = accept(ctl_fd, NULL, NULL);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    for (int i = 0; i < CTL_CLIENTS; i++) {
+        if (ctl_cl[i].fd < 0) {
+            ctl_cl[i].fd = fd;
+            ctl_cl[i].len = 0;
+            return;
+        }
+    }
+    static const char msg[] = "ERR za dużo połączeń\n";
+    send(fd, msg, sizeof(msg) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    close(fd);
+}
+
 /* ------------------------------- */
 /* main */
-int main(void)
+int main(int argc, char *argv[])
 {
     setbuf(stdout, NULL);
 
+    /* Katalog przebiegu: argument ma pierwszeństwo przed SIM_RUN_DIR;
+       dzieci dostają ścieżkę bezwzględną (ich cwd i tak jest tutaj) */
+    bin_path(path_sternik, sizeof(path_sternik), "sternik");
+    bin_path(path_kasjer, sizeof(path_kasjer), "kasjer");
+    bin_path(path_pasazer, sizeof(path_pasazer), "pasazer");
+    bin_path(path_policjant, sizeof(path_policjant), "policjant");
+    if(argc > 1) setenv(RUN_DIR_ENV, argv[1], 1);
+    if(rundir_enter(1) < 0){
+        perror("[ORCH] " RUN_DIR_ENV);
+        return 1;
+    }
+    char cwd[PATH_MAX];
+    if(getenv(RUN_DIR_ENV) && getcwd(cwd, sizeof(cwd))){
+        setenv(RUN_DIR_ENV, cwd, 1);
+        printf("[ORCH] Katalog przebiegu: %s\n", cwd);
+    }
+    const char *iv = getenv(INTERVAL_ENV);
+    if(iv && *iv){
+        int ms = atoi(iv);
+        if(ms >= ROUND_MS_MIN && ms <= ROUND_MS_MAX) g_round_ms = ms;
+        else printf("[ORCH] %s=%s poza %d..%d - ignoruję\n", INTERVAL_ENV, iv, ROUND_MS_MIN, ROUND_MS_MAX);
+    }
+
+    trace_open(TP_ORCH, "orchestrator", 1<<20);
+    ct_open("orchestrator", 1);
+    ct_thread_name(0, "main");
+    ct_thread_name(1, "generator");
+
     int user_time = 0;
     while(1){
         printf("\033[1;34m[ORCH] Podaj czas symulacji (s, >0): \033[0m");
@@ -456,13 +887,27 @@ int main(void)
     TIMEOUT = user_time;
     while(getchar() != '\n'); // wczytanie ewentualnego Enter
 
+    /* Liczba kasjerów - ustalona raz; dzieci (sternik, pasażerowie)
+       dziedziczą znormalizowaną wartość KASJER_SHARDS */
+    nkasjer = kasjer_shards();
+    char nk[16];
+    sprintf(nk, "%d", nkasjer);
+    setenv(KASJER_SHARDS_ENV, nk, 1);
+
     cleanup_fifo();
+    unlink(STERNIK_STATE);   /* nowa symulacja - nie wznawiamy starej */
     mkfifo(FIFO_STERNIK_IN, 0666);
-    mkfifo(FIFO_KASJER_IN, 0666);
+    for(int k=0; k<nkasjer; k++){
+        char name[64];
+        kasjer_fifo_name(name, sizeof(name), k, nkasjer);
+        mkfifo(name, 0666);
+    }
+    fd_sternik_hold = open(FIFO_STERNIK_IN, O_RDWR | O_NONBLOCK);
+    sim_start = time(NULL);
 
     start_sternik();
     sleep(1);
-    start_kasjer();
+    for(int k=0; k<nkasjer; k++) start_kasjer(k);
     sleep(1);
 
     /* wątek generatora */
@@ -471,6 +916,7 @@ int main(void)
     /* wątek time_killer */
     pthread_create(&time_killer_thread, NULL, time_killer_func, NULL);
 
+    ctl_open();
     printf("[ORCH] Komendy: p->policjant, q->end\n");
 
     char cmd[128];
@@ -480,6 +926,22 @@ int main(void)
             int st;
             pid_t w = waitpid(pid_sternik, &st, WNOHANG);
             if(w == pid_sternik){
+                pid_sternik = 0;
+                int crashed = WIFSIGNALED(st) || (WIFEXITED(st) && WEXITSTATUS(st) != 0);
+                if(crashed && sternik_restarts < MAX_RESTARTS &&
+                   time(NULL) - sim_start < TIMEOUT){
+                    sternik_restarts++;
+                    printf("\033[1;31m[ORCH] sternik padł (%s %d) -> restart %d/%d\033[0m\n",
+                           WIFSIGNALED(st) ? "sygnał" : "kod",
+                           WIFSIGNALED(st) ? WTERMSIG(st) : WEXITSTATUS(st),
+                           sternik_restarts, MAX_RESTARTS);
+                    /* policjant celował w stary PID - można go wezwać ponownie */
+                    if(pid_policjant > 0 && waitpid(pid_policjant, NULL, WNOHANG) == pid_policjant){
+                        pid_policjant = 0;
+                    }
+                    start_sternik();
+                    continue;
+                }
                 printf("[ORCH] sternik ended-> end.\n");
                 end_simulation();
                 break;
@@ -491,11 +953,21 @@ int main(void)
         fd_set rfds;
         FD_ZERO(&rfds);
         FD_SET(STDIN_FILENO, &rfds);
+        int maxfd = STDIN_FILENO;
+        if(ctl_fd >= 0){
+            FD_SET(ctl_fd, &rfds);
+            if(ctl_fd > maxfd) maxfd = ctl_fd;
+        }
+        for(int i=0; i<CTL_CLIENTS; i++){
+            if(ctl_cl[i].fd < 0) continue;
+            FD_SET(ctl_cl[i].fd, &rfds);
+            if(ctl_cl[i].fd > maxfd) maxfd = ctl_cl[i].fd;
+        }
 
         struct timeval tv;
         tv.tv_sec = 0; 
         tv.tv_usec = 100000; // 0.1 sek
-        int ret = select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv);
+        int ret = select(maxfd + 1, &rfds, NULL, NULL, &tv);
         if(ret < 0){
             if(errno == EINTR) continue;
             perror("[ORCH] select");
@@ -504,6 +976,15 @@ int main(void)
         if(ret == 0){
             // nic nie wpisano
         } else {
+            int quit = 0;
+            for(int i=0; i<CTL_CLIENTS && !quit; i++){
+                if(ctl_cl[i].fd >= 0 && FD_ISSET(ctl_cl[i].fd, &rfds)) quit = ctl_serve(&ctl_cl[i]);
+            }
+            if(quit){
+                end_simulation();
+                break;
+            }
+            if(ctl_fd >= 0 && FD_ISSET(ctl_fd, &rfds)) ctl_accept();
             // jest coś na stdin
             if(FD_ISSET(STDIN_FILENO, &rfds)){
                 if(!fgets(cmd, sizeof(cmd), stdin)) break;
@@ -522,9 +1003,11 @@ int main(void)
     if(!end_all){
         end_simulation();
     }
+    ctl_close();
 
     pthread_join(generator_thread, NULL);
     pthread_join(time_killer_thread, NULL);
+    reg_free(&reg);
 
     return 0;
 }
@@ -1,5 +1,17 @@
 /*******************************************************
  * File: pasazer.c
+ *
+ * Odpowiedzi (kasjera i sternika) przychodzą na fifo_pasazer_<id>.
+ * Pasażer trzyma je otwarte przez cały czas - do czytania i, jako
+ * "pusty pisarz", do pisania - więc FIFO nigdy nie zgłasza EOF, gdy
+ * nadawca zamknie swój koniec, a czekanie to poll() bez kręcenia się.
+ * Limit czekania na odpowiedź: PASAZER_TIMEOUT (s, domyślnie
+ * WAIT_TIMEOUT_S, 0 = bez limitu); po nim pasażer kończy z powodem
+ * TIMEOUT (kod EXIT_TIMEOUT).
+ *
+ * Bilet grupowy: "./pasazer <id> <age> <group> <id2> <age2> ..." - jeden
+ * proces kupuje (BUY_GROUP), staje w kolejce (QUEUE_GROUP) i płynie za
+ * całą grupę; kasjer i sternik odpowiadają raz, z id grupy.
  ******************************************************/
 
 #include <stdio.h>
@@ -9,20 +21,87 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <poll.h>
+#include <time.h>
 
+#include "trace.h"
+#include "shard.h"
+#include "rundir.h"
+#include "passqueue.h"
+
+/* Kod wyjścia, gdy kasjer lub sternik odmówił (przeciążenie) -
+   orchestrator na tej podstawie zwalnia generowanie pasażerów. */
+#define EXIT_REJECTED 2
+/* Kod wyjścia, gdy odpowiedź nie przyszła w czasie PASAZER_TIMEOUT */
+#define EXIT_TIMEOUT  3
+
+#define WAIT_TIMEOUT_ENV "PASAZER_TIMEOUT"
+#define WAIT_TIMEOUT_S   300
+
+/* Członkowie biletu (pojedynczy pasażer: n_memb = 1) */
+static int n_memb = 1, memb_id[GROUP_MAX], memb_age[GROUP_MAX];
+
+/* Zdarzenie śladu dla każdego członka */
+static void trace_all(int type, int boat, int a, int b)
+{
+    for (int i = 0; i < n_memb; i++) trace_ev(type, memb_id[i], boat, a, b);
+}
+
+static long long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Czeka (poll) na wiadomość w FIFO do chwili deadline (ms, 0 = bez limitu).
+   Zwraca liczbę bajtów, 0 - minął czas, -1 - błąd. */
+static ssize_t wait_msg(int fd, char *buf, size_t sz, long long deadline)
+{
+    for (;;) {
+        ssize_t n = read(fd, buf, sz);
+        if (n > 0) return n;
+        if (n < 0 && errno != EAGAIN && errno != EINTR) return -1;
+
+        int ms = -1;
+        if (deadline > 0) {
+            long long left = deadline - now_ms();
+            if (left <= 0) return 0;
+            ms = left > 60000 ? 60000 : (int)left;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, ms) < 0 && errno != EINTR) return -1;
+    }
+}
 
 int main(int argc, char *argv[])
 {
     setbuf(stdout, NULL);
 
-    if (argc < 4) {
-        fprintf(stdout, "Użycie: %s <id> <age> <group>\n", argv[0]);
+    if (argc < 4 || (argc > 4 && (argc % 2 || atoi(argv[3]) <= 0))) {
+        fprintf(stdout, "Użycie: %s <id> <age> <group> [<id> <age> ...]\n"
+                        "  (kolejne pary - bilet grupowy, wymaga group > 0)\n", argv[0]);
+        return 1;
+    }
+
+    if (rundir_enter(0) < 0) {
+        perror("[PASAZER] " RUN_DIR_ENV);
         return 1;
     }
 
     int pid = atoi(argv[1]); 
     int age = atoi(argv[2]); 
     int grp = atoi(argv[3]); 
+    memb_id[0] = pid;
+    memb_age[0] = age;
+    for (int i = 4; i + 1 < argc && n_memb < GROUP_MAX; i += 2) {
+        memb_id[n_memb] = atoi(argv[i]);
+        memb_age[n_memb] = atoi(argv[i + 1]);
+        n_memb++;
+    }
+    /* Id w odpowiedziach kasjera i sternika (grupa - id grupy) */
+    int me = n_memb > 1 ? grp : pid;
+    trace_open(TP_PASAZER, "pasazer", 16);
 
     /* 1) Tworzenie unikalnego FIFO do komunikacji (z kasjerem i sternikiem). */
     char fifo_response[64];
@@ -34,39 +113,64 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    /* 2) Wysyłamy polecenie BUY do kasjera_in, podając nazwę swojego FIFO */
-    int fd_ki = open("fifo_kasjer_in", O_WRONLY);
+    /* Czytelnik i własny pisarz od razu: kasjer i sternik zawsze zastają
+       czytelnika (bez ENXIO i ponawiania), a my nie dostajemy EOF */
+    int fd_resp = open(fifo_response, O_RDONLY | O_NONBLOCK);
+    int fd_hold = fd_resp >= 0 ? open(fifo_response, O_WRONLY | O_NONBLOCK) : -1;
+    if (fd_resp < 0 || fd_hold < 0) {
+        perror("[PASAZER] open fifo_pasazer_");
+        unlink(fifo_response);
+        return 1;
+    }
+
+    const char *to = getenv(WAIT_TIMEOUT_ENV);
+    int timeout_s = (to && *to) ? atoi(to) : WAIT_TIMEOUT_S;
+    long long deadline = 0;
+
+    /* 2) Wysyłamy polecenie BUY do kasjera_in, podając nazwę swojego FIFO.
+     *    Przy kilku kasjerach - zawsze do tego samego sharda (skrót id),
+     *    bo tylko on pamięta, czy już płynęliśmy (grupa - skrót id grupy). */
+    char fifo_kasjer[64];
+    kasjer_fifo_name(fifo_kasjer, sizeof(fifo_kasjer), shard_of(me, kasjer_shards()), kasjer_shards());
+    int fd_ki = open(fifo_kasjer, O_WRONLY);
     if (fd_ki < 0) {
         perror("[PASAZER] open fifo_kasjer_in");
+        close(fd_resp);
+        close(fd_hold);
         unlink(fifo_response);
         return 1;
     }
 
     char buf[256];
-    snprintf(buf, sizeof(buf), "BUY %d %d %d %s\n", pid, age, grp, fifo_response);
+    if (n_memb > 1) {
+        // FORMAT: BUY_GROUP <gid> <n> <id1> <age1> .. <idn> <agen> <fifo>
+        int len = snprintf(buf, sizeof(buf), "BUY_GROUP %d %d", grp, n_memb);
+        for (int i = 0; i < n_memb; i++) {
+            len += snprintf(buf + len, sizeof(buf) - len, " %d %d", memb_id[i], memb_age[i]);
+        }
+        snprintf(buf + len, sizeof(buf) - len, " %s\n", fifo_response);
+    } else {
+        snprintf(buf, sizeof(buf), "BUY %d %d %d %s\n", pid, age, grp, fifo_response);
+    }
 
     if (write(fd_ki, buf, strlen(buf)) == -1) {
         perror("[PASAZER] write to fifo_kasjer_in");
         close(fd_ki);
+        close(fd_resp);
+        close(fd_hold);
         unlink(fifo_response);
         return 1;
     }
     close(fd_ki);
+    for (int i = 0; i < n_memb; i++) trace_ev(TE_BUY, memb_id[i], 0, memb_age[i], grp);
 
     /* 3) Odbieramy odpowiedź OK (lub błąd) od kasjera przez nasze fifo_pasazer_<pid>. */
-    int fd_resp = open(fifo_response, O_RDONLY);
-    if (fd_resp < 0) {
-        perror("[PASAZER] open fifo_pasazer_ (kasjer)");
-        unlink(fifo_response);
-        return 1;
-    }
-
-    int tries = 0;
     int boat = 0, disc = 0, skip = 0, groupBack = 0;
     int ok = 0;
 
+    if (timeout_s > 0) deadline = now_ms() + timeout_s * 1000LL;
     while (1) {
-        ssize_t n = read(fd_resp, buf, sizeof(buf) - 1);
+        ssize_t n = wait_msg(fd_resp, buf, sizeof(buf) - 1, deadline);
         if (n > 0) {
             buf[n] = '\0';
             /* Sprawdzamy, czy zaczyna się od "OK " */
@@ -74,33 +178,45 @@ int main(int argc, char *argv[])
                 /*
                   Przykładowy format:
                   "OK 1234 BOAT=1 DISC=0 SKIP=0 GROUP=0\n"
+                  (grupa: "... GROUP=<gid> N=<n> PRICE=<grosze>", DISC dla całej grupy)
                 */
                 sscanf(buf, "OK %*d BOAT=%d DISC=%d SKIP=%d GROUP=%d",
                        &boat, &disc, &skip, &groupBack);
 
                 printf("[PASAZER %d] Dostalem od kasjera: %s", pid, buf);
+                trace_all(TE_OK, boat, disc, skip);
                 ok = 1;
                 break;
+            } else if (strncmp(buf, "NO", 2) == 0) {
+                /* "NO <pid> FULL" - kolejki pełne, kasjer nie sprzedał biletu */
+                printf("[PASAZER %d] Kasjer odmówił: %s", pid, buf);
+                trace_all(TE_NO, 0, 0, 0);
+                close(fd_resp);
+                close(fd_hold);
+                unlink(fifo_response);
+                return EXIT_REJECTED;
             } else {
                 printf("[PASAZER %d] (kasjer) Nieznana odp: %s\n", pid, buf);
             }
         } else if (n == 0) {
-            // Kasjer zamknął FIFO — może brak odpowiedzi
-            break;
+            // Minął PASAZER_TIMEOUT - kasjer nie odpowiedział
+            printf("[PASAZER %d] Rezygnuję: TIMEOUT (kasjer nie odpowiedział w %d s).\n",
+                   pid, timeout_s);
+            trace_all(TE_REJECT, 0, trace_reason("TIMEOUT"), 0);
+            close(fd_resp);
+            close(fd_hold);
+            unlink(fifo_response);
+            return EXIT_TIMEOUT;
         } else {
-            // n < 0 => błąd odczytu
-            if (errno != EINTR) {
-                perror("[PASAZER] read (kasjer)");
-                break;
-            }
+            perror("[PASAZER] read (kasjer)");
+            break;
         }
-        //usleep(100000); // co 0.1 s
-    
     }
-    close(fd_resp);
 
     if (!ok) {
         printf("[PASAZER %d] Kasjer nie odpowiedział poprawnie. Konczę.\n", pid);
+        close(fd_resp);
+        close(fd_hold);
         unlink(fifo_response);
         return 0;
     }
@@ -116,11 +232,21 @@ int main(int argc, char *argv[])
     if (fd_st < 0) {
         perror("[PASAZER] open fifo_sternik_in");
         // Zamiast wychodzić, można ewentualnie spróbować ponowić itp.
+        close(fd_resp);
+        close(fd_hold);
         unlink(fifo_response);
         return 1;
     }
 
-    if (skip == 1) {
+    if (n_memb > 1) {
+        // FORMAT: QUEUE_GROUP[_SKIP] <gid> <boat> <disc> <n> <id1> .. <idn> <fifo>
+        int len = snprintf(buf, sizeof(buf), "QUEUE_GROUP%s %d %d %d %d",
+                           skip == 1 ? "_SKIP" : "", grp, boat, disc, n_memb);
+        for (int i = 0; i < n_memb; i++) {
+            len += snprintf(buf + len, sizeof(buf) - len, " %d", memb_id[i]);
+        }
+        snprintf(buf + len, sizeof(buf) - len, " %s\n", fifo_response);
+    } else if (skip == 1) {
         // FORMAT: QUEUE_SKIP <pid> <boat> <disc> <fifo_pasazer_pid>
         snprintf(buf, sizeof(buf), "QUEUE_SKIP %d %d %d %s\n",
                  pid, boat, disc, fifo_response);
@@ -133,25 +259,24 @@ int main(int argc, char *argv[])
     if (write(fd_st, buf, strlen(buf)) == -1) {
         perror("[PASAZER] write to fifo_sternik_in");
         close(fd_st);
+        close(fd_resp);
+        close(fd_hold);
         unlink(fifo_response);
         return 1;
     }
     close(fd_st);
+    trace_all(TE_QUEUE, boat, skip, 0);
 
-    /* 5) Teraz ponownie otwieramy własne fifo_pasazer_<pid> i 
-     *    czekamy na wiadomość "UNLOADED <pid>" od sternika.
-     *    Będzie to oznaczać zakończenie rejsu (lub 'force unload').
+    /* 5) Czekamy na tym samym fifo_pasazer_<pid> na wiadomość
+     *    "UNLOADED <pid>" od sternika. Będzie to oznaczać zakończenie
+     *    rejsu (lub 'force unload'). Limit liczony od nowa - kolejka
+     *    i rejs trwają dłużej niż zakup biletu.
      */
-    fd_resp = open(fifo_response, O_RDONLY);
-    if (fd_resp < 0) {
-        perror("[PASAZER] open fifo_pasazer_ (sternik)");
-        unlink(fifo_response);
-        return 1;
-    }
-
     int got_unloaded = 0;
+    const char *why = NULL;
+    if (timeout_s > 0) deadline = now_ms() + timeout_s * 1000LL;
     while (1) {
-        ssize_t n = read(fd_resp, buf, sizeof(buf) - 1);
+        ssize_t n = wait_msg(fd_resp, buf, sizeof(buf) - 1, deadline);
         if (n > 0) {
             buf[n] = '\0';
 
@@ -159,8 +284,9 @@ int main(int argc, char *argv[])
             if (strncmp(buf, "UNLOADED", 8) == 0) {
                 int who = -1;
                 sscanf(buf, "UNLOADED %d", &who);
-                if (who == pid) {
+                if (who == me) {
                     printf("[PASAZER %d] Otrzymałem UNLOADED -> kończę.\n", pid);
+                    trace_all(TE_UNLOADED, boat, 0, 0);
                     got_unloaded = 1;
                     break;
                 } else {
@@ -168,30 +294,39 @@ int main(int argc, char *argv[])
                     // (mało prawdopodobne, ale w multi-FIFO też się zdarza)
                     printf("[PASAZER %d] Otrzymałem UNLOADED %d (nie moje?)\n", pid, who);
                 }
+            } else if (strncmp(buf, "REJECTED", 8) == 0) {
+                /* "REJECTED <pid> <FULL|INACTIVE|CLOSED>" - sternik nie przyjął */
+                printf("[PASAZER %d] Sternik odrzucił: %s", pid, buf);
+                trace_all(TE_REJECT, boat, 0, 0);
+                close(fd_resp);
+                close(fd_hold);
+                unlink(fifo_response);
+                return EXIT_REJECTED;
             } else {
                 printf("[PASAZER %d] (sternik) Nieznane: %s\n", pid, buf);
             }
         }
         else if (n == 0) {
-            // Koniec pliku — writer (sternik) zamknął FIFO. 
-            // Jeśli nie dostaliśmy "UNLOADED", to trudno, kończymy.
-            //break;
+            // Minął PASAZER_TIMEOUT bez UNLOADED/REJECTED
+            why = "TIMEOUT";
+            trace_all(TE_REJECT, boat, trace_reason(why), 0);
+            break;
         }
         else {
-            if (errno != EINTR) {
-                perror("[PASAZER] read (sternik)");
-                break;
-            }
+            why = strerror(errno);
+            perror("[PASAZER] read (sternik)");
+            break;
         }
     }
 
     close(fd_resp);
+    close(fd_hold);
     unlink(fifo_response);
 
     if (!got_unloaded) {
-        printf("[PASAZER %d] Nie doczekałem się 'UNLOADED'. Koniec.\n", pid);
-          close(fd_resp);
-    unlink(fifo_response);
+        printf("[PASAZER %d] Nie doczekałem się 'UNLOADED' (%s, limit %d s). Koniec.\n",
+               pid, why, timeout_s);
+        if (why && !strcmp(why, "TIMEOUT")) return EXIT_TIMEOUT;
     }
 
     return 0;
@@ -0,0 +1,137 @@
+/*******************************************************
+ * File: passqueue.h
+ *
+ * Kolejka pasażerów sternika - ograniczony pierścień MPMC bez blokad
+ * (schemat D. Vyukova: każda komórka ma własny numer sekwencji).
+ * Wielu producentów (wątki wejścia) i wielu konsumentów (łodzie)
+ * wymienia pasażerów bez wspólnego mutexu.
+ *
+ * Priorytet "skip" realizujemy dwiema kolejkami: konsument zawsze
+ * najpierw próbuje kolejki skip (dequeue_prio).
+ ******************************************************/
+
+#ifndef PASSQUEUE_H
+#define PASSQUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/* Rozmiar kolejki - potęga dwójki (maska zamiast modulo).
+   Przyjęcia i tak ogranicza QUEUE_LIMIT w sterniku. */
+#define QSIZE 256
+
+/* Najwięcej osób na jednym bilecie grupowym (QUEUE_GROUP) */
+#define GROUP_MAX 8
+
+/* Struktura pasażera w kolejce. Grupa (rodzina) to jeden wpis:
+   pid = id grupy, size osób (member[]), jedno FIFO i jedno UNLOADED -
+   wchodzi, płynie i schodzi w całości. Pojedynczy pasażer: size = 1. */
+typedef struct {
+    int  pid;         // ID pasażera (dla grupy - ID grupy)
+    int  disc;        // Zniżka (0 lub np. 50)
+    int  group;       // ID grupy (0 - brak)
+    int  size;        // ile miejsc zajmuje wpis (osób)
+    int  member[GROUP_MAX]; // id członków grupy (size > 1)
+    char pass_fifo[128]; // nazwa FIFO pasażera - do wysłania "UNLOADED"
+    long long t_queue;   // kiedy (ms, zegar monotoniczny) wszedł do kolejki sternika
+} PassengerItem;
+
+typedef struct {
+    _Atomic size_t seq;
+    PassengerItem  item;
+} PassCell;
+
+/* Kolejka cykliczna; liczniki w osobnych liniach cache */
+typedef struct {
+    PassCell cells[QSIZE];
+    _Alignas(64) _Atomic size_t enq_pos;
+    _Alignas(64) _Atomic size_t deq_pos;
+} PassQueue;
+
+static void initQueue(PassQueue *q) {
+    for(size_t i=0; i<QSIZE; i++){
+        atomic_store_explicit(&q->cells[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&q->enq_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->deq_pos, 0, memory_order_relaxed);
+}
+
+/* Przybliżona liczba elementów (dokładna, gdy nikt akurat nie pisze) */
+static int queueCount(PassQueue *q) {
+    size_t e = atomic_load_explicit(&q->enq_pos, memory_order_acquire);
+    size_t d = atomic_load_explicit(&q->deq_pos, memory_order_acquire);
+    return e>d ? (int)(e-d) : 0;
+}
+static int isEmpty(PassQueue *q){
+    return queueCount(q)==0;
+}
+static int isFull(PassQueue *q) {
+    return queueCount(q)>=QSIZE;
+}
+
+/* 0 - wstawiono, -1 - kolejka pełna */
+static int enqueue(PassQueue *q, const PassengerItem *p){
+    size_t pos = atomic_load_explicit(&q->enq_pos, memory_order_relaxed);
+    for(;;){
+        PassCell *c = &q->cells[pos & (QSIZE-1)];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)pos;
+        if(dif==0){
+            if(atomic_compare_exchange_weak_explicit(&q->enq_pos, &pos, pos+1,
+                    memory_order_relaxed, memory_order_relaxed)){
+                c->item = *p;
+                atomic_store_explicit(&c->seq, pos+1, memory_order_release);
+                return 0;
+            }
+        } else if(dif<0){
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&q->enq_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/* 0 - pobrano do *out, -1 - kolejka pusta */
+static int dequeue(PassQueue *q, PassengerItem *out){
+    size_t pos = atomic_load_explicit(&q->deq_pos, memory_order_relaxed);
+    for(;;){
+        PassCell *c = &q->cells[pos & (QSIZE-1)];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)(pos+1);
+        if(dif==0){
+            if(atomic_compare_exchange_weak_explicit(&q->deq_pos, &pos, pos+1,
+                    memory_order_relaxed, memory_order_relaxed)){
+                *out = c->item;
+                atomic_store_explicit(&c->seq, pos+QSIZE, memory_order_release);
+                return 0;
+            }
+        } else if(dif<0){
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&q->deq_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/* Kopia zawartości kolejki (od najstarszego) bez pobierania, max 'max'.
+   Wołający musi być jedynym konsumentem w tym czasie (np. trzyma blokadę
+   łodzi) - producenci mogą dalej dopisywać, trafią albo nie. */
+static int queuePeekAll(PassQueue *q, PassengerItem *out, int max){
+    size_t pos = atomic_load_explicit(&q->deq_pos, memory_order_acquire);
+    int n = 0;
+    while(n<max){
+        PassCell *c = &q->cells[pos & (QSIZE-1)];
+        if(atomic_load_explicit(&c->seq, memory_order_acquire) != pos+1) break;
+        out[n++] = c->item;
+        pos++;
+    }
+    return n;
+}
+
+/* Pobranie z priorytetem: najpierw skip, potem normalna */
+static int dequeue_prio(PassQueue *skip, PassQueue *normal, PassengerItem *out){
+    if(dequeue(skip, out)==0) return 0;
+    return dequeue(normal, out);
+}
+
+#endif
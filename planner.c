@@ -0,0 +1,638 @@
+/*******************************************************
+ * File: planner.c
+ *
+ * Planowanie pojemności: szuka najtańszej floty (liczba łodzi, N1/N2,
+ * K, LOAD_TIMEOUT), która przy zadanym tempie przybywania spełnia
+ * SLO - p99 czasu czekania (od wejścia do kolejki do wejścia na pokład)
+ * i dopuszczalny odsetek odrzuceń (QUEUE_LIMIT). Czas czekania liczy się
+ * do wypłynięcia, jak w sterniku - siedzenie na pokładzie też jest czekaniem.
+ *
+ * Model łodzi to ta sama maszyna faz co boat_step() w sterniku
+ * (IDLE -> LOADING -> SAILING -> UNLOADING, potok wyboru na morzu,
+ * pomost K-szeroki po WALK_MS na osobę, okno załadunku LOAD_TIMEOUT
+ * albo kontroler wypłynięcia z depart.h przy ADAPTIVE=1) - decyzje
+ * faz bierze z boatphase.h, tak jak sternik,
+ * ale w czasie symulowanym: zdarzenia (przybycie, termin łodzi) bez
+ * procesów, FIFO i zegara - godzina pracy liczy się w milisekundach.
+ * Rejs trwa T x skala (-s, domyślnie 1000 ms na sekundę T).
+ * Flota jak w sterniku: łodzie nieparzyste N1/T1, parzyste N2/T2.
+ * Przybycia - proces Poissona; ułamek -p musi płynąć łodzią typu 2
+ * (dzieci, seniorzy, grupy). Łódź wybiera kasa_decide z kasa.h, jak
+ * kasjer: reszta losuje typ, w obrębie typu łódź z największym kredytem
+ * (QUEUE_LIMIT minus czekający), dorosły przy pełnych kolejkach swojego
+ * typu bierze drugi; bez łodzi - odmowa. Model sprzedaje tylko bilety
+ * pojedyncze.
+ *
+ * Koszt floty: łodzie x C_BOAT + miejsca (suma N) + łodzie x K x C_K.
+ * Przeszukiwanie: -m grid (pełna siatka) albo -m hill (od największej
+ * floty w dół, zawsze najtańszy sąsiad, który nadal spełnia SLO);
+ * -A dokłada wymiar ADAPTIVE 0/1.
+ * Dla wyniku - krzywe przepływu i obłożenia przy 0.25..1.5 x tempo.
+ *
+ * Użycie: ./planner -l tempo_os/s -w p99_s [-r max_odrzuceń_%] [-m grid|hill]
+ *                   [-B min:max] [-N min:max:krok] [-K min:max]
+ *                   [-L "s,..."] [-A] [-H horyzont_s] [-s ms_na_T] [-p ułamek_typu2]
+ *                   [-S ziarno] [-o wszystkie.csv]
+ *   np.   ./planner -l 1.5 -w 60 -B 2:4 -N 4:32:2 -K 1:8
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "boatconf.h"
+#include "depart.h"
+#include "boatphase.h"
+#include "kasa.h"
+
+#define MAX_FLEET   16
+#define MAX_LT      16
+#define NEVER       PHASE_NEVER
+#define C_BOAT      20      // koszt łodzi w "miejscach"
+#define C_K         1       // koszt miejsca na pomoście
+#define WAIT_RES_MS 10      // rozdzielczość histogramu czekania
+#define WAIT_SLOTS  60000   // do 600 s; dłużej - ostatni przedział
+
+/* Parametry jednej oceny */
+typedef struct {
+    int boats;
+    BoatConf c;
+} Plan;
+
+/* Wynik symulacji (po rozgrzewce) */
+typedef struct {
+    double p50_s, p99_s;
+    double throughput;   // przewiezionych / s
+    double occupancy;    // średnie obłożenie rejsu (0..1)
+    double reject;       // odrzuceni / przybyli
+    long   trips, carried, arrived;
+    int    cost;
+    int    ok;           // spełnia SLO
+} Eval;
+
+/* Kolejka czasów przybycia (ms) - bufor cykliczny rosnący x2 */
+typedef struct {
+    long long *t;
+    size_t head, count, cap;
+} TQueue;
+
+typedef struct {
+    int type;            // 0 - N1/T1, 1 - N2/T2
+    int cap, k, adaptive;
+    int trip_t;          // T (s) - do oceny czasu rejsu w boatphase.h
+    long long trip_ms, lt_ms;
+    unsigned arrivals;
+    DepartCtl dep;
+    BoatPhase phase;
+    TQueue q;
+    long long sel[N_MAX];        // wybrani na morzu (czasy przybycia)
+    int nsel, selhead;
+    int onboard;
+    long long board_arr[N_MAX];  // czasy przybycia tych na pokładzie
+    long long walk_until[K_MAX], walk_arr[K_MAX];
+    int nwalk;
+    int unload_left;
+    long long load_end, back, wake;
+} PBoat;
+
+/* Stan jednej symulacji */
+typedef struct {
+    PBoat b[MAX_FLEET];
+    int nb;
+    Kasa kasa;           // sprzedaż jak w kasjerze (route)
+    long long warmup;
+    unsigned *hist;
+    long long wait_max;
+    long waits, trips, carried, arrived, rejected;
+    double occ_sum;
+} Sim;
+
+/* Globalne ustawienia planowania */
+static double g_rate = 1.0;        // przybyć / s
+static double g_slo_s = 60.0;      // p99 czekania
+static double g_max_reject = 0.01;
+static double g_type2 = 0.65;      // ułamek, który musi płynąć łodzią typu 2
+static long long g_horizon_ms = 3600 * 1000LL;
+static int g_trip_scale = 1000;
+static uint64_t g_seed = 12345;
+
+static uint64_t rng_state;
+static double rng_unit(void)
+{
+    /* xorshift64* - ten sam strumień dla każdej konfiguracji (to samo ziarno) */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ((rng_state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int tq_push(TQueue *q, long long t)
+{
+    if (q->count == q->cap) {
+        size_t nc = q->cap ? q->cap * 2 : 256;
+        long long *nt = malloc(nc * sizeof(long long));
+        if (!nt) return -1;
+        for (size_t i = 0; i < q->count; i++) nt[i] = q->t[(q->head + i) % q->cap];
+        free(q->t);
+        q->t = nt;
+        q->cap = nc;
+        q->head = 0;
+    }
+    q->t[(q->head + q->count++) % q->cap] = t;
+    return 0;
+}
+
+static int tq_pop(TQueue *q, long long *t)
+{
+    if (q->count == 0) return -1;
+    *t = q->t[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+    return 0;
+}
+
+static void sim_wait(Sim *s, long long arr, long long now)
+{
+    if (arr < s->warmup) return;
+    long long w = now - arr;
+    long long slot = w / WAIT_RES_MS;
+    s->hist[slot < WAIT_SLOTS ? slot : WAIT_SLOTS - 1]++;
+    if (w > s->wait_max) s->wait_max = w;
+    s->waits++;
+}
+
+static double sim_pct(const Sim *s, double pct)
+{
+    if (s->waits == 0) return 0;
+    long want = (long)(pct / 100.0 * s->waits + 0.5), acc = 0;
+    if (want < 1) want = 1;
+    for (int i = 0; i < WAIT_SLOTS; i++) {
+        acc += s->hist[i];
+        if (acc >= want) {
+            long long up = (long long)(i + 1) * WAIT_RES_MS;
+            return (i == WAIT_SLOTS - 1 || up > s->wait_max ? s->wait_max : up) / 1000.0;
+        }
+    }
+    return s->wait_max / 1000.0;
+}
+
+/* Następny do wejścia: najpierw wybrani na morzu, potem kolejka */
+static int take_next(PBoat *b, long long *arr)
+{
+    if (b->selhead < b->nsel) {
+        *arr = b->sel[b->selhead++];
+        if (b->selhead == b->nsel) b->selhead = b->nsel = 0;
+        return 0;
+    }
+    return tq_pop(&b->q, arr);
+}
+
+static long long next_walker(const PBoat *b)
+{
+    long long due = NEVER;
+    for (int i = 0; i < b->nwalk; i++) if (b->walk_until[i] < due) due = b->walk_until[i];
+    return due;
+}
+
+/* Zejście z pomostu tych, którzy już przeszli; zwraca ich czasy przybycia */
+static int leave_done(PBoat *b, long long now, long long *out)
+{
+    int n = 0, keep = 0;
+    for (int i = 0; i < b->nwalk; i++) {
+        if (b->walk_until[i] <= now) out[n++] = b->walk_arr[i];
+        else {
+            b->walk_until[keep] = b->walk_until[i];
+            b->walk_arr[keep++] = b->walk_arr[i];
+        }
+    }
+    b->nwalk = keep;
+    return n;
+}
+
+static void load_begin(PBoat *b, long long now)
+{
+    b->phase = B_LOADING;
+    b->onboard = 0;
+    b->load_end = b->lt_ms > 0 ? now + b->lt_ms : NEVER;
+    b->dep.since = now;
+}
+
+/* Krok łodzi - jak boat_step(): robi, co się da, i ustawia b->wake */
+static void boat_step(Sim *s, PBoat *b, long long now)
+{
+    long long done[K_MAX], arr;
+    depart_observe(&b->dep, b->arrivals, now);
+    for (;;) {
+        switch (b->phase) {
+        case B_IDLE:
+            if (b->q.count == 0 && b->selhead == b->nsel) {
+                b->wake = NEVER;          // obudzi przybycie
+                return;
+            }
+            load_begin(b, now);
+            continue;
+
+        case B_LOADING: {
+            int nd = leave_done(b, now, done);
+            for (int i = 0; i < nd; i++) {
+                b->board_arr[b->onboard++] = done[i];
+                b->dep.since = now;
+            }
+            /* bilety pojedyncze - każdy wpis to jedna osoba */
+            int timed_out = now >= b->load_end;
+            int taken = b->onboard + b->nwalk, full = taken >= b->cap;
+            while (!timed_out && !full && b->nwalk < b->k && take_next(b, &arr) == 0) {
+                b->walk_until[b->nwalk] = now + WALK_MS;
+                b->walk_arr[b->nwalk++] = arr;
+                full = phase_admit(++taken, 1, b->cap) != ADMIT_OK;
+            }
+            int idle = b->nwalk == 0 && b->q.count == 0 && b->selhead == b->nsel;
+            long long until = phase_load_until(&b->dep, now, b->load_end, b->adaptive, idle,
+                                               b->onboard, b->cap, b->trip_t,
+                                               b->k, NEVER, &timed_out);
+            if (phase_load_open(b->nwalk, full, b->onboard, b->cap, timed_out)) {
+                long long w = next_walker(b);
+                if (!timed_out && until < w) w = until;
+                b->wake = w;              // NEVER: bez limitu okna - obudzi przybycie
+                return;
+            }
+            if (b->onboard == 0) {
+                b->phase = B_IDLE;
+                continue;
+            }
+            for (int i = 0; i < b->onboard; i++) sim_wait(s, b->board_arr[i], now);
+            if (now >= s->warmup) {
+                s->trips++;
+                s->occ_sum += (double)b->onboard / b->cap;
+            }
+            b->back = now + b->trip_ms;
+            b->phase = B_SAILING;
+            continue;
+        }
+
+        case B_SAILING:
+            while (phase_presel(b->nsel, b->nsel, b->cap) && tq_pop(&b->q, &arr) == 0)
+                b->sel[b->nsel++] = arr;
+            if (now < b->back) {
+                b->wake = b->back;
+                return;
+            }
+            b->unload_left = b->onboard;
+            b->phase = B_UNLOADING;
+            continue;
+
+        case B_UNLOADING: {
+            int nd = leave_done(b, now, done);
+            if (now >= s->warmup) s->carried += nd;
+            while (b->unload_left > 0 && b->nwalk < b->k) {
+                b->walk_until[b->nwalk] = now + WALK_MS;
+                b->walk_arr[b->nwalk++] = 0;
+                b->unload_left--;
+                b->onboard--;
+            }
+            if (b->unload_left > 0 || b->nwalk > 0) {
+                b->wake = next_walker(b);
+                return;
+            }
+            depart_cycle(&b->dep, now - (b->back - b->trip_ms));
+            if (b->nsel > b->selhead) load_begin(b, now);
+            else b->phase = B_IDLE;
+            continue;
+        }
+
+        case B_DONE:
+            return;
+        }
+    }
+}
+
+/* Łódź dla przybyłego - decyzja kasjera (kasa_decide) na kredycie floty.
+   Sternik ogłasza kredyt co chwilę, tu jest zawsze aktualny. must2 -
+   musi płynąć typem 2 (model: dziecko), inaczej dorosły. NULL - odmowa. */
+static PBoat *route(Sim *s, int must2)
+{
+    int credit[MAX_FLEET];
+    for (int i = 0; i < s->nb; i++) {
+        int c = QUEUE_LIMIT - (int)s->b[i].q.count;
+        credit[i] = c > 0 ? c : 0;
+    }
+    kasa_set_credit(&s->kasa, 1, credit, s->nb);
+    Sale sale = kasa_decide(&s->kasa, -1, must2 ? 10 : 30, 0);
+    return sale.boat ? &s->b[sale.boat - 1] : NULL;
+}
+
+static int plan_cost(const Plan *p)
+{
+    int seats = 0;
+    for (int i = 0; i < p->boats; i++) seats += (i % 2) ? p->c.n2 : p->c.n1;
+    return p->boats * C_BOAT + seats + p->boats * p->c.k * C_K;
+}
+
+static Eval simulate(const Plan *p, double rate)
+{
+    static unsigned hist[WAIT_SLOTS];
+    Sim s;
+    memset(&s, 0, sizeof(s));
+    memset(hist, 0, sizeof(hist));
+    s.hist = hist;
+    s.nb = p->boats;
+    s.warmup = g_horizon_ms / 10;
+    for (int i = 0; i < s.nb; i++) {
+        PBoat *b = &s.b[i];
+        b->type    = i % 2;
+        b->cap     = b->type ? p->c.n2 : p->c.n1;
+        b->trip_t  = b->type ? p->c.t2 : p->c.t1;
+        b->trip_ms = (long long)b->trip_t * g_trip_scale;
+        b->k       = p->c.k;
+        b->lt_ms   = p->c.load_timeout * 1000LL;
+        b->adaptive = p->c.adaptive;
+        depart_init(&b->dep, 0, b->trip_ms + (b->cap + b->k - 1) / b->k * WALK_MS);
+        b->phase   = B_IDLE;
+        b->wake    = NEVER;
+    }
+    kasa_init(&s.kasa);
+
+    rng_state = g_seed ? g_seed : 1;
+    srand((unsigned)rng_state);    // kasa_decide losuje rand()
+    double mean_ms = 1000.0 / rate;
+    long long next_arr = (long long)(-log(1.0 - rng_unit()) * mean_ms);
+    long long now = 0;
+
+    while (now < g_horizon_ms) {
+        long long t = next_arr;
+        for (int i = 0; i < s.nb; i++) if (s.b[i].wake < t) t = s.b[i].wake;
+        if (t >= g_horizon_ms) break;
+        now = t;
+
+        if (next_arr <= now) {
+            PBoat *b = route(&s, rng_unit() < g_type2);
+            if (now >= s.warmup) s.arrived++;
+            if (!b) {
+                if (now >= s.warmup) s.rejected++;
+            } else if (tq_push(&b->q, now) == 0) {
+                b->arrivals++;
+                if (b->phase != B_UNLOADING) b->wake = now;   // jak boat_wake po wstawieniu
+            }
+            next_arr = now + 1 + (long long)(-log(1.0 - rng_unit()) * mean_ms);
+        }
+        for (int i = 0; i < s.nb; i++) {
+            if (s.b[i].wake <= now) boat_step(&s, &s.b[i], now);
+        }
+    }
+
+    /* Kto do końca nie wsiadł - czekał co najmniej do końca horyzontu
+       (inaczej niestabilna flota wyglądałaby dobrze) */
+    for (int i = 0; i < s.nb; i++) {
+        PBoat *b = &s.b[i];
+        if (b->phase == B_LOADING) {
+            for (int j = 0; j < b->onboard; j++) sim_wait(&s, b->board_arr[j], g_horizon_ms);
+            for (int j = 0; j < b->nwalk; j++) sim_wait(&s, b->walk_arr[j], g_horizon_ms);
+        }
+        for (int j = b->selhead; j < b->nsel; j++) sim_wait(&s, b->sel[j], g_horizon_ms);
+        long long a;
+        while (tq_pop(&b->q, &a) == 0) sim_wait(&s, a, g_horizon_ms);
+        free(b->q.t);
+    }
+    kasa_free(&s.kasa);
+
+    Eval e;
+    memset(&e, 0, sizeof(e));
+    double span_s = (g_horizon_ms - s.warmup) / 1000.0;
+    e.p50_s      = sim_pct(&s, 50);
+    e.p99_s      = sim_pct(&s, 99);
+    e.throughput = s.carried / span_s;
+    e.occupancy  = s.trips ? s.occ_sum / s.trips : 0;
+    e.reject     = s.arrived ? (double)s.rejected / s.arrived : 0;
+    e.trips      = s.trips;
+    e.carried    = s.carried;
+    e.arrived    = s.arrived;
+    e.cost       = plan_cost(p);
+    e.ok         = e.p99_s <= g_slo_s && e.reject <= g_max_reject;
+    return e;
+}
+
+/* ------------------------------------------------------ */
+static FILE *g_csv;
+static long  g_evals;
+
+static Eval evaluate(const Plan *p)
+{
+    Eval e = simulate(p, g_rate);
+    g_evals++;
+    if (g_csv) {
+        fprintf(g_csv, "%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.4f,%.4f,%.4f,%d\n",
+                p->boats, p->c.n1, p->c.n2, p->c.k, p->c.load_timeout, p->c.adaptive, e.cost, e.ok,
+                e.p50_s, e.p99_s, e.throughput, e.occupancy, e.reject, e.trips > 0);
+    }
+    return e;
+}
+
+/* Lepszy wynik: spełnia SLO, potem niższy koszt, potem niższe p99 */
+static int better(const Eval *a, const Eval *b)
+{
+    if (a->ok != b->ok) return a->ok;
+    if (a->cost != b->cost) return a->cost < b->cost;
+    return a->p99_s < b->p99_s;
+}
+
+typedef struct {
+    int bmin, bmax, nmin, nmax, nstep, kmin, kmax;
+    int lt[MAX_LT], nlt;
+    int amax;            // 1 -> sprawdzamy też ADAPTIVE=1
+} Space;
+
+static int plan_valid(const Plan *p)
+{
+    return p->boats >= 1 && p->boats <= MAX_FLEET && boatconf_check(&p->c) == NULL;
+}
+
+static int search_grid(const Space *sp, Plan *best, Eval *beste)
+{
+    int found = 0;
+    Plan p;
+    p.c = (BoatConf)BOATCONF_DEFAULT;
+    for (p.boats = sp->bmin; p.boats <= sp->bmax; p.boats++)
+    for (p.c.n1 = sp->nmin; p.c.n1 <= sp->nmax; p.c.n1 += sp->nstep)
+    for (p.c.n2 = sp->nmin; p.c.n2 <= sp->nmax; p.c.n2 += sp->nstep)
+    for (p.c.k = sp->kmin; p.c.k <= sp->kmax; p.c.k++)
+    for (int l = 0; l < sp->nlt; l++)
+    for (p.c.adaptive = 0; p.c.adaptive <= sp->amax; p.c.adaptive++) {
+        p.c.load_timeout = sp->lt[l];
+        if (!plan_valid(&p)) continue;
+        /* przy jednej łodzi N2 nie gra roli - liczymy tylko N2 = N1 */
+        if (p.boats == 1 && p.c.n2 != p.c.n1) continue;
+        Eval e = evaluate(&p);
+        if (!found || better(&e, beste)) {
+            *best = p;
+            *beste = e;
+            found = 1;
+        }
+    }
+    return found && beste->ok;
+}
+
+static int search_hill(const Space *sp, Plan *best, Eval *beste)
+{
+    /* start: największa flota ze środkowym LOAD_TIMEOUT */
+    Plan p;
+    p.c = (BoatConf)BOATCONF_DEFAULT;
+    p.boats = sp->bmax;
+    p.c.n1 = p.c.n2 = sp->nmax;
+    p.c.k = sp->kmax < sp->nmax ? sp->kmax : sp->nmax - 1;
+    p.c.load_timeout = sp->lt[sp->nlt / 2];
+    if (!plan_valid(&p)) return 0;
+    Eval e = evaluate(&p);
+    *best = p;
+    *beste = e;
+    if (!e.ok) return 0;
+
+    for (;;) {
+        Plan cand[MAX_LT + 8];
+        int nc = 0;
+        Plan q;
+        q = p; q.boats--;                            cand[nc++] = q;
+        q = p; q.c.n1 -= sp->nstep;                  cand[nc++] = q;
+        q = p; q.c.n2 -= sp->nstep;                  cand[nc++] = q;
+        q = p; q.c.n1 -= sp->nstep; q.c.n2 -= sp->nstep; cand[nc++] = q;
+        q = p; q.c.k--;                              cand[nc++] = q;
+        for (int l = 0; l < sp->nlt; l++) {
+            if (sp->lt[l] == p.c.load_timeout) continue;
+            q = p; q.c.load_timeout = sp->lt[l];     cand[nc++] = q;
+        }
+        if (sp->amax) {
+            q = p; q.c.adaptive = !q.c.adaptive;      cand[nc++] = q;
+        }
+
+        int moved = 0;
+        Plan np = p;
+        Eval ne = e;
+        for (int i = 0; i < nc; i++) {
+            Plan *c = &cand[i];
+            if (!plan_valid(c) || c->boats < sp->bmin || c->c.n1 < sp->nmin ||
+                c->c.n2 < sp->nmin || c->c.k < sp->kmin) continue;
+            Eval ce = evaluate(c);
+            if (ce.ok && better(&ce, &ne)) {
+                np = *c;
+                ne = ce;
+                moved = 1;
+            }
+        }
+        if (!moved) break;
+        p = np;
+        e = ne;
+    }
+    *best = p;
+    *beste = e;
+    return 1;
+}
+
+static int parse_range(const char *s, int *a, int *b, int *c)
+{
+    int n = sscanf(s, "%d:%d:%d", a, b, c);
+    if (n == 1) *b = *a;
+    return n >= 1 && *a <= *b;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Użycie: %s -l tempo_os/s -w p99_s [-r max_odrzuceń_%%] [-m grid|hill]\n"
+                    "          [-B min:max] [-N min:max:krok] [-K min:max] [-L \"s,...\"] [-A]\n"
+                    "          [-H horyzont_s] [-s ms_na_T] [-p ułamek_typu2] [-S ziarno]\n"
+                    "          [-o wszystkie.csv]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    Space sp = { .bmin = 2, .bmax = 4, .nmin = 4, .nmax = 32, .nstep = 2,
+                 .kmin = 1, .kmax = 8, .lt = {0, 1, 2, 4}, .nlt = 4 };
+    const char *mode = "grid", *csv = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:w:r:m:B:N:K:L:AH:s:p:S:o:h")) != -1) {
+        switch (opt) {
+        case 'l': g_rate = atof(optarg); break;
+        case 'w': g_slo_s = atof(optarg); break;
+        case 'r': g_max_reject = atof(optarg) / 100.0; break;
+        case 'm': mode = optarg; break;
+        case 'B': if (!parse_range(optarg, &sp.bmin, &sp.bmax, &(int){0})) goto bad; break;
+        case 'N': if (!parse_range(optarg, &sp.nmin, &sp.nmax, &sp.nstep)) goto bad; break;
+        case 'K': if (!parse_range(optarg, &sp.kmin, &sp.kmax, &(int){0})) goto bad; break;
+        case 'L': {
+            sp.nlt = 0;
+            for (char *t = strtok(optarg, ","); t && sp.nlt < MAX_LT; t = strtok(NULL, ","))
+                sp.lt[sp.nlt++] = atoi(t);
+            if (sp.nlt == 0) goto bad;
+            break;
+        }
+        case 'A': sp.amax = 1; break;
+        case 'H': g_horizon_ms = (long long)(atof(optarg) * 1000); break;
+        case 's': g_trip_scale = atoi(optarg); break;
+        case 'p': g_type2 = atof(optarg); break;
+        case 'S': g_seed = strtoull(optarg, NULL, 10); break;
+        case 'o': csv = optarg; break;
+        default:  goto bad;
+        }
+    }
+    if (g_rate <= 0 || g_slo_s <= 0 || sp.nstep < 1 || g_horizon_ms < 10000 ||
+        g_trip_scale < 0 || sp.bmax > MAX_FLEET) goto bad;
+    setbuf(stdout, NULL);
+
+    if (csv) {
+        g_csv = fopen(csv, "w");
+        if (!g_csv) {
+            perror(csv);
+            return 1;
+        }
+        fprintf(g_csv, "boats,n1,n2,k,load_timeout,adaptive,cost,ok,p50_s,p99_s,"
+                       "throughput,occupancy,reject,sailed\n");
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    Plan best;
+    Eval be = {0};
+    int found = !strcmp(mode, "hill") ? search_hill(&sp, &best, &be)
+                                      : search_grid(&sp, &best, &be);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    printf("[PLAN] tempo %.2f os/s, SLO p99 <= %.1f s i odrzuceń <= %.1f%%, "
+           "horyzont %lld s, tryb %s: %ld symulacji w %.2f s\n",
+           g_rate, g_slo_s, g_max_reject * 100, g_horizon_ms / 1000, mode, g_evals, secs);
+    if (!found) {
+        printf("[PLAN] Żadna konfiguracja z przestrzeni nie spełnia SLO - "
+               "powiększ zakres (-B/-N/-K) albo złagodź SLO.\n");
+        if (g_csv) fclose(g_csv);
+        return 2;
+    }
+
+    printf("[PLAN] Najtańsza: łodzi=%d N1=%d N2=%d K=%d LOAD_TIMEOUT=%d ADAPTIVE=%d (koszt %d)\n",
+           best.boats, best.c.n1, best.c.n2, best.c.k, best.c.load_timeout, best.c.adaptive, be.cost);
+    printf("[PLAN]   p50=%.2fs p99=%.2fs, przepływ %.3f os/s, obłożenie %.1f%%, "
+           "odrzuceń %.2f%%, rejsów %ld\n",
+           be.p50_s, be.p99_s, be.throughput, be.occupancy * 100, be.reject * 100, be.trips);
+    char cf[128];
+    boatconf_format(&best.c, cf, sizeof(cf));
+    printf("[PLAN]   sternik.conf: %s (flota: ./sternik <czas> %d)\n", cf, best.boats);
+
+    /* Krzywe: ta sama flota przy innym tempie przybywania */
+    printf("\n%8s %10s %12s %12s %9s %9s %8s\n",
+           "x tempo", "os/s", "przepływ", "obłożenie%", "p50_s", "p99_s", "odrz%");
+    static const double mult[] = { 0.25, 0.5, 0.75, 1.0, 1.25, 1.5 };
+    for (size_t i = 0; i < sizeof(mult) / sizeof(mult[0]); i++) {
+        Eval e = simulate(&best, g_rate * mult[i]);
+        printf("%8.2f %10.3f %12.3f %12.1f %9.2f %9.2f %8.2f%s\n",
+               mult[i], g_rate * mult[i], e.throughput, e.occupancy * 100,
+               e.p50_s, e.p99_s, e.reject * 100,
+               (e.p99_s <= g_slo_s && e.reject <= g_max_reject) ? "" : "  (poza SLO)");
+    }
+    if (g_csv) fclose(g_csv);
+    return 0;
+
+bad:
+    usage(argv[0]);
+    return 1;
+}
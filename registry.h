@@ -0,0 +1,145 @@
+/*******************************************************
+ * File: registry.h
+ *
+ * Rejestr wygenerowanych pasażerów orchestratora (do powrotów).
+ *  - arena w kawałkach po REG_CHUNK wpisów: wpisy nigdy się nie
+ *    przesuwają, rośnie tylko tablica wskaźników na kawałki;
+ *    wpis o numerze i to chunks[i >> SHIFT][i & MASK] - O(1);
+ *  - indeks grup: tablica mieszająca grupa -> (pierwszy, ostatni
+ *    członek), członkowie połączeni listą przez pole next - powrót
+ *    całej grupy to O(rozmiar grupy), bez przeglądania rejestru.
+ * Brak stałych limitów - ogranicza tylko pamięć.
+ ******************************************************/
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REG_CHUNK_SHIFT 12
+#define REG_CHUNK       (1 << REG_CHUNK_SHIFT)
+#define REG_GROUPS_INIT 1024   // początkowa pojemność indeksu (potęga dwójki)
+
+typedef struct {
+    int pid;
+    int age;
+    int group;   // 0 - pasażer bez grupy
+    int next;    // następny członek tej samej grupy (numer wpisu) albo -1
+} RegEntry;
+
+/* Komórka indeksu grup; group == 0 - wolna */
+typedef struct {
+    int group;
+    int head, tail;
+    int count;
+} RegGroup;
+
+typedef struct {
+    RegEntry **chunks;
+    size_t     nchunks, cap_chunks;
+    size_t     count;
+    RegGroup  *groups;
+    size_t     gcap, gcount;
+} Registry;
+
+static int reg_init(Registry *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->gcap = REG_GROUPS_INIT;
+    r->groups = calloc(r->gcap, sizeof(RegGroup));
+    return r->groups ? 0 : -1;
+}
+
+static void reg_free(Registry *r)
+{
+    for(size_t i=0; i<r->nchunks; i++) free(r->chunks[i]);
+    free(r->chunks);
+    free(r->groups);
+    memset(r, 0, sizeof(*r));
+}
+
+static RegEntry *reg_at(const Registry *r, size_t idx)
+{
+    return &r->chunks[idx >> REG_CHUNK_SHIFT][idx & (REG_CHUNK - 1)];
+}
+
+static size_t reg_gslot(int group, size_t gcap)
+{
+    return (size_t)(((uint64_t)(uint32_t)group * 0x9E3779B97F4A7C15ull) >> 32) & (gcap - 1);
+}
+
+/* Komórka grupy w indeksie (istniejąca albo wolna na nią) */
+static RegGroup *reg_gfind(RegGroup *tab, size_t gcap, int group)
+{
+    size_t i = reg_gslot(group, gcap);
+    while(tab[i].group != 0 && tab[i].group != group) i = (i + 1) & (gcap - 1);
+    return &tab[i];
+}
+
+static RegGroup *reg_group(const Registry *r, int group)
+{
+    if(group == 0) return NULL;
+    RegGroup *g = reg_gfind(r->groups, r->gcap, group);
+    return g->group == group ? g : NULL;
+}
+
+/* Indeks rośnie x2 przy zapełnieniu w 1/2 */
+static int reg_ggrow(Registry *r)
+{
+    size_t ncap = r->gcap * 2;
+    RegGroup *nt = calloc(ncap, sizeof(RegGroup));
+    if(!nt) return -1;
+    for(size_t i=0; i<r->gcap; i++){
+        if(r->groups[i].group) *reg_gfind(nt, ncap, r->groups[i].group) = r->groups[i];
+    }
+    free(r->groups);
+    r->groups = nt;
+    r->gcap = ncap;
+    return 0;
+}
+
+/* Dopisuje pasażera; zwraca numer wpisu albo -1 (brak pamięci) */
+static long reg_add(Registry *r, int pid, int age, int group)
+{
+    if(r->count == r->nchunks * REG_CHUNK){
+        if(r->nchunks == r->cap_chunks){
+            size_t nc = r->cap_chunks ? r->cap_chunks * 2 : 16;
+            RegEntry **np = realloc(r->chunks, nc * sizeof(RegEntry*));
+            if(!np) return -1;
+            r->chunks = np;
+            r->cap_chunks = nc;
+        }
+        r->chunks[r->nchunks] = malloc(REG_CHUNK * sizeof(RegEntry));
+        if(!r->chunks[r->nchunks]) return -1;
+        r->nchunks++;
+    }
+    if(group != 0 && !reg_group(r, group) && (r->gcount + 1) * 2 > r->gcap){
+        if(reg_ggrow(r) < 0) return -1;
+    }
+
+    long idx = (long)r->count++;
+    RegEntry *e = reg_at(r, idx);
+    e->pid = pid;
+    e->age = age;
+    e->group = group;
+    e->next = -1;
+
+    if(group != 0){
+        RegGroup *g = reg_gfind(r->groups, r->gcap, group);
+        if(g->group == 0){
+            g->group = group;
+            g->head = g->tail = (int)idx;
+            g->count = 1;
+            r->gcount++;
+        } else {
+            reg_at(r, g->tail)->next = (int)idx;
+            g->tail = (int)idx;
+            g->count++;
+        }
+    }
+    return idx;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*******************************************************
+ * File: rundir.h
+ *
+ * Katalog przebiegu: wszystkie nazwy plików symulacji (FIFO, ledger,
+ * sternik.state, sternik.conf, gniazdo sterujące, podsumowania) są
+ * względne, więc proces wchodzi na starcie do SIM_RUN_DIR i każdy
+ * przebieg ma własną przestrzeń nazw - kilka symulacji może działać
+ * naraz bez kolizji. Bez zmiennej - bieżący katalog, jak dotąd.
+ * Orchestrator zamienia ścieżkę na bezwzględną i eksportuje ją dzieciom;
+ * pliki wykonywalne uruchamia z własnego katalogu (bin_path), nie z cwd.
+ ******************************************************/
+
+#ifndef RUNDIR_H
+#define RUNDIR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define RUN_DIR_ENV "SIM_RUN_DIR"
+
+/* Wejście do katalogu przebiegu (create=1 - utwórz, jeśli go nie ma).
+   0 - w porządku albo brak SIM_RUN_DIR, -1 - błąd (errno). */
+static int rundir_enter(int create)
+{
+    const char *d = getenv(RUN_DIR_ENV);
+    if (!d || !*d) return 0;
+    if (create && mkdir(d, 0777) < 0 && errno != EEXIST) return -1;
+    return chdir(d);
+}
+
+/* Ścieżka do programu 'name' leżącego obok bieżącego pliku wykonywalnego
+   (/proc/self/exe jest bezwzględne - nie zależy od cwd) */
+static void bin_path(char *out, size_t sz, const char *name)
+{
+    char dir[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", dir, sizeof(dir) - 1);
+    char *slash = NULL;
+    if (n > 0) {
+        dir[n] = '\0';
+        slash = strrchr(dir, '/');
+    }
+    if (slash) *slash = '\0';
+    else strcpy(dir, ".");
+    snprintf(out, sz, "%s/%s", dir, name);
+}
+
+#endif
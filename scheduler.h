@@ -0,0 +1,244 @@
+/*******************************************************
+ * File: scheduler.h
+ *
+ * Harmonogram zdarzeń sternika: koło czasowe (hashed timer wheel)
+ * taktowane przez timerfd oraz mała pula wątków roboczych.
+ *
+ * Zadanie (SchedTask) ma najwyżej jeden timer (termin w ms zegara
+ * monotonicznego). Gdy termin minie albo ktoś zadanie "obudzi"
+ * (sched_wake), trafia ono do kolejki gotowych i jeden z wątków
+ * roboczych woła t->run(t). To samo zadanie nigdy nie działa na dwóch
+ * wątkach naraz - budzenie w trakcie działania ustawia 'again' i zadanie
+ * zostanie uruchomione ponownie zaraz po powrocie z run().
+ *
+ * Dzięki temu tysiące łodzi w rejsie to tylko wpisy w kole,
+ * a nie tysiące zablokowanych wątków.
+ ******************************************************/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#define WHEEL_SLOTS       512   // liczba slotów koła (potęga dwójki)
+#define WHEEL_TICK_MS     5     // rozdzielczość koła
+#define SCHED_MAX_WORKERS 16
+
+/* Blokady koła i kolejki gotowych. Program może je podmienić przed
+   #include (np. na profilowane z lockprof.h); 'site' to nazwa miejsca:
+   wake - budzenie zadania, at - ustawienie terminu, tick - wątek koła. */
+#ifndef SCHED_LOCK
+#define SCHED_LOCK(m, site)   pthread_mutex_lock(m)
+#define SCHED_UNLOCK(m, site) pthread_mutex_unlock(m)
+#endif
+
+typedef struct SchedTask SchedTask;
+struct SchedTask {
+    void (*run)(SchedTask *t);
+    long long deadline;          // termin timera (ms), ważny gdy in_wheel
+    SchedTask *w_prev, *w_next;  // lista w slocie koła (tylko pod wlock)
+    int in_wheel;
+    SchedTask *d_next;           // lista zadań z minionym terminem (wątek koła)
+    SchedTask *r_next;           // kolejka gotowych
+    int queued, running, again;
+};
+
+typedef struct {
+    SchedTask *slot[WHEEL_SLOTS];
+    long long tick;              // ostatni obsłużony tick koła
+    pthread_mutex_t wlock;       // koło
+
+    SchedTask *rq_head, *rq_tail;
+    pthread_mutex_t rlock;       // kolejka gotowych + flagi queued/running/again
+    pthread_cond_t  rcond;
+
+    volatile int stop;
+    int tfd;
+    pthread_t timer_thread;
+    pthread_t workers[SCHED_MAX_WORKERS];
+    int nworkers;
+} Scheduler;
+
+static long long sched_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/* Zadanie do kolejki gotowych (albo 'again', jeśli właśnie działa) */
+static void sched_wake(Scheduler *s, SchedTask *t)
+{
+    SCHED_LOCK(&s->rlock, wake);
+    if(t->running){
+        t->again = 1;
+    } else if(!t->queued){
+        t->queued = 1;
+        t->r_next = NULL;
+        if(s->rq_tail) s->rq_tail->r_next = t;
+        else s->rq_head = t;
+        s->rq_tail = t;
+        pthread_cond_signal(&s->rcond);
+    }
+    SCHED_UNLOCK(&s->rlock, wake);
+}
+
+static void wheel_unlink(Scheduler *s, SchedTask *t)
+{
+    if(t->w_prev) t->w_prev->w_next = t->w_next;
+    else s->slot[((t->deadline + WHEEL_TICK_MS-1)/WHEEL_TICK_MS) & (WHEEL_SLOTS-1)] = t->w_next;
+    if(t->w_next) t->w_next->w_prev = t->w_prev;
+    t->w_prev = t->w_next = NULL;
+    t->in_wheel = 0;
+}
+
+/* Ustawia (albo przestawia) jedyny timer zadania na termin 'deadline' */
+static void sched_at(Scheduler *s, SchedTask *t, long long deadline)
+{
+    SCHED_LOCK(&s->wlock, at);
+    if(t->in_wheel) wheel_unlink(s, t);
+    long long tk = (deadline + WHEEL_TICK_MS-1)/WHEEL_TICK_MS;
+    if(tk <= s->tick){
+        /* termin już minął - od razu do gotowych */
+        SCHED_UNLOCK(&s->wlock, at);
+        sched_wake(s, t);
+        return;
+    }
+    t->deadline = deadline;
+    SchedTask **head = &s->slot[tk & (WHEEL_SLOTS-1)];
+    t->w_prev = NULL;
+    t->w_next = *head;
+    if(*head) (*head)->w_prev = t;
+    *head = t;
+    t->in_wheel = 1;
+    SCHED_UNLOCK(&s->wlock, at);
+}
+
+static void sched_cancel(Scheduler *s, SchedTask *t)
+{
+    SCHED_LOCK(&s->wlock, at);
+    if(t->in_wheel) wheel_unlink(s, t);
+    SCHED_UNLOCK(&s->wlock, at);
+}
+
+/* Wątek koła: co WHEEL_TICK_MS (timerfd) przesuwa koło i budzi zadania,
+   którym minął termin. Zadania z dalszym terminem (kolejny obrót) zostają.
+   Zadania do obudzenia idą na osobną listę (d_next): budzimy je już bez
+   wlock, a w tym czasie zadanie może działać (sched_wake z innej drogi)
+   i sched_at wstawia je z powrotem do koła przez w_next/w_prev. */
+static void *sched_timer_main(void *arg)
+{
+    Scheduler *s = (Scheduler*)arg;
+    while(!s->stop){
+        uint64_t exp;
+        if(read(s->tfd, &exp, sizeof(exp)) != sizeof(exp)) continue;
+
+        SchedTask *due = NULL;
+        long long now_tick = sched_now_ms()/WHEEL_TICK_MS;
+        SCHED_LOCK(&s->wlock, tick);
+        while(s->tick < now_tick){
+            s->tick++;
+            SchedTask *t = s->slot[s->tick & (WHEEL_SLOTS-1)];
+            while(t){
+                SchedTask *nx = t->w_next;
+                if((t->deadline + WHEEL_TICK_MS-1)/WHEEL_TICK_MS <= s->tick){
+                    wheel_unlink(s, t);
+                    t->d_next = due;
+                    due = t;
+                }
+                t = nx;
+            }
+        }
+        SCHED_UNLOCK(&s->wlock, tick);
+
+        while(due){
+            SchedTask *nx = due->d_next;
+            due->d_next = NULL;
+            sched_wake(s, due);
+            due = nx;
+        }
+    }
+    return NULL;
+}
+
+/* Wątek roboczy: bierze gotowe zadania i uruchamia ich run() */
+static void *sched_worker_main(void *arg)
+{
+    Scheduler *s = (Scheduler*)arg;
+    pthread_mutex_lock(&s->rlock);
+    while(1){
+        while(!s->rq_head && !s->stop){
+            pthread_cond_wait(&s->rcond, &s->rlock);
+        }
+        if(!s->rq_head) break;   // stop i nic do zrobienia
+
+        SchedTask *t = s->rq_head;
+        s->rq_head = t->r_next;
+        if(!s->rq_head) s->rq_tail = NULL;
+        t->queued  = 0;
+        t->running = 1;
+        pthread_mutex_unlock(&s->rlock);
+
+        t->run(t);
+
+        pthread_mutex_lock(&s->rlock);
+        t->running = 0;
+        if(t->again){
+            t->again  = 0;
+            t->queued = 1;
+            t->r_next = NULL;
+            if(s->rq_tail) s->rq_tail->r_next = t;
+            else s->rq_head = t;
+            s->rq_tail = t;
+        }
+    }
+    pthread_mutex_unlock(&s->rlock);
+    return NULL;
+}
+
+/* Start koła (timerfd) i puli nworkers wątków. 0 - ok, -1 - błąd. */
+static int sched_start(Scheduler *s, int nworkers)
+{
+    memset(s, 0, sizeof(*s));
+    pthread_mutex_init(&s->wlock, NULL);
+    pthread_mutex_init(&s->rlock, NULL);
+    pthread_cond_init(&s->rcond, NULL);
+    s->tick = sched_now_ms()/WHEEL_TICK_MS;
+
+    s->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if(s->tfd<0) return -1;
+    struct itimerspec its;
+    its.it_interval.tv_sec  = 0;
+    its.it_interval.tv_nsec = WHEEL_TICK_MS*1000000L;
+    its.it_value = its.it_interval;
+    if(timerfd_settime(s->tfd, 0, &its, NULL)<0) return -1;
+
+    if(nworkers<1) nworkers = 1;
+    if(nworkers>SCHED_MAX_WORKERS) nworkers = SCHED_MAX_WORKERS;
+    s->nworkers = nworkers;
+    pthread_create(&s->timer_thread, NULL, sched_timer_main, s);
+    for(int i=0; i<nworkers; i++){
+        pthread_create(&s->workers[i], NULL, sched_worker_main, s);
+    }
+    return 0;
+}
+
+/* Zatrzymanie: wątki robocze kończą po opróżnieniu kolejki gotowych */
+static void sched_stop(Scheduler *s)
+{
+    pthread_mutex_lock(&s->rlock);
+    s->stop = 1;
+    pthread_cond_broadcast(&s->rcond);
+    pthread_mutex_unlock(&s->rlock);
+
+    pthread_join(s->timer_thread, NULL);   // timerfd tyka, więc wątek koła zauważy stop
+    for(int i=0; i<s->nworkers; i++) pthread_join(s->workers[i], NULL);
+    close(s->tfd);
+}
+
+#endif
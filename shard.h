@@ -0,0 +1,60 @@
+/*******************************************************
+ * File: shard.h
+ *
+ * Podział kasjerów na shardy. Orchestrator uruchamia KASJER_SHARDS
+ * procesów kasjer (zmienna środowiskowa, domyślnie 1); każdy ma własne
+ * FIFO wejściowe i własną część historii "kto już płynął".
+ * Pasażer wybiera kasjera skrótem swojego id, więc ten sam pasażer
+ * zawsze trafia do tego samego sharda - zniżka za drugi rejs działa
+ * bez wymiany stanu między kasjerami.
+ *
+ * Nazwy: przy jednym kasjerze - jak dotąd fifo_kasjer_in i kasjer.ledger,
+ * przy wielu - fifo_kasjer_in_<k> i kasjer_<k>.ledger.
+ ******************************************************/
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define KASJER_SHARDS_MAX 16
+#define KASJER_SHARDS_ENV "KASJER_SHARDS"
+
+/* Liczba kasjerów z KASJER_SHARDS (1..KASJER_SHARDS_MAX) */
+static int kasjer_shards(void)
+{
+    const char *s = getenv(KASJER_SHARDS_ENV);
+    int n = (s && *s) ? atoi(s) : 1;
+    if(n < 1) n = 1;
+    if(n > KASJER_SHARDS_MAX) n = KASJER_SHARDS_MAX;
+    return n;
+}
+
+/* Shard pasażera: mieszanie bitów (finalizer MurmurHash3), żeby kolejne
+   id - a takie nadaje generator - rozkładały się równo */
+static int shard_of(int pid, int nshards)
+{
+    uint32_t h = (uint32_t)pid;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return (int)(h % (uint32_t)nshards);
+}
+
+static void kasjer_fifo_name(char *out, size_t sz, int shard, int nshards)
+{
+    if(nshards <= 1) snprintf(out, sz, "fifo_kasjer_in");
+    else             snprintf(out, sz, "fifo_kasjer_in_%d", shard);
+}
+
+static void kasjer_ledger_name(char *out, size_t sz, int shard, int nshards)
+{
+    if(nshards <= 1) snprintf(out, sz, "kasjer.ledger");
+    else             snprintf(out, sz, "kasjer_%d.ledger", shard);
+}
+
+#endif
@@ -13,671 +13,1178 @@
 #include <time.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+
+#include "passqueue.h"
+#include "lockprof.h"
+
+/* Miejsca blokad dla profilera (LOCKPROF=1, lockprof.h). Blokady
+   harmonogramu też, więc przed scheduler.h. Krok łodzi liczy się
+   osobno dla każdej fazy i typu łodzi (1 - N1/T1, 2 - N2/T2). */
+enum {
+    LP_SCHED_wake, LP_SCHED_at, LP_SCHED_tick,
+    LP_STOP,
+    LP_IDLE1, LP_LOAD1, LP_SAIL1, LP_UNLOAD1,
+    LP_IDLE2, LP_LOAD2, LP_SAIL2, LP_UNLOAD2,
+    LP_CKPT, LP_INFO, LP_CONF, LP_DONE,
+    LP_NSITES
+};
+static const char *const lp_site_names[LP_NSITES] = {
+    "harmonogram: budzenie", "harmonogram: termin", "harmonogram: koło",
+    "stop (sygnał)",
+    "łódź1 czeka", "łódź1 załadunek", "łódź1 rejs", "łódź1 wyładunek",
+    "łódź2 czeka", "łódź2 załadunek", "łódź2 rejs", "łódź2 wyładunek",
+    "checkpoint", "INFO", "konfiguracja", "koniec łodzi",
+};
+#define SCHED_LOCK(m, site)   LpHeld lp_h_ = lp_lock(m)
+#define SCHED_UNLOCK(m, site) lp_unlock(m, lp_h_, LP_SCHED_##site)
+#include "scheduler.h"
+#include "checkpoint.h"
+#include "trace.h"
+#include "chrome_trace.h"
+#include "lineparse.h"
+#include "shard.h"
+#include "boatconf.h"
+#include "depart.h"
+#include "boatphase.h"
+#include "rundir.h"
+
+/* Parametry łodzi i rejsów (N1/T1, N2/T2, K, LOAD_TIMEOUT) - konfiguracja
+   w trakcie pracy, patrz boatconf.h. Stałe (czas przejścia po pomoście
+   WALK_MS, limit kolejki QUEUE_LIMIT) też tam - korzysta z nich planner. */
+
+/* Ile ms trwa jedna "sekunda" rejsu: 0 = rejs tylko logiczny (bez czekania),
+   1000 = realny czas T1/T2. Na morzu łódź wybiera pasażerów na kolejny rejs. */
+#define TRIP_SCALE_MS 0
+
+/* Liczba łodzi (domyślna; flota może być większa - argv[2]);
+   górne limity N i K są w boatconf.h */
+#define NBOATS 2
+#define MAX_BOATS 1024
+
+/* Wątki robocze harmonogramu - obsługują wszystkie łodzie naraz */
+#define SCHED_WORKERS 4
+
+/* Co ile ms bezczynna łódź sama zagląda do kolejek (poza budzeniem) */
+#define IDLE_POLL_MS 100
+
+/* Plik stanu (mmap) i co ile ms zapisujemy do niego snapshot kolejek.
+   Po awarii nowy sternik wznawia pracę z ostatniego snapshotu. */
+#define STATE_FILE       "sternik.state"
+#define CKPT_INTERVAL_MS 100
+#define CKPT_MAX_ITEMS   (2*QSIZE + 2*N_MAX + K_MAX)
+
+
+/* Co ile ms pętla główna sprawdza zmianę kredytu i czas, gdy nic nie przychodzi */
+#define CREDIT_CHECK_MS 10
+
+/* Co ile ms sternik ogłasza kasjerowi wolne miejsca w kolejkach (CREDIT) */
+#define CREDIT_INTERVAL_MS 200
+
+/* Podsumowanie pracy (dla sweep): rejsy, przewiezieni i czas czekania
+   od wejścia do kolejki do wypłynięcia (z siedzeniem na pokładzie) - histogram co WAIT_BUCKET_MS,
+   ostatni przedział zbiera wszystko powyżej */
+#define SUMMARY_FILE   "sternik.summary"
+#define WAIT_BUCKET_MS 10
+#define WAIT_BUCKETS   6001
 
-/* Parametry łodzi i rejsów */
-#define N1 10
-#define T1 4   // "teoretyczny" czas rejsu (łódź1)
-#define N2 11
-#define T2 5   // "teoretyczny" czas rejsu (łódź2)
-
-/* Pojemność pomostu (K<Ni) */
-#define K  8
+/* Czas startu i końca programu (do ewent. globalnego timeoutu) */
+static time_t start_time, end_time;
 
-/* Po ilu sekundach (max) łódź kończy załadunek i wypływa nawet niepełna. */
-#define LOAD_TIMEOUT 2
+/* Pomost – może być w trybie: wolny/ INBOUND/ OUTBOUND */
+typedef enum {INBOUND, OUTBOUND, FREE} PomostState;
 
-/* Rozmiar kolejek */
-#define QSIZE 100000
+/* Pasażer idący po pomoście */
+typedef struct {
+    PassengerItem p;
+    long long until;     // kiedy (mono_ms) dojdzie do końca pomostu
+} Walker;
+
+/* Struktura do pomostu -> kazda lodz posiada swoj wlasny pomost.
+   Naraz do k (=K) osób, wszystkie w jednym kierunku (walkers[0..count-1]).
+   Kierunków nie trzeba rozstrzygać: pomostu używa tylko jego łódź,
+   a wyładunek (OUTBOUND) i załadunek (INBOUND) to kolejne fazy
+   boat_step - załadunek rusza dopiero, gdy ostatni zszedł. */
+typedef struct {
+    PomostState state;
+    int count;           // ilu pasażerów aktualnie na pomoście
+    int k;               // pojemność (K) - zmieniana tylko na pustym pomoście
+    Walker walkers[K_MAX];
+    int owner;           // numer łodzi (do śladu)
+    long long phase_us;  // początek bieżącej fazy (do śladu)
+} Pomost;
 
-/* Zakładamy max grupy, np. do 100000 */
-#define MAX_GROUP 100000
+/* Co dalej po wyładunku */
+typedef enum {AFTER_TRIP, AFTER_NOTIME} UnloadAfter;
 
-/* Struktura pasażera w kolejce */
+/* Łódź: parametry, kolejki (normal i skip), pomost i stan */
 typedef struct {
-    int  pid;         // ID pasażera
-    int  disc;        // Zniżka (0 lub np. 50)
-    int  group;       // ID grupy (0 - brak)
-    char pass_fifo[128]; // nazwa FIFO pasażera - do wysłania "UNLOADED"
-} PassengerItem;
+    SchedTask task;      // musi być pierwsze - harmonogram woła task.run
+    pthread_mutex_t lock;// stan łodzi (boat_step, INFO)
+    int id;              // numer łodzi (1..nboats)
+    int capacity;        // N1 / N2
+    int trip_time;       // T1 / T2 - "teoretyczny" czas rejsu (s)
+    int load_timeout;    // LOAD_TIMEOUT (s) - max okno załadunku, 0 = bez limitu
+    int adaptive;        // ADAPTIVE - okno wg tempa przybyć (depart.h)
+    unsigned conf_gen;   // wersja konfiguracji, z której wzięto powyższe
+    int groups;          // 1 -> łódź dla grup (parametry N2/T2); grupa to jeden wpis
+    PassQueue queue, queue_skip;
+    Pomost pomost;
+    PassengerItem rejs[N_MAX];   // pasażerowie na pokładzie (grupa = jeden wpis)
+    int rejsCount;
+    int seats;                   // zajęte miejsca (osoby) - suma rejs[].size
+    PassengerItem next[N_MAX];   // wybrani (na morzu) na następny rejs
+    int nextHead, nextCount;
+
+    BoatPhase phase;
+    long long load_start, load_end, load_ms;  // okno załadunku
+    long long back;                           // powrót z rejsu
+    long long unload_start;
+    long long depart_us;                      // wypłynięcie (do śladu)
+    int unload_n, unload_next;                // wyładunek rejs[0..unload_n-1]
+    const char *unload_reason;                // NULL -> UNLOADED
+    UnloadAfter unload_after;
+
+    int trips, carried;          // liczniki: rejsy, dowiezieni pasażerowie
+
+    /* Przybycia liczy flush_batch (pętla główna, bez blokady łodzi),
+       boat_step przenosi je do kontrolera wypłynięcia pod b->lock */
+    atomic_uint arrivals;
+    DepartCtl dep;
+
+    /* Osoby (nie wpisy - grupa to jeden wpis) w queue+queue_skip: limit
+       kolejki i kredyt liczymy w osobach, jak kasjer. Dopisuje pętla
+       główna, odejmuje łódź - stąd atomowo. */
+    atomic_int waiting;
+
+    /* Stan aktywności łodzi (czy jest jeszcze dozwolona do rejsu),
+       i czy łódź jest aktualnie w rejsie (inrejs=1 -> sygnał nie wymusza unload).
+       active zeruje pętla główna (boat_stop) albo zakończenie symulacji. */
+    volatile sig_atomic_t active, inrejs;
+} Boat;
+
+static Boat *boats;
+static int   nboats = NBOATS;
+
+/* Bieżąca konfiguracja (boatconf.h): zmienia ją pętla główna (CONFIG)
+   pod conf_mu i podbija conf_gen; łódź sprawdza conf_gen na starcie
+   okna załadunku i wtedy kopiuje swoje parametry. */
+static BoatConf        conf = BOATCONF_DEFAULT;
+static pthread_mutex_t conf_mu = PTHREAD_MUTEX_INITIALIZER;
+static atomic_uint     conf_gen = 1;
+
+/* Histogram czasu czekania (łodzie wypływają z wielu wątków) */
+static atomic_uint  wait_hist[WAIT_BUCKETS];
+static atomic_llong wait_max_ms;
+
+/* Harmonogram łodzi i licznik łodzi, które jeszcze pracują */
+static Scheduler sched;
+static atomic_int      boats_running = 0;
+static pthread_mutex_t done_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond_done  = PTHREAD_COND_INITIALIZER;
 
+/* Plik do logowania zdarzeń */
+// logi juz nie potrzebne, zostawiam bo mozna latwo dorobic
 
+static void logMsg(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stdout, fmt, ap);
+    fflush(stdout);
+    va_end(ap);
+}
 
+/* Zegar monotoniczny w ms (do odmierzania interwałów) */
+static long long mono_ms(void)
+{
+    return sched_now_ms();
+}
 
-/* Kolejka cykliczna */
-typedef struct {
-    PassengerItem items[QSIZE];
-    int front, rear, count;
-} PassQueue;
-
-static void initQueue(PassQueue *q) {
-    q->front = 0;
-    q->rear  = 0;
-    q->count = 0;
-}
-static int isEmpty(PassQueue *q){
-    return (q->count==0);
-}
-static int isFull(PassQueue *q) {
-    return (q->count==QSIZE);
-}
-static int enqueue(PassQueue *q, PassengerItem p){
-    if(isFull(q)) return -1;
-    q->items[q->rear] = p;
-    q->rear = (q->rear + 1) % QSIZE;
-    q->count++;
-    return 0;
+/* Ile ms zostało do end_time (zegar ścienny, jak end_time) */
+static long long ms_left(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)end_time*1000 - ((long long)ts.tv_sec*1000 + ts.tv_nsec/1000000);
 }
-static PassengerItem dequeue(PassQueue *q){
-    PassengerItem tmp = {0,0,0,""};
-    if(isEmpty(q)) return tmp;
-    tmp = q->items[q->front];
-    q->front = (q->front + 1) % QSIZE;
-    q->count--;
-    return tmp;
+
+/* Łódź o numerze bno (1..nboats) albo NULL */
+static Boat *boat_by_no(int bno)
+{
+    return (bno>=1 && bno<=nboats) ? &boats[bno-1] : NULL;
 }
 
-/* Kolejki dla obu łodzi (normal i skip) */
-static PassQueue queueBoat1, queueBoat1_skip;
-static PassQueue queueBoat2, queueBoat2_skip;
+/* Ilu pasażerów (osób) czeka (normal+skip) na daną łódź. */
+static int boat_waiting(Boat *b)
+{
+    return atomic_load_explicit(&b->waiting, memory_order_relaxed);
+}
 
-/* Dla boat2 - liczenie członków grup, by sprawdzić czy 
-   np. dziecko i opiekun (grupa=ta sama) dotarli */
-static int groupCount[MAX_GROUP];
-static int groupTarget[MAX_GROUP];
+/* Wstawienie do kolejki łodzi z licznikiem osób */
+static int boat_enqueue(Boat *b, int skip, const PassengerItem *p)
+{
+    if(enqueue(skip ? &b->queue_skip : &b->queue, p)<0) return -1;
+    atomic_fetch_add_explicit(&b->waiting, p->size, memory_order_relaxed);
+    return 0;
+}
 
-/* Stan aktywności łodzi (czy jest jeszcze dozwolona do rejsu),
-   i czy łódź jest aktualnie w rejsie (boatX_inrejs=1 -> sygnał nie wymusza unload) */
-static volatile sig_atomic_t boat1_active=1, boat1_inrejs=0;
-static volatile sig_atomic_t boat2_active=1, boat2_inrejs=0;
+/* Następny z kolejek łodzi (skip przed normal) z licznikiem osób */
+static int boat_dequeue(Boat *b, PassengerItem *out)
+{
+    if(dequeue_prio(&b->queue_skip, &b->queue, out)<0) return -1;
+    atomic_fetch_sub_explicit(&b->waiting, out->size, memory_order_relaxed);
+    return 0;
+}
 
-/* Czas startu i końca programu (do ewent. globalnego timeoutu) */
-static time_t start_time, end_time;
+/* Budzi łódź (np. po wstawieniu pasażerów do jej kolejki) */
+static void boat_wake(Boat *b)
+{
+    sched_wake(&sched, &b->task);
+}
 
-/* Pomost – może być w trybie: wolny/ INBOUND/ OUTBOUND */
-typedef enum {INBOUND, OUTBOUND, FREE} PomostState;
-static PomostState pomost_state = FREE;
-static int pomost_count=0;  // ilu pasażerów aktualnie na pomoście
+/* Następny krok łodzi najpóźniej o 'when' (mono_ms) */
+static void boat_wake_at(Boat *b, long long when)
+{
+    sched_at(&sched, &b->task, when);
+}
 
-/* Mutex i zmienne warunkowe */
-static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  cond_pomost_free = PTHREAD_COND_INITIALIZER;
+/* Ile jeszcze pasażerów przyjmiemy do kolejki danej łodzi (kredyt). */
+static int boat_credit(Boat *b)
+{
+    int fr = QUEUE_LIMIT - boat_waiting(b);
+    return fr>0 ? fr : 0;
+}
 
-/* Plik do logowania zdarzeń */
-// logi juz nie potrzebne, zostawiam bo mozna latwo dorobic
+/* Wysyła krótką wiadomość do FIFO pasażera bez blokowania sternika.
+   Pasażer trzyma swoje FIFO otwarte do czytania od startu do końca, więc
+   wystarcza jedna próba: brak czytelnika (ENXIO) albo pliku (ENOENT)
+   znaczy, że pasażera już nie ma. Wołane z boat_step pod b->lock - bez
+   czekania. Zwraca 0 gdy się udało, -1 gdy pasażera nie ma. */
+static int notify_passenger(const char *fifo, const char *msg)
+{
+    int fd = open(fifo, O_WRONLY | O_NONBLOCK);
+    if(fd<0) return -1;
+    write(fd, msg, strlen(msg));
+    close(fd);
+    return 0;
+}
 
-static void logMsg(const char *fmt, ...)
+/* Zdarzenie śladu dla każdej osoby z wpisu (grupa: każdy członek) */
+static void trace_item(int type, const PassengerItem *p, int boat, int a, int b)
 {
-    va_list ap;
-    va_start(ap, fmt);
-    vfprintf(stdout, fmt, ap);
-    fflush(stdout);
-    va_end(ap);
+    if(p->size<=1){
+        trace_ev(type, p->pid, boat, a, b);
+        return;
+    }
+    for(int i=0; i<p->size; i++) trace_ev(type, p->member[i], boat, a, b);
 }
 
-/* Obsługa sygnałów – łódź1 i łódź2 kończą rejsy */
-static void sigusr1_handler(int s){
-    if(!boat1_inrejs){
-        logMsg("[BOAT1] (SIGUSR1) w porcie => zakończ i wyładuj.\n");
-    } else {
-        logMsg("[BOAT1] (SIGUSR1) w rejsie => dokończę rejs normalnie.\n");
+/* Odrzucenie pasażera: jawna odpowiedź zamiast cichego porzucenia,
+   żeby proces pasazer nie czekał w nieskończoność na UNLOADED. */
+static void reject_passenger(const PassengerItem *p, const char *reason)
+{
+    char tmp[96];
+    trace_item(TE_REJECT, p, 0, trace_reason(reason), 0);
+    snprintf(tmp, sizeof(tmp), "REJECTED %d %s\n", p->pid, reason);
+    if(notify_passenger(p->pass_fifo, tmp)<0){
+        logMsg("[STERNIK] nie mogę powiadomić %d o odrzuceniu\n", p->pid);
     }
-    boat1_active = 0;
 }
-static void sigusr2_handler(int s){
-    if(!boat2_inrejs){
-        logMsg("[BOAT2] (SIGUSR2) w porcie => zakończ i wyładuj.\n");
+
+/* Ogłoszenie kredytu kasjerom: "CREDIT <wolne_łódź1> .. <wolne_łódźN>"
+   dla całej floty (credit[0..nboats-1], NULL - wszędzie 0). Duża flota idzie
+   kawałkami "CREDIT @<od> ..." po CREDIT_CHUNK łodzi (lineparse.h).
+   Przy kilku kasjerach (shard.h) miejsca dzielimy między nich po równo -
+   każdy sprzedaje ze swojej części, więc razem nie przekroczą kolejek;
+   resztę z dzielenia dostają kolejni kasjerzy zależnie od numeru łodzi.
+   Otwarcie nieblokujące - jeśli kasjer nie czyta, po prostu pomijamy. */
+static void advertise_credit(const int *credit)
+{
+    int n = kasjer_shards();
+    for(int k=0; k<n; k++){
+        char name[64];
+        kasjer_fifo_name(name, sizeof(name), k, n);
+        int fd = open(name, O_WRONLY | O_NONBLOCK);
+        if(fd<0) continue;
+        for(int from=0; from<nboats; from+=CREDIT_CHUNK){
+            char tmp[CREDIT_CHUNK*12 + 32];
+            int len = from==0 ? snprintf(tmp, sizeof(tmp), "CREDIT")
+                              : snprintf(tmp, sizeof(tmp), "CREDIT @%d", from+1);
+            for(int i=from; i<nboats && i<from+CREDIT_CHUNK; i++){
+                int c = credit ? credit[i] : 0;
+                len += snprintf(tmp+len, sizeof(tmp)-len, " %d", c/n + ((k + i) % n < c%n));
+            }
+            tmp[len++] = '\n';
+            write(fd, tmp, len);
+        }
+        close(fd);
+    }
+}
+
+/* Sygnały policjanta – łódź1 (SIGUSR1) i łódź2 (SIGUSR2) kończą rejsy;
+   w większej flocie razem z nimi łodzie tego samego rodzaju (nieparzyste
+   i parzyste), żeby policjant mógł zatrzymać wszystkie.
+   Sygnały są zablokowane we wszystkich wątkach i odbierane przez signalfd
+   w pętli głównej, więc to zwykła funkcja: zatrzymanie łodzi idzie tą samą
+   drogą co wstawienie pasażera - flaga pod b->lock i boat_wake(). */
+static void boat_stop(Boat *b, const char *sig)
+{
+    LpHeld h = lp_lock(&b->lock);
+    if(!b->inrejs){
+        logMsg("[BOAT%d] (%s) w porcie => zakończ i wyładuj.\n", b->id, sig);
     } else {
-        logMsg("[BOAT2] (SIGUSR2) w rejsie => dokończę rejs normalnie.\n");
+        logMsg("[BOAT%d] (%s) w rejsie => dokończę rejs normalnie.\n", b->id, sig);
     }
-    boat2_active = 0;
+    b->active = 0;
+    lp_unlock(&b->lock, h, LP_STOP);
+    boat_wake(b);
 }
-/* Struktura do pomostu -> kazda lodz posiada swoj wlasny pomost*/
-typedef struct {
-    PomostState state;
-    int count;
-} Pomost;
 
-static Pomost pomost1 = {FREE, 0};
-static Pomost pomost2 = {FREE, 0};
+/* Funkcje do obsługi pomostu (wołane pod b->lock) */
 
-/* Funkcje do obsługi pomostu */
-static int enter_pomost(Pomost *pomost)
+/* Czy kolejna osoba może teraz wejść na pomost w kierunku dir */
+static int pomost_may_enter(Pomost *pm, PomostState dir)
 {
-    /* Jeżeli wolny lub INBOUND, to można wchodzić w tym kierunku.
-       Tylko jeśli pomost_count < K. */
-    if(pomost_state==FREE){
-        pomost_state = INBOUND;
-    } else if(pomost_state!=INBOUND){
-        return 0;
+    if(pm->count >= pm->k) return 0;
+    return pm->state==FREE || pm->state==dir;
+}
+
+/* Pasażer wchodzi na pomost - zejdzie z niego po WALK_MS */
+static void pomost_enter(Pomost *pm, PomostState dir, const PassengerItem *p)
+{
+    if(pm->state!=dir){
+        pm->state  = dir;
+        pm->phase_us = ct_now_us();
     }
-    if(pomost_count >= K) return 0;
+    pm->walkers[pm->count].p     = *p;
+    pm->walkers[pm->count].until = mono_ms() + WALK_MS;
+    pm->count++;
+}
 
-    pomost_count++;
-    return 1;
+/* Zdejmuje z pomostu tych, którzy już przeszli (do out[], w kolejności wejścia).
+   Gdy pomost się opróżni, przechodzi w stan FREE. */
+static int pomost_leave_done(Pomost *pm, long long now, PassengerItem *out)
+{
+    int n = 0, keep = 0;
+    for(int i=0; i<pm->count; i++){
+        if(pm->walkers[i].until <= now){
+            out[n++] = pm->walkers[i].p;
+        } else {
+            pm->walkers[keep++] = pm->walkers[i];
+        }
+    }
+    pm->count = keep;
+    if(n>0 && pm->count==0){
+        long long us = ct_now_us();
+        ct_span(pm->state==INBOUND ? "pomost INBOUND" : "pomost OUTBOUND", "pomost",
+                pm->owner, pm->phase_us, us - pm->phase_us, NULL);
+        pm->state = FREE;
+    }
+    return n;
 }
-static void leave_pomost_in(Pomost *pomost){
-    /* Zmniejsza liczbę na pomoście.
-       Jeśli zrobi się zero, to pomost może przejść w stan FREE. */
-    pomost_count--;
-    if(pomost_count==0){
-        pomost_state = FREE;
-        pthread_cond_broadcast(&cond_pomost_free);
+
+/* Ile ms do najbliższego zejścia kogoś z pomostu (1..100) */
+static int pomost_next_ms(Pomost *pm, long long now)
+{
+    long long due = now + 100;
+    for(int i=0; i<pm->count; i++){
+        if(pm->walkers[i].until < due) due = pm->walkers[i].until;
     }
+    int ms = (int)(due - now);
+    return ms<1 ? 1 : ms;
 }
-static void start_outbound(Pomost *pomost){
-    /* Łódź chce rozpocząć wyładunek (OUTBOUND).
-       Musi poczekać, aż pomost jest FREE. */
-    while(pomost_state != FREE){
-        pthread_cond_wait(&cond_pomost_free, &mutex);
+
+/* Ile miejsc na łodzi zajmą idący po pomoście (grupa idzie razem,
+   zajmuje jedno miejsce na pomoście, ale size na łodzi) */
+static int pomost_seats(const Pomost *pm)
+{
+    int n = 0;
+    for(int i=0; i<pm->count; i++) n += pm->walkers[i].p.size;
+    return n;
+}
+
+/* Wiadomość "UNLOADED <pid>" do pasażera, który zszedł z łodzi */
+static void send_unloaded(Boat *b, const PassengerItem *pp, const char *how)
+{
+    if(pp->pid>0 && pp->pass_fifo[0]){
+        char tmp[64];
+        snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp->pid);
+        trace_item(TE_UNLOADED, pp, b->id, 0, 0);
+        if(notify_passenger(pp->pass_fifo, tmp)==0){
+            logMsg("[BOAT%d] %sUNLOADED -> pasażer %d\n", b->id, how, pp->pid);
+        }
     }
-    pomost_state = OUTBOUND;
 }
-static void end_outbound(Pomost *pomost){
-    pomost_state = FREE;
-    pthread_cond_broadcast(&cond_pomost_free);
+
+/* Następny pasażer do wejścia: najpierw wybrani na morzu, potem kolejki */
+static int take_next(Boat *b, PassengerItem *out)
+{
+    if(b->nextHead < b->nextCount){
+        *out = b->next[b->nextHead++];
+        if(b->nextHead==b->nextCount) b->nextHead = b->nextCount = 0;
+        return 0;
+    }
+    return boat_dequeue(b, out);
 }
 
+/* Oddaje wpis wzięty przez take_next (nie zmieścił się) - zostaje
+   pierwszy w kolejności. take_next bierze z kolejek tylko przy pustym
+   next[], więc zawsze jest na niego miejsce. */
+static void untake(Boat *b, const PassengerItem *p)
+{
+    if(b->nextHead>0) b->next[--b->nextHead] = *p;
+    else {
+        b->next[0] = *p;
+        b->nextCount = 1;
+    }
+}
 
+/* Ile miejsc zajmą wybrani na następny rejs */
+static int next_seats(const Boat *b)
+{
+    int n = 0;
+    for(int i=b->nextHead; i<b->nextCount; i++) n += b->next[i].size;
+    return n;
+}
 
-/* Prototypy wątków dla łodzi */
-void *boat1_thread(void *arg);
-void *boat2_thread(void *arg);
+/* Wybrani na następny rejs, który się nie odbędzie - odsyłamy z powodem */
+static void release_next(Boat *b, const char *reason)
+{
+    for(int i=b->nextHead; i<b->nextCount; i++){
+        reject_passenger(&b->next[i], reason);
+    }
+    b->nextHead = b->nextCount = 0;
+}
 
-/* ------------------------------------------------------
-   boat1_thread
-   - obsługuje pasażerów dla łodzi1
-   - sygnał w porcie => force unload
-   - sygnał w rejsie => dokończenie rejsu
------------------------------------------------------- */
-void *boat1_thread(void *arg)
+/* Force unload (sygnał w porcie): wszyscy z łodzi i z pomostu dostają UNLOADED */
+static void force_unload(Boat *b)
 {
-    logMsg("[BOAT1] start max=%d T1=%ds.\n", N1, T1);
+    Pomost *pm = &b->pomost;
+    if(b->rejsCount==0 && pm->count==0) return;
 
-    Pomost *pomost = &pomost1;
+    logMsg("[BOAT%d] Force unload (sygnał w porcie)...\n", b->id);
+    for(int i=0; i<b->rejsCount; i++){
+        send_unloaded(b, &b->rejs[i], "(force) ");
+    }
+    for(int i=0; i<pm->count; i++){
+        send_unloaded(b, &pm->walkers[i].p, "(force) ");
+    }
+    b->rejsCount = 0;
+    b->seats = 0;
+    pm->count = 0;
+    release_next(b, "INACTIVE");
+    pm->state = FREE;
+}
 
-    while(1){
-        pthread_mutex_lock(&mutex);
+/* Czas czekania pasażera w kolejce (do histogramu) */
+static void wait_record(long long ms)
+{
+    if(ms<0) ms = 0;
+    long long bk = ms / WAIT_BUCKET_MS;
+    atomic_fetch_add_explicit(&wait_hist[bk < WAIT_BUCKETS ? bk : WAIT_BUCKETS-1], 1,
+                              memory_order_relaxed);
+    long long mx = atomic_load_explicit(&wait_max_ms, memory_order_relaxed);
+    while(ms > mx && !atomic_compare_exchange_weak(&wait_max_ms, &mx, ms)) ;
+}
 
-        /* Sprawdzamy, czy łódź już nieaktywna. */
-        if(!boat1_active){
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT1] boat1_active=0, koniec.\n");
-            break;
+/* Percentyl (0..100) czasu czekania w ms - górna granica przedziału */
+static long long wait_percentile(double pct)
+{
+    unsigned long long total = 0, acc = 0;
+    for(int i=0; i<WAIT_BUCKETS; i++) total += atomic_load(&wait_hist[i]);
+    if(total==0) return 0;
+    unsigned long long want = (unsigned long long)(pct / 100.0 * total + 0.5);
+    if(want<1) want = 1;
+    long long mx = atomic_load(&wait_max_ms);
+    for(int i=0; i<WAIT_BUCKETS; i++){
+        acc += atomic_load(&wait_hist[i]);
+        if(acc>=want){
+            long long up = (long long)(i+1)*WAIT_BUCKET_MS;
+            return (i==WAIT_BUCKETS-1 || up>mx) ? mx : up;
         }
+    }
+    return mx;
+}
 
-        /* Czy w kolejce cokolwiek jest? Jeśli nie, czekamy. */
-        if(isEmpty(&queueBoat1_skip) && isEmpty(&queueBoat1)){
-            pthread_mutex_unlock(&mutex);
-            // Można tutaj dać drobny sleep, aby nie mielić CPU
-            //usleep(100000);
+/* Pasażer doszedł do końca pomostu i wsiada na łódź */
+static void board(Boat *b, const PassengerItem *p)
+{
+    b->rejs[b->rejsCount++] = *p;
+    b->seats += p->size;
+    b->dep.since = mono_ms();
+    trace_item(TE_BOARD, p, b->id, b->seats, 0);
+    if(p->size>1){
+        logMsg("[BOAT%d] grupa %d (%d osób, disc=%d) wsiada (%d/%d)\n",
+               b->id, p->pid, p->size, p->disc, b->seats, b->capacity);
+    } else {
+        logMsg("[BOAT%d] pasażer %d(disc=%d) wsiada (%d/%d)\n",
+               b->id, p->pid, p->disc, b->seats, b->capacity);
+    }
+}
+
+/* Łódź skończyła pracę - main czeka, aż wszystkie dojdą do B_DONE */
+static void boat_finish(Boat *b)
+{
+    release_next(b, "CLOSED");
+    b->phase = B_DONE;
+    sched_cancel(&sched, &b->task);
+    logMsg("[BOAT%d] koniec pracy.\n", b->id);
+
+    LpHeld h = lp_lock(&done_mutex);
+    if(atomic_fetch_sub(&boats_running, 1)==1) pthread_cond_broadcast(&cond_done);
+    lp_unlock(&done_mutex, h, LP_DONE);
+}
+
+/* Parametry łodzi z bieżącej konfiguracji, jeśli się zmieniła.
+   Wołane przed oknem załadunku - pokład i pomost są wtedy puste. */
+static void boat_conf_pull(Boat *b)
+{
+    unsigned gen = atomic_load(&conf_gen);
+    if(b->conf_gen == gen) return;
+
+    LpHeld h = lp_lock(&conf_mu);
+    int cap = b->groups ? conf.n2 : conf.n1;
+    int tt  = b->groups ? conf.t2 : conf.t1;
+    int changed = b->conf_gen != 0 &&
+                  (cap!=b->capacity || tt!=b->trip_time || conf.k!=b->pomost.k ||
+                   conf.load_timeout!=b->load_timeout || conf.adaptive!=b->adaptive);
+    b->capacity     = cap;
+    b->trip_time    = tt;
+    b->pomost.k     = conf.k;
+    b->load_timeout = conf.load_timeout;
+    b->adaptive     = conf.adaptive;
+    b->conf_gen     = gen;
+    lp_unlock(&conf_mu, h, LP_CONF);
+
+    if(changed){
+        logMsg("[BOAT%d] nowa konfiguracja: max=%d T=%ds K=%d LOAD_TIMEOUT=%ds ADAPTIVE=%d.\n",
+               b->id, b->capacity, b->trip_time, b->pomost.k, b->load_timeout, b->adaptive);
+    }
+}
+
+/* Start okna załadunku: wybrani na morzu, potem pasażerowie z kolejek */
+static void load_begin(Boat *b, long long now)
+{
+    boat_conf_pull(b);
+    b->phase      = B_LOADING;
+    b->rejsCount  = 0;
+    b->seats      = 0;
+    b->load_start = now;
+    b->load_end   = b->load_timeout>0 ? now + b->load_timeout*1000LL : PHASE_NEVER;
+    b->dep.since  = now;
+}
+
+/* Start wyładunku rejs[] przez pomost (OUTBOUND) */
+static void unload_begin(Boat *b, const char *reason, UnloadAfter after, long long now)
+{
+    b->phase         = B_UNLOADING;
+    b->unload_n      = b->rejsCount;
+    b->unload_next   = 0;
+    b->unload_reason = reason;
+    b->unload_after  = after;
+    b->unload_start  = now;
+}
+
+/* ------------------------------------------------------
+   boat_step (jeden kod dla wszystkich łodzi, wołany przez harmonogram)
+   - nigdy nie śpi: robi, co się da, i ustawia termin kolejnego kroku
+   - sygnał w porcie => force unload
+   - sygnał w rejsie => dokończenie rejsu
+------------------------------------------------------ */
+static void boat_step(Boat *b)
+{
+    Pomost *pm = &b->pomost;
+    depart_observe(&b->dep, atomic_load(&b->arrivals), mono_ms());
+
+    for(;;){
+        long long now = mono_ms();
+
+        switch(b->phase){
+        case B_IDLE:
+            /* Sprawdzamy, czy łódź już nieaktywna. */
+            if(!b->active){
+                force_unload(b);
+                logMsg("[BOAT%d] boat%d_active=0, koniec.\n", b->id, b->id);
+                boat_finish(b);
+                return;
+            }
+            /* Czy w kolejce cokolwiek jest? Jeśli nie, czekamy na wstawienie
+               (flush_batch budzi łódź) albo kontrolnie IDLE_POLL_MS. */
+            if(isEmpty(&b->queue_skip) && isEmpty(&b->queue) &&
+               b->nextCount==b->nextHead){
+                boat_wake_at(b, now + IDLE_POLL_MS);
+                return;
+            }
+            logMsg("[BOAT%d] Załadunek...\n", b->id);
+            load_begin(b, now);
             continue;
-        }
 
-        logMsg("[BOAT1] Załadunek...\n");
-        int loaded=0;
-        time_t load_start = time(NULL);
-
-        /* rejsList – pasażerowie, którzy załadowali się na łódź */
-        PassengerItem rejsList[N1];
-        int rejsCount=0;
-
-        while(rejsCount < N1 && boat1_active){
-            /* Wybieramy najpierw z kolejki skip, potem normal */
-            PassQueue *q = NULL;
-            if(!isEmpty(&queueBoat1_skip)){
-                q = &queueBoat1_skip;
-            } else if(!isEmpty(&queueBoat1)){
-                q = &queueBoat1;
-            } else {
-                /* brak pasażerów – sprawdzamy timeout LOAD_TIMEOUT */
-                if(LOAD_TIMEOUT>0 && time(NULL)-load_start >= LOAD_TIMEOUT){
+        case B_LOADING: {
+            /* Force unload, jeśli sygnał przyszedł w trakcie załadunku */
+            if(!b->active){
+                force_unload(b);
+                logMsg("[BOAT%d] sygnał w trakcie załadunku.\n", b->id);
+                boat_finish(b);
+                return;
+            }
+
+            /* 1) kto przeszedł pomost - wsiada */
+            PassengerItem done[K_MAX];
+            int nd = pomost_leave_done(pm, now, done);
+            for(int i=0; i<nd; i++) board(b, &done[i]);
+
+            /* 2) wpuszczamy kolejnych na pomost, nie więcej niż zmieści łódź.
+               Grupa wchodzi w całości albo wcale: gdy pierwsza w kolejności
+               się nie mieści, łódź jest pełna (grupa czeka na następny rejs,
+               nikt jej nie wyprzedza). */
+            int timed_out = now >= b->load_end;
+            int taken = b->seats + pomost_seats(pm), full = taken >= b->capacity;
+            PassengerItem p;
+            while(!timed_out && !full && pomost_may_enter(pm, INBOUND) && take_next(b, &p)==0){
+                switch(phase_admit(taken, p.size, b->capacity)){
+                case ADMIT_NEVER:
+                    reject_passenger(&p, "FULL");
                     break;
+                case ADMIT_FULL:
+                    untake(b, &p);
+                    full = 1;
+                    break;
+                default:
+                    pomost_enter(pm, INBOUND, &p);
+                    taken += p.size;
+                    full = taken >= b->capacity;
                 }
-                /* zwalniamy na moment mutex, żeby inni mogli coś wstawić do kolejki */
-                pthread_mutex_unlock(&mutex);
-                //usleep(100000);
-                pthread_mutex_lock(&mutex);
-                if(!boat1_active) break;
-                continue;
             }
 
-            /* Sprawdzamy, czy pomost jest dostępny (INBOUND) i <K osób na nim */
-            if(pomost_state==FREE || pomost_state==INBOUND){
-                if(pomost_count < K){
-                    PassengerItem p = q->items[q->front];
-
-                    /* dequeue z kolejki */
-                    dequeue(q);
-
-                    /* wejdź na pomost */
-                    if(enter_pomost(pomost)){
-                        leave_pomost_in(pomost); // od razu zszedł i wsiadł na łódź
-                        rejsList[rejsCount++] = p;
-                        loaded++;
-                        logMsg("[BOAT1] pasażer %d(disc=%d) wsiada (%d/%d)\n",
-                               p.pid, p.disc, loaded, N1);
-                    }
-                } else {
-                    /* pomost_count == K -> czekamy na zwolnienie */
-                    pthread_mutex_unlock(&mutex);
-                    //usleep(50000);
-                    pthread_mutex_lock(&mutex);
-                }
-            } else {
-                /* pomost w trybie OUTBOUND, nie można wsiadać */
-                pthread_mutex_unlock(&mutex);
-                //usleep(50000);
-                pthread_mutex_lock(&mutex);
+            /* ADAPTIVE: przy pustej kolejce i pomoście kontroler decyduje,
+               czy dalsze czekanie się opłaca (depart.h); ostatni rejs dnia
+               może czekać cały zapas czasu */
+            int idle = pm->count==0 && boat_waiting(b)==0 && b->nextCount==b->nextHead;
+            long long until = phase_load_until(&b->dep, now, b->load_end, b->adaptive, idle,
+                                               b->seats, b->capacity, b->trip_time, pm->k,
+                                               ms_left(), &timed_out);
+
+            /* 3) okno trwa: budzi nas zejście z pomostu, nowi pasażerowie
+               albo koniec okna */
+            if(phase_load_open(pm->count, full, b->seats, b->capacity, timed_out)){
+                long long ms = pm->count>0 ? pomost_next_ms(pm, now) : until - now;
+                if(ms>100) ms = 100;
+                if(ms<1) ms = 1;
+                boat_wake_at(b, now + ms);
+                return;
+            }
+            b->load_ms = now - b->load_start;
+            if(ct_fd>=0){
+                char args[48];
+                snprintf(args, sizeof(args), "\"pasazerow\":%d", b->seats);
+                ct_span("załadunek", "lodz", b->id, b->load_start*1000, b->load_ms*1000, args);
             }
 
-            /* Force unload, jeśli sygnał przyszedł w trakcie załadunku */
-            if(!boat1_active){
-                /* Jeśli nie w rejsie => force unload */
-                if(!boat1_inrejs && rejsCount>0){
-                    logMsg("[BOAT1] Force unload (sygnał w porcie)...\n");
-                    for(int i=0; i<rejsCount; i++){
-                        PassengerItem pp = rejsList[i];
-                        if(pp.pid>0 && pp.pass_fifo[0]){
-                            int fd_p = open(pp.pass_fifo, O_WRONLY);
-                            if(fd_p>=0){
-                                char tmp[64];
-                                snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                                write(fd_p, tmp, strlen(tmp));
-                                close(fd_p);
-                                logMsg("[BOAT1] (force) UNLOADED -> pasażer %d\n", pp.pid);
-                            }
-                        }
-                    }
-                }
-                pthread_mutex_unlock(&mutex);
-                logMsg("[BOAT1] sygnał w trakcie załadunku.\n");
-                return NULL; 
+            /* 4) koniec załadunku */
+            if(b->rejsCount==0){
+                /* Nikogo nie załadowano, wracamy do czekania */
+                b->phase = B_IDLE;
+                continue;
             }
 
-            if(loaded == N1) break;
-            if(LOAD_TIMEOUT>0 && time(NULL)-load_start >= LOAD_TIMEOUT) break;
-        }
+            /* Kompletów grup nie sprawdzamy: grupa kupuje jeden bilet
+               (BUY_GROUP) i wchodzi jako jeden wpis z size osobami, więc
+               na pokład trafia zawsze w całości albo wcale. */
 
-        /* Drugi check: czy w trakcie tego czekania nie wyłączono łodzi */
-        if(!boat1_active){
-            if(!boat1_inrejs && rejsCount>0){
-                logMsg("[BOAT1] Force unload (sygnał w porcie, tuż przed rejs).\n");
-                for(int i=0; i<rejsCount; i++){
-                    PassengerItem pp = rejsList[i];
-                    if(pp.pid>0 && pp.pass_fifo[0]){
-                        int fd_p = open(pp.pass_fifo, O_WRONLY);
-                        if(fd_p>=0){
-                            char tmp[64];
-                            snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                            write(fd_p, tmp, strlen(tmp));
-                            close(fd_p);
-                            logMsg("[BOAT1] (force) UNLOADED -> pasażer %d\n", pp.pid);
-                        }
-                    }
-                }
+            /* Czy rejs (z wyładunkiem) zdąży przed końcem dnia */
+            if(!phase_may_sail(b->trip_time, b->rejsCount, pm->k, ms_left())){
+                logMsg("[BOAT%d] brak czasu na rejs.\n", b->id);
+                unload_begin(b, "NOTIME", AFTER_NOTIME, now);
+                continue;
             }
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT1] sygnał w trakcie załadunku.\n");
-            break;
-        }
 
-        if(loaded==0){
-            /* Nikogo nie załadowano, wracamy do pętli głównej */
-            pthread_mutex_unlock(&mutex);
+            /* Teraz łódź wyrusza w rejs - powrót to tylko termin w kole */
+            b->inrejs = 1;
+            b->trips++;
+            for(int i=0; i<b->rejsCount; i++){
+                if(b->rejs[i].t_queue<=0) continue;
+                for(int j=0; j<b->rejs[i].size; j++) wait_record(now - b->rejs[i].t_queue);
+            }
+            trace_ev(TE_DEPART, 0, b->id, b->seats, b->capacity);
+            b->depart_us = ct_now_us();
+            b->back   = now + (long long)b->trip_time*TRIP_SCALE_MS;
+            b->phase  = B_SAILING;
+            logMsg("[BOAT%d] Wypływam z %d pasażerami (załadunek %lldms, rejs logicznie %ds).\n",
+                   b->id, b->seats, b->load_ms, b->trip_time);
             continue;
         }
 
-        /* Teraz czekamy, aż pomost będzie wolny (pomost_count=0, stan=FREE).
-           Nie możemy wypłynąć, jeśli ktoś jeszcze wchodzi! */
-        while((pomost_state==INBOUND || pomost_count>0) && boat1_active){
-            pthread_cond_wait(&cond_pomost_free, &mutex);
+        case B_SAILING: {
+            /* Na morzu łódź wybiera z kolejek pasażerów na następny rejs
+               (do pełnej łodzi), żeby po powrocie załadunek ruszył od razu
+               po wyładunku. Budzą ją nowi pasażerowie albo termin powrotu.
+               Grupa, która się już nie zmieści, zostaje w next[] na kolejny. */
+            PassengerItem p;
+            int sel = next_seats(b);
+            while(phase_presel(b->nextCount, sel, b->capacity) && boat_dequeue(b, &p)==0){
+                b->next[b->nextCount++] = p;
+                sel += p.size;
+            }
+            if(now < b->back){
+                boat_wake_at(b, b->back);
+                return;
+            }
+
+            /* Koniec rejsu -> zaczynamy wyładunek (OUTBOUND) */
+            b->inrejs = 0;
+            logMsg("[BOAT%d] Rejs koniec -> OUTBOUND (czeka już %d na wejście).\n",
+                   b->id, b->nextCount - b->nextHead);
+            trace_ev(TE_RETURN, 0, b->id, b->seats, 0);
+            if(ct_fd>=0){
+                char args[48];
+                snprintf(args, sizeof(args), "\"pasazerow\":%d", b->seats);
+                ct_span("rejs", "lodz", b->id, b->depart_us, ct_now_us() - b->depart_us, args);
+            }
+            unload_begin(b, NULL, AFTER_TRIP, now);
+            continue;
         }
-        if(!boat1_active){
-            /* Force unload */
-            if(!boat1_inrejs && rejsCount>0){
-                logMsg("[BOAT1] Force unload (sygnał w porcie, tuż przed REJSEM).\n");
-                for(int i=0; i<rejsCount; i++){
-                    PassengerItem pp = rejsList[i];
-                    if(pp.pid>0 && pp.pass_fifo[0]){
-                        int fd_p= open(pp.pass_fifo, O_WRONLY);
-                        if(fd_p>=0){
-                            char tmp[64];
-                            snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                            write(fd_p, tmp, strlen(tmp));
-                            close(fd_p);
-                            logMsg("[BOAT1] (force) UNLOADED -> pasażer %d\n", pp.pid);
-                        }
-                    }
+
+        case B_UNLOADING: {
+            /* Wyładunek K-szeroki: do k osób naraz na pomoście, każda idzie
+               WALK_MS. unload_reason==NULL -> normalne UNLOADED, inaczej
+               pasażer dostaje REJECTED z tym powodem (rejs się nie odbył). */
+            PassengerItem done[K_MAX];
+            int nd = pomost_leave_done(pm, now, done);
+            for(int i=0; i<nd; i++){
+                if(b->unload_reason) reject_passenger(&done[i], b->unload_reason);
+                else {
+                    send_unloaded(b, &done[i], "");
+                    b->carried += done[i].size;
                 }
             }
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT1] przerwanie przed rejsem.\n");
-            break;
-        }
-         time_t now = time(NULL);
-        if(now+T1+T1*0.9 > end_time){
-            logMsg("[BOAT1] brak czasu na rejs.\n");
-            /* wyładuj */
-            start_outbound(pomost);
-            logMsg("[BOAT1] %d pasażerów zeszło (koniec czasu).\n",rejsCount);
-            for(int i=0;i<rejsCount;i++){
-                PassengerItem pp= rejsList[i];
-                if(pp.group>0) groupCount[pp.group]--;
+            while(b->unload_next < b->unload_n && pomost_may_enter(pm, OUTBOUND)){
+                pomost_enter(pm, OUTBOUND, &b->rejs[b->unload_next++]);
+            }
+            if(b->unload_next < b->unload_n || pm->count>0){
+                boat_wake_at(b, mono_ms() + pomost_next_ms(pm, mono_ms()));
+                return;
+            }
+            int n = b->seats;
+            b->rejsCount = 0;
+            b->seats = 0;
+            ct_span("wyładunek", "lodz", b->id, b->unload_start*1000,
+                    (now - b->unload_start)*1000, NULL);
+
+            if(b->unload_after==AFTER_NOTIME){
+                logMsg("[BOAT%d] %d pasażerów zeszło (koniec czasu).\n", b->id, n);
+                boat_finish(b);
+                return;
             }
-            end_outbound(pomost);
-            pthread_mutex_unlock(&mutex);
-            break;
-        }
 
+            logMsg("[BOAT%d] pasażerowie wyszli (wyładunek %lldms).\n",
+                   b->id, now - b->unload_start);
+            depart_cycle(&b->dep, now - (b->back - (long long)b->trip_time*TRIP_SCALE_MS));
 
-        /* Teraz łódź1 wyrusza w rejs */
-        boat1_inrejs = 1;
-        logMsg("[BOAT1] Wypływam z %d pasażerami (rejs logicznie %ds).\n", rejsCount, T1);
-        pthread_mutex_unlock(&mutex);
-
-        // Tu brak realnego sleep, można ewentualnie dać "usleep(1000*T1)".
-        //usleep(1000*T1);
-
-        /* Koniec rejsu -> zaczynamy wyładunek (OUTBOUND) */
-        pthread_mutex_lock(&mutex);
-        boat1_inrejs=0;
-        logMsg("[BOAT1] Rejs koniec -> OUTBOUND.\n");
-        start_outbound(pomost);
-
-        /* "UNLOAD" -> wysyłamy do każdego pasażera 'UNLOADED <pid>' */
-        for(int i=0; i<rejsCount; i++){
-            PassengerItem pp = rejsList[i];
-            if(pp.pid>0 && pp.pass_fifo[0]){
-                int fd_p= open(pp.pass_fifo, O_WRONLY);
-                if(fd_p>=0){
-                    char tmp[64];
-                    snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                    write(fd_p, tmp, strlen(tmp));
-                    close(fd_p);
-                    logMsg("[BOAT1] UNLOADED -> pasażer %d\n", pp.pid);
-                }
+            if(!b->active){
+                release_next(b, "INACTIVE");
+                logMsg("[BOAT%d] sygnał w trakcie/po wyład.\n", b->id);
+                boat_finish(b);
+                return;
             }
-        }
-        logMsg("[BOAT1] pasażerowie wyszli.\n");
 
-        /* Zwolnij pomost z OUTBOUND i wróć do FREE */
-        end_outbound(pomost);
-        if(!boat1_active){
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT1] sygnał w trakcie/po wyład.\n");
-            break;
+            /* Potok: ostatni pasażer zszedł z pomostu, więc wybrani na morzu
+               wchodzą od razu - bez powrotu do czekania i ponownego szukania. */
+            if(b->nextCount > b->nextHead){
+                logMsg("[BOAT%d] Załadunek (potok, %d wybranych)...\n",
+                       b->id, b->nextCount - b->nextHead);
+                load_begin(b, now);
+            } else {
+                b->phase = B_IDLE;
+            }
+            continue;
         }
 
-        pthread_mutex_unlock(&mutex);
+        case B_DONE:
+            return;
+        }
     }
+}
 
-    logMsg("[BOAT1] koniec wątku.\n");
-    return NULL;
+/* Miejsce profilera dla kroku łodzi: faza na wejściu (pod b->lock) */
+static int boat_lp_site(const Boat *b)
+{
+    int ph = b->phase<=B_UNLOADING ? (int)b->phase : B_IDLE;
+    return (b->groups ? LP_IDLE2 : LP_IDLE1) + ph;
 }
 
-/* ------------------------------------------------------
-   boat2_thread
-   - analogicznie do boat1, z dodatkową obsługą grup
------------------------------------------------------- */
-void *boat2_thread(void *arg)
+/* Zadanie harmonogramu: jeden krok łodzi pod jej blokadą */
+static void boat_run(SchedTask *t)
 {
-    logMsg("[BOAT2] start max=%d T2=%ds.\n", N2, T2);
+    Boat *b = (Boat*)t;
+    if(ct_fd<0){
+        LpHeld h = lp_lock(&b->lock);
+        int site = boat_lp_site(b);
+        boat_step(b);
+        lp_unlock(&b->lock, h, site);
+        return;
+    }
 
-    /* Zerowanie grup */
-    memset(groupCount,  0, sizeof(groupCount));
-    memset(groupTarget, 0, sizeof(groupTarget));
+    /* ze śladem Chrome: czas czekania na blokadę i jej trzymania */
+    long long t0 = ct_now_us();
+    LpHeld h = lp_lock(&b->lock);
+    int site = boat_lp_site(b);
+    long long t1 = ct_now_us();
+    boat_step(b);
+    long long t2 = ct_now_us();
+    lp_unlock(&b->lock, h, site);
+    char args[48];
+    snprintf(args, sizeof(args), "\"czekanie_us\":%lld", t1 - t0);
+    ct_span("blokada łodzi", "lock", b->id, t1, t2 - t1, args);
+}
 
-    Pomost *pomost = &pomost2;
+static void boat_init(Boat *b, int id, int groups)
+{
+    memset(b, 0, sizeof(*b));
+    b->task.run  = boat_run;
+    pthread_mutex_init(&b->lock, NULL);
+    b->id        = id;
+    b->groups    = groups;
+    boat_conf_pull(b);   // conf_gen 0 -> zawsze pobiera
+    depart_init(&b->dep, mono_ms(), (double)b->trip_time*TRIP_SCALE_MS +
+                (b->capacity + b->pomost.k - 1) / b->pomost.k * WALK_MS);
+    initQueue(&b->queue);
+    initQueue(&b->queue_skip);
+    b->pomost.state = FREE;
+    b->pomost.owner = id;
+    b->phase  = B_IDLE;
+    b->active = 1;
+    b->inrejs = 0;
+}
 
-    while(1){
-        pthread_mutex_lock(&mutex);
+/* ------------------------------------------------------
+   Checkpoint (plik stanu STATE_FILE, patrz checkpoint.h)
+   - zadanie harmonogramu co CKPT_INTERVAL_MS kopiuje stan każdej łodzi
+     (pod jej blokadą) do wolnego slotu i publikuje go
+   - po awarii nowy sternik wznawia: kolejki wracają do kolejek, kto był
+     na pomoście/pokładzie przed wypłynięciem - wchodzi jako pierwszy,
+     kto odbył rejs - dostaje UNLOADED
+------------------------------------------------------ */
+static Checkpoint ckpt = { .fd = -1 };
+static SchedTask  ckpt_task;
+static volatile int ckpt_stop = 0;
+static uint64_t   ckpt_seq = 0;
 
-        if(!boat2_active){
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT2] boat2_active=0, koniec.\n");
-            break;
-        }
+/* Jak rozliczyć po wznowieniu pasażera, który właśnie schodzi z łodzi */
+static int ckpt_unload_kind(Boat *b)
+{
+    if(!b->unload_reason) return CK_UNLOADED;
+    return CK_REJ_NOTIME;
+}
 
-        /* Czy są pasażerowie w kolejkach? */
-        if(isEmpty(&queueBoat2_skip) && isEmpty(&queueBoat2)){
-            pthread_mutex_unlock(&mutex);
-            //usleep(200000);
-            continue;
+/* Stan jednej łodzi do it[] (pod b->lock). Zwraca liczbę wpisów. */
+static int ckpt_capture_boat(Boat *b, CkptItem *it)
+{
+    static PassengerItem tmp[QSIZE];
+    Pomost *pm = &b->pomost;
+    int n = 0;
+
+    /* pokład: przed wypłynięciem wchodzą ponownie, po rejsie - UNLOADED */
+    if(b->phase==B_LOADING){
+        for(int i=0; i<b->rejsCount; i++) it[n++] = (CkptItem){CK_NEXT, b->rejs[i]};
+    } else if(b->phase==B_SAILING){
+        for(int i=0; i<b->rejsCount; i++) it[n++] = (CkptItem){CK_UNLOADED, b->rejs[i]};
+    } else if(b->phase==B_UNLOADING){
+        for(int i=b->unload_next; i<b->unload_n; i++){
+            it[n++] = (CkptItem){ckpt_unload_kind(b), b->rejs[i]};
         }
+    }
+    for(int i=0; i<pm->count; i++){
+        int kind = (pm->state==INBOUND) ? CK_NEXT : ckpt_unload_kind(b);
+        it[n++] = (CkptItem){kind, pm->walkers[i].p};
+    }
+    for(int i=b->nextHead; i<b->nextCount; i++) it[n++] = (CkptItem){CK_NEXT, b->next[i]};
 
-        logMsg("[BOAT2] Załadunek...\n");
-        int loaded=0;
-        time_t load_start = time(NULL);
-
-        PassengerItem rejsList[N2];
-        int rejsCount=0;
+    int q = queuePeekAll(&b->queue_skip, tmp, QSIZE);
+    for(int i=0; i<q; i++) it[n++] = (CkptItem){CK_SKIP, tmp[i]};
+    q = queuePeekAll(&b->queue, tmp, QSIZE);
+    for(int i=0; i<q; i++) it[n++] = (CkptItem){CK_QUEUE, tmp[i]};
+    return n;
+}
 
-        while(rejsCount < N2 && boat2_active){
-            PassQueue *q=NULL;
-            if(!isEmpty(&queueBoat2_skip)) {
-                q = &queueBoat2_skip;
-            } else if(!isEmpty(&queueBoat2)) {
-                q = &queueBoat2;
-            } else {
-                if(LOAD_TIMEOUT>0 && time(NULL)-load_start >= LOAD_TIMEOUT) {
-                    break;
-                }
-                pthread_mutex_unlock(&mutex);
-                //usleep(100000);
-                pthread_mutex_lock(&mutex);
-                if(!boat2_active) break;
-                continue;
-            }
+/* Jeden snapshot całej floty do wolnego slotu */
+static void checkpoint_write(void)
+{
+    int si = ckpt_write_slot(&ckpt);
+    CkptSlot *s = ckpt_slot(&ckpt, si);
+    CkptBoat *cb = ckpt_boats(s);
+    CkptItem *it = ckpt_items(&ckpt, s);
+    int total = 0;
+
+    for(int i=0; i<nboats; i++){
+        Boat *b = &boats[i];
+        LpHeld h = lp_lock(&b->lock);
+        cb[i].id      = b->id;
+        cb[i].active  = b->active;
+        cb[i].trips   = b->trips;
+        cb[i].carried = b->carried;
+        cb[i].first   = total;
+        cb[i].count   = ckpt_capture_boat(b, it + total);
+        lp_unlock(&b->lock, h, LP_CKPT);
+        total += cb[i].count;
+    }
+    s->seq      = ++ckpt_seq;
+    s->end_time = end_time;
+    s->nboats   = nboats;
+    s->nitems   = total;
+    ckpt_publish(&ckpt, si);
+}
 
-            if(pomost_state==FREE || pomost_state==INBOUND){
-                if(pomost_count< K){
-                    PassengerItem p = q->items[q->front];
-                    dequeue(q);
-                    if(enter_pomost(pomost)){
-                        leave_pomost_in(pomost);
-                        /* W boat2: jeżeli group>0 i groupTarget[group]==0,
-                           to ustawiamy groupTarget=2 (sygnalizuje, że ma płynąć
-                           łącznie 2 osoby - np. dziecko+opiekun).
-                        */
-                        if(p.group>0 && groupTarget[p.group]==0){
-                            groupTarget[p.group] = 2; 
-                        }
-                        groupCount[p.group]++;
-
-                        rejsList[rejsCount++] = p;
-                        loaded++;
-                        logMsg("[BOAT2] pasażer %d(disc=%d,grp=%d) wsiada (%d/%d)\n",
-                               p.pid, p.disc, p.group, loaded, N2);
-                    }
-                } else {
-                    pthread_mutex_unlock(&mutex);
-                    //usleep(50000);
-                    pthread_mutex_lock(&mutex);
-                }
-            } else {
-                pthread_mutex_unlock(&mutex);
-                //usleep(50000);
-                pthread_mutex_lock(&mutex);
-            }
+static void checkpoint_run(SchedTask *t)
+{
+    if(ckpt_stop) return;
+    checkpoint_write();
+    sched_at(&sched, t, mono_ms() + CKPT_INTERVAL_MS);
+}
 
-            /* Force unload w porcie, jeśli sygnał nadszedł */
-            if(!boat2_active){
-                if(!boat2_inrejs && rejsCount>0){
-                    logMsg("[BOAT2] Force unload (sygnał w porcie)...\n");
-                    for(int i=0; i<rejsCount; i++){
-                        PassengerItem pp= rejsList[i];
-                        if(pp.pid>0 && pp.pass_fifo[0]){
-                            int fd_p= open(pp.pass_fifo, O_WRONLY);
-                            if(fd_p>=0){
-                                char tmp[64];
-                                snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                                write(fd_p, tmp, strlen(tmp));
-                                close(fd_p);
-                                logMsg("[BOAT2] (force) UNLOADED -> pasażer %d\n", pp.pid);
-                            }
-                        }
-                        if(pp.group>0) groupCount[pp.group]--;
-                    }
+/* Wznowienie z ostatniego snapshotu (przed startem harmonogramu).
+   Zwraca 1 gdy było co wznowić. */
+static int checkpoint_restore(void)
+{
+    CkptSlot *s = ckpt_last(&ckpt);
+    if(!s) return 0;
+
+    long long t0 = mono_ms();
+    CkptBoat *cb = ckpt_boats(s);
+    CkptItem *it = ckpt_items(&ckpt, s);
+    int queued = 0, delivered = 0;
+
+    end_time = (time_t)s->end_time;
+    for(uint32_t i=0; i<s->nboats; i++){
+        Boat *b = boat_by_no(cb[i].id);
+        if(!b) continue;
+        b->active  = cb[i].active;
+        b->trips   = cb[i].trips;
+        b->carried = cb[i].carried;
+        for(int j=0; j<cb[i].count; j++){
+            CkptItem *ci = &it[cb[i].first + j];
+            switch(ci->kind){
+            case CK_NEXT:
+                if(b->nextCount < N_MAX){
+                    b->next[b->nextCount++] = ci->p;
+                    queued++;
+                    break;
                 }
-                pthread_mutex_unlock(&mutex);
-                logMsg("[BOAT2] sygnał w trakcie załadunku.\n");
-                return NULL;
+                /* fall through - nie mieści się, do kolejki skip */
+            case CK_SKIP:
+            case CK_QUEUE:
+                if(boat_enqueue(b, ci->kind!=CK_QUEUE, &ci->p)==0) queued++;
+                else reject_passenger(&ci->p, "FULL");
+                break;
+            case CK_UNLOADED:
+                send_unloaded(b, &ci->p, "(po wznowieniu) ");
+                b->carried += ci->p.size;
+                delivered++;
+                break;
+            default:
+                reject_passenger(&ci->p, "NOTIME");
+                delivered++;
+                break;
             }
-
-            if(loaded==N2) break;
-            if(LOAD_TIMEOUT>0 && time(NULL)-load_start >= LOAD_TIMEOUT) break;
         }
+    }
+    ckpt_seq = s->seq;
+    logMsg("[STERNIK] wznowienie ze snapshotu #%llu: %d pasażerów wraca do kolejek, "
+           "%d rozliczonych (%lldms).\n",
+           (unsigned long long)s->seq, queued, delivered, mono_ms() - t0);
+    return 1;
+}
 
-        if(!boat2_active){
-            if(!boat2_inrejs && rejsCount>0){
-                logMsg("[BOAT2] Force unload (sygnał w porcie, tuż przed rejs).\n");
-                for(int i=0; i<rejsCount; i++){
-                    PassengerItem pp= rejsList[i];
-                    if(pp.pid>0 && pp.pass_fifo[0]){
-                        int fd_p= open(pp.pass_fifo, O_WRONLY);
-                        if(fd_p>=0){
-                            char tmp[64];
-                            snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                            write(fd_p, tmp, strlen(tmp));
-                            close(fd_p);
-                            logMsg("[BOAT2] (force) UNLOADED -> pasażer %d\n", pp.pid);
-                        }
-                    }
-                    if(pp.group>0) groupCount[pp.group]--;
-                }
-            }
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT2] sygnał w trakcie załadunku.\n");
-            break;
-        }
+/* ------------------------------------------------------
+   Wejście sternika (fifo_sternik_in)
+   - duży bufor odczytu, końce linii szukane memchr (w glibc wektorowe SSE2/AVX2)
+   - linie parsowane w miejscu w buforze, bez kopiowania i bez sscanf
+   - wszystkie QUEUE/QUEUE_SKIP z jednego read() tworzą partię, którą
+     wstawiamy do kolejek bez blokad i budzimy łodzie jednym dzwonkiem
+------------------------------------------------------ */
+#define READBUF_SIZE (64*1024)
+#define MAX_BATCH    1024
 
-        if(loaded==0){
-            pthread_mutex_unlock(&mutex);
-            continue;
-        }
+/* Wpis kolejki z komendy QUEUE/QUEUE_GROUP (bez t_queue) */
+static void rec_item(const QueueRec *r, PassengerItem *pi)
+{
+    pi->pid   = r->pid;
+    pi->disc  = r->disc;
+    pi->size  = r->size;
+    pi->group = r->size>1 ? r->pid : 0;
+    memcpy(pi->member, r->member, sizeof(pi->member));
+    memcpy(pi->pass_fifo, r->fifo, r->fifo_len);
+    pi->pass_fifo[r->fifo_len] = '\0';
+}
 
-        /* Czekamy aż pomost będzie wolny, bo sternik nie może wypłynąć, 
-           gdy ktoś jeszcze wchodzi. */
-        while((pomost_state==INBOUND || pomost_count>0) && boat2_active){
-            pthread_cond_wait(&cond_pomost_free,&mutex);
-        }
-        if(!boat2_active){
-            if(!boat2_inrejs && rejsCount>0){
-                logMsg("[BOAT2] Force unload (sygnał w porcie, tuż przed rejs).\n");
-                for(int i=0; i<rejsCount; i++){
-                    PassengerItem pp= rejsList[i];
-                    if(pp.pid>0 && pp.pass_fifo[0]){
-                        int fd_p= open(pp.pass_fifo, O_WRONLY);
-                        if(fd_p>=0){
-                            char tmp[64];
-                            snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                            write(fd_p, tmp, strlen(tmp));
-                            close(fd_p);
-                            logMsg("[BOAT2] (force) UNLOADED -> pasażer %d\n", pp.pid);
-                        }
-                    }
-                    if(pp.group>0) groupCount[pp.group]--;
-                }
-            }
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT2] przerwanie przed rejs.\n");
-            break;
+/* Wstawia partię do kolejek łodzi - bez mutexu (kolejki są bez blokad),
+   na koniec budzi w harmonogramie każdą łódź, która coś dostała (raz).
+   Logi i powiadomienia o odrzuceniu dopiero po wstawieniu całej partii. */
+static void flush_batch(QueueRec *batch, int n)
+{
+    if(n==0) return;
+    long long ct0 = ct_fd>=0 ? ct_now_us() : 0;
+
+    static Boat *touched[MAX_BATCH];
+    int ntouched = 0;
+    for(int i=0; i<n; i++){
+        QueueRec *r = &batch[i];
+        Boat *b = boat_by_no(r->bno);
+        if(!b || !b->active){
+            r->why = "INACTIVE";
+            continue;
         }
-
-        /* Sprawdzamy, czy wszystkie grupy mają komplet (np. min. 2 osoby). 
-           Jeżeli np. jest dziecko (group>0) i brakuje opiekuna => rejs odwołany. */
-        int allGroupsOk=1;
-        for(int i=0; i<rejsCount; i++){
-            PassengerItem pp= rejsList[i];
-            if(pp.group>0 && groupCount[pp.group] < 2){
-                // np. jest 1, a powinno być 2
-                allGroupsOk=0;
-                break;
-            }
+        PassengerItem pi;
+        rec_item(r, &pi);
+        pi.t_queue = mono_ms();
+        if(boat_waiting(b) + r->size > QUEUE_LIMIT || boat_enqueue(b, r->skip, &pi)<0){
+            r->why = "FULL";
+            continue;
         }
-        if(!allGroupsOk){
-            logMsg("[BOAT2] brakuje partnera z group -> rezygnuję z rejsu.\n");
-            start_outbound(pomost);
-            logMsg("[BOAT2] %d pasażerów zeszło (niedokończona grupa).\n", rejsCount);
-
-            /* Ci pasażerowie schodzą, groupCount-- */
-            for(int i=0; i<rejsCount; i++){
-                PassengerItem pp= rejsList[i];
-                if(pp.group>0) groupCount[pp.group]--;
+        r->why = NULL;
+        atomic_fetch_add_explicit(&b->arrivals, (unsigned)r->size, memory_order_relaxed);
+        trace_item(TE_QUEUE, &pi, r->bno, r->skip, 0);
+        int seen = 0;
+        for(int j=0; j<ntouched && !seen; j++) seen = (touched[j]==b);
+        if(!seen) touched[ntouched++] = b;
+    }
+    for(int i=0; i<ntouched; i++) boat_wake(touched[i]);
+
+    for(int i=0; i<n; i++){
+        QueueRec *r = &batch[i];
+        if(!r->why){
+            if(r->size>1){
+                logMsg("[STERNIK] grupa %d (%d osób)%s -> boat%d\n",
+                       r->pid, r->size, r->skip ? " skip" : "", r->bno);
+            } else if(r->skip){
+                logMsg("[STERNIK] skip pass %d -> boat%d_skip (disc=%d)\n", r->pid, r->bno, r->disc);
+            } else {
+                logMsg("[STERNIK] pass %d->boat%d disc=%d\n", r->pid, r->bno, r->disc);
             }
-            end_outbound(pomost);
-            pthread_mutex_unlock(&mutex);
             continue;
         }
-
-         /* sprawdzamy czas */
-        time_t now= time(NULL);
-        if(now+T2+T2*0.9> end_time){
-            logMsg("[BOAT2] brak czasu na rejs.\n");
-            /* wyładuj */
-            start_outbound(pomost);
-            logMsg("[BOAT2] %d pasażerów zeszło (koniec czasu).\n",rejsCount);
-            for(int i=0;i<rejsCount;i++){
-                PassengerItem pp= rejsList[i];
-                if(pp.group>0) groupCount[pp.group]--;
-            }
-            end_outbound(pomost);
-            pthread_mutex_unlock(&mutex);
-            break;
+        if(!strcmp(r->why, "FULL")){
+            logMsg("[STERNIK] queueBoat%d%s full -> odrzucam %d\n",
+                   r->bno, r->skip ? "_skip" : "", r->pid);
+        } else {
+            logMsg("[STERNIK] boat %d inactive => %d odrzucony\n", r->bno, r->pid);
         }
+        PassengerItem pi;
+        rec_item(r, &pi);
+        reject_passenger(&pi, r->why);
+    }
 
-        /* Start rejsu */
-        boat2_inrejs=1;
-        logMsg("[BOAT2] Wypływam z %d pasażerami (rejs logicznie %ds).\n", rejsCount, T2);
-        pthread_mutex_unlock(&mutex);
-
-        //sleep(T2);//komentujemy do sprawdzenia - odkomentowac w celu realnej symulacji
-
-        pthread_mutex_lock(&mutex);
-        boat2_inrejs=0;
-        logMsg("[BOAT2] Rejs koniec -> OUTBOUND.\n");
-        start_outbound(pomost);
-
-        /* Wyładunek normalny -> "UNLOADED <pid>" */
-        for(int i=0; i<rejsCount; i++){
-            PassengerItem pp= rejsList[i];
-            if(pp.pid>0 && pp.pass_fifo[0]){
-                int fd_p= open(pp.pass_fifo, O_WRONLY);
-                if(fd_p>=0){
-                    char tmp[64];
-                    snprintf(tmp,sizeof(tmp),"UNLOADED %d\n", pp.pid);
-                    write(fd_p, tmp, strlen(tmp));
-                    close(fd_p);
-                    logMsg("[BOAT2] UNLOADED -> pasażer %d\n", pp.pid);
-                }
-            }
-        }
+    if(ct_fd>=0){
+        char args[48];
+        snprintf(args, sizeof(args), "\"komend\":%d", n);
+        ct_span("partia QUEUE", "wejscie", 0, ct0, ct_now_us() - ct0, args);
+    }
+}
 
-        logMsg("[BOAT2] pasażerowie wyszli.\n");
-        end_outbound(pomost);
+/* CONFIG [KLUCZ=wart ...] - zmiana parametrów łodzi (boatconf.h);
+   bez argumentów tylko wypisuje bieżące */
+static void handle_config(const char *p, const char *end)
+{
+    char err[128], cur[128];
+    LpHeld h = lp_lock(&conf_mu);
+    int n = boatconf_apply(&conf, p, end, err, sizeof(err));
+    boatconf_format(&conf, cur, sizeof(cur));
+    lp_unlock(&conf_mu, h, LP_CONF);
+
+    if(n<0){
+        logMsg("[STERNIK] CONFIG odrzucony (%s), bez zmian: %s\n", err, cur);
+        return;
+    }
+    if(n>0){
+        atomic_fetch_add(&conf_gen, 1);
+        logMsg("[STERNIK] CONFIG przyjęty (od następnego załadunku): %s\n", cur);
+    } else {
+        logMsg("[STERNIK] CONFIG: %s\n", cur);
+    }
+}
 
-        if(!boat2_active){
-            pthread_mutex_unlock(&mutex);
-            logMsg("[BOAT2] sygnał po wyład.\n");
-            break;
+/* Komendy sterujące (INFO, CONFIG, QUIT, ...). Zwraca 1 dla QUIT. */
+static int handle_control(const char *p, const char *end)
+{
+    int len = (int)(end - p);
+    if(len>=6 && !memcmp(p, "CONFIG", 6) && (len==6 || p[6]==' ' || p[6]=='\t')){
+        handle_config(p + 6, end);
+    }
+    else if(len>=4 && !memcmp(p, "INFO", 4)){
+        /* Informacja diagnostyczna */
+        for(int i=0; i<nboats; i++){
+            Boat *b = &boats[i];
+            LpHeld h = lp_lock(&b->lock);
+            const char *st = (b->pomost.state==FREE)?"FREE":
+                             (b->pomost.state==INBOUND)?"INBOUND":"OUTBOUND";
+            logMsg("[INFO] b%d_act=%d rejs=%d, q=%d skip=%d, p_count=%d, st=%s, trips=%d carried=%d "
+                   "max=%d K=%d tempo=%.2f/s cykl=%.0fms\n",
+                   b->id, b->active, b->inrejs,
+                   queueCount(&b->queue), queueCount(&b->queue_skip),
+                   b->pomost.count, st, b->trips, b->carried, b->capacity, b->pomost.k,
+                   depart_rate(&b->dep, mono_ms())*1000, b->dep.cycle_ms);
+            lp_unlock(&b->lock, h, LP_INFO);
         }
-        pthread_mutex_unlock(&mutex);
+        lp_dump(stdout, "INFO");
+    }
+    else if(len>=4 && !memcmp(p, "QUIT", 4)){
+        logMsg("[STERNIK] QUIT => end.\n");
+        return 1;
     }
+    else if(len>0){
+        logMsg("[STERNIK] Nieznane: %.*s\n", len, p);
+    }
+    return 0;
+}
 
-    logMsg("[BOAT2] koniec wątku.\n");
-    return NULL;
+/* Podsumowanie do SUMMARY_FILE (klucz=wartość w jednej linii) */
+static void write_summary(void)
+{
+    long trips = 0, carried = 0, boarded = 0;
+    for(int i=0; i<nboats; i++){
+        trips   += boats[i].trips;
+        carried += boats[i].carried;
+    }
+    for(int i=0; i<WAIT_BUCKETS; i++) boarded += atomic_load(&wait_hist[i]);
+    char cf[128];
+    boatconf_format(&conf, cf, sizeof(cf));
+    FILE *f = fopen(SUMMARY_FILE, "w");
+    if(!f){
+        perror("[STERNIK] " SUMMARY_FILE);
+        return;
+    }
+    fprintf(f, "boats=%d trips=%ld carried=%ld boarded=%ld wait_p50_ms=%lld wait_p90_ms=%lld "
+               "wait_p99_ms=%lld wait_max_ms=%lld %s\n",
+            nboats, trips, carried, boarded, wait_percentile(50), wait_percentile(90),
+            wait_percentile(99), (long long)atomic_load(&wait_max_ms), cf);
+    fclose(f);
+    logMsg("[STERNIK] rejsów %ld, przewiezionych %ld, czekanie p50=%lldms p99=%lldms.\n",
+           trips, carried, wait_percentile(50), wait_percentile(99));
 }
 
 /* MAIN sternik */
 int main(int argc, char* argv[])
 {
     setbuf(stdout,NULL);
+    /* FIFO, plik stanu i konfiguracja - względem katalogu przebiegu */
+    if(rundir_enter(0)<0){
+        perror("[STERNIK] " RUN_DIR_ENV);
+        return 1;
+    }
+    trace_open(TP_STERNIK, "sternik", 1<<22);
+    ct_open("sternik", 0);
+    ct_thread_name(0, "wejście (fifo_sternik_in)");
 
     if(argc<2){
-        fprintf(stderr,"Użycie: %s <timeout_s>\n",argv[0]);
+        fprintf(stderr,"Użycie: %s <timeout_s> [liczba_łodzi]\n",argv[0]);
         return 1;
     }
     int timeout_value= atoi(argv[1]);
+    lp_init(lp_site_names, LP_NSITES);
+    if(argc>2) nboats = atoi(argv[2]);
+    if(nboats<NBOATS) nboats = NBOATS;
+    if(nboats>MAX_BOATS) nboats = MAX_BOATS;
     start_time = time(NULL);
     end_time   = start_time + timeout_value;
 
@@ -686,24 +1193,52 @@ int main(int argc, char* argv[])
         perror("[STERNIK] sternik.log");
     }*/
 
-    /* Ustawienie handlerów sygnałów SIGUSR1 i SIGUSR2 */
-    struct sigaction sa1, sa2;
-    memset(&sa1, 0, sizeof(sa1));
-    sa1.sa_handler = sigusr1_handler;
-    sigaction(SIGUSR1, &sa1, NULL);
-
-    memset(&sa2, 0, sizeof(sa2));
-    sa2.sa_handler = sigusr2_handler;
-    sigaction(SIGUSR2, &sa2, NULL);
+    /* SIGUSR1/SIGUSR2 (policjant) i SIGTERM (orchestrator) blokujemy
+       przed utworzeniem jakiegokolwiek wątku - wątki dziedziczą maskę,
+       więc żaden nie jest przerywany (bez EINTR w pętli wejścia).
+       Odbiera je tylko pętla główna przez signalfd. */
+    sigset_t sigmask;
+    sigemptyset(&sigmask);
+    sigaddset(&sigmask, SIGUSR1);
+    sigaddset(&sigmask, SIGUSR2);
+    sigaddset(&sigmask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+    int sfd = signalfd(-1, &sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(sfd<0){
+        perror("[STERNIK] signalfd");
+        return 1;
+    }
 
-    /* Inicjujemy kolejki */
-    initQueue(&queueBoat1);
-    initQueue(&queueBoat1_skip);
-    initQueue(&queueBoat2);
-    initQueue(&queueBoat2_skip);
+    /* Konfiguracja łodzi z pliku (brak pliku - wartości domyślne) */
+    const char *conf_path = getenv(BOATCONF_ENV);
+    if(!conf_path || !*conf_path) conf_path = BOATCONF_FILE;
+    char conf_err[192], conf_str[128];
+    if(boatconf_load(&conf, conf_path, conf_err, sizeof(conf_err))<0){
+        fprintf(stderr, "[STERNIK] %s\n", conf_err);
+        return 1;
+    }
+    boatconf_format(&conf, conf_str, sizeof(conf_str));
+    logMsg("[STERNIK] konfiguracja (%s): %s\n",
+           access(conf_path, R_OK)==0 ? conf_path : "domyślna", conf_str);
+
+    /* Inicjujemy łodzie (kolejki, pomosty). Łodzie 1 i 2 jak dotąd,
+       dalsze (większa flota) na przemian według ich wzoru. */
+    boats = calloc(nboats, sizeof(Boat));
+    if(!boats){
+        perror("[STERNIK] calloc(boats)");
+        return 1;
+    }
+    for(int i=0; i<nboats; i++){
+        boat_init(&boats[i], i+1, i%2);
+    }
 
-    pomost_state = FREE;
-    pomost_count = 0;
+    /* Plik stanu: jeśli poprzedni sternik padł, wznawiamy jego kolejki */
+    int resumed = 0;
+    if(ckpt_open(&ckpt, STATE_FILE, nboats, CKPT_MAX_ITEMS)<0){
+        perror("[STERNIK] " STATE_FILE " (praca bez checkpointu)");
+    } else {
+        resumed = checkpoint_restore();
+    }
 
     /* Otwieramy fifo_sternik_in (przyjmujemy, że mkfifo wykonuje orchestrator lub my) */
     int fd_in= open("fifo_sternik_in", O_RDONLY | O_NONBLOCK);
@@ -712,143 +1247,125 @@ int main(int argc, char* argv[])
         //if(sternikLog) fclose(sternikLog);
         return 1;
     }
+    /* Własny pisarz: FIFO nigdy nie zgłasza EOF/POLLHUP, gdy pasażerowie
+       akurat nic nie piszą - poll() śpi zamiast się kręcić */
+    int fd_in_dummy = open("fifo_sternik_in", O_WRONLY | O_NONBLOCK);
+
+    /* Harmonogram: koło czasowe + SCHED_WORKERS wątków dla całej floty */
+    if(sched_start(&sched, SCHED_WORKERS)<0){
+        perror("[STERNIK] timerfd");
+        close(fd_in);
+        return 1;
+    }
+    atomic_store(&boats_running, nboats);
+    for(int i=0; i<nboats; i++){
+        Boat *b = &boats[i];
+        logMsg("[BOAT%d] start max=%d T%d=%ds K=%d walk=%dms.\n",
+               b->id, b->capacity, b->id, b->trip_time, b->pomost.k, WALK_MS);
+        boat_wake(b);
+        if(ct_fd>=0){
+            char nm[32];
+            snprintf(nm, sizeof(nm), "łódź %d", b->id);
+            ct_thread_name(b->id, nm);
+        }
+    }
+    if(ckpt.fd>=0){
+        ckpt_task.run = checkpoint_run;
+        sched_wake(&sched, &ckpt_task);
+    }
 
-    /* Tworzymy wątki łodzi */
-    pthread_t t1, t2;
-    pthread_create(&t1, NULL, boat1_thread, NULL);
-    pthread_create(&t2, NULL, boat2_thread, NULL);
-
-    logMsg("[STERNIK] start (timeout=%d).\n", timeout_value);
+    logMsg("[STERNIK] start (timeout=%d, łodzi=%d, wątków=%d%s).\n",
+           (int)(end_time - time(NULL)), nboats, SCHED_WORKERS, resumed ? ", wznowiony" : "");
 
-    char readbuf[1024];
-    ssize_t rb_len = 0;
+    static char readbuf[READBUF_SIZE];
+    static QueueRec batch[MAX_BATCH];
+    size_t rb_len = 0;
 
-    /* Pętla główna sternika – wczytuje komendy z fifo_sternik_in */
+    long long last_credit_ms = 0;
+    int *credit = malloc(nboats * sizeof(int)), *last_credit = malloc(nboats * sizeof(int));
+    if(!credit || !last_credit){
+        perror("[STERNIK] malloc(credit)");
+        return 1;
+    }
+    for(int i=0; i<nboats; i++) last_credit[i] = -1;
+
+    /* Pętla główna sternika – czeka w poll() na komendy z fifo_sternik_in
+       albo sygnał (signalfd); budzi się też co CREDIT_CHECK_MS po kredyt */
+    struct pollfd pfd[2] = {
+        { .fd = fd_in, .events = POLLIN },
+        { .fd = sfd,   .events = POLLIN },
+    };
     while(1){
-        ssize_t n= read(fd_in, readbuf + rb_len, sizeof(readbuf)-1 - rb_len);
+        int ready = poll(pfd, 2, CREDIT_CHECK_MS);
+        if(ready<0 && errno!=EINTR){
+            perror("[STERNIK] poll");
+            break;
+        }
+
+        /* Sygnały: zatrzymanie łodzi od razu, bez czekania na skan */
+        if(ready>0 && (pfd[1].revents & POLLIN)){
+            struct signalfd_siginfo si;
+            int term = 0;
+            while(read(sfd, &si, sizeof(si))==(ssize_t)sizeof(si)){
+                if(si.ssi_signo==SIGUSR1){
+                    for(int i=0; i<nboats; i+=2) boat_stop(&boats[i], "SIGUSR1");
+                }
+                else if(si.ssi_signo==SIGUSR2){
+                    for(int i=1; i<nboats; i+=2) boat_stop(&boats[i], "SIGUSR2");
+                }
+                else if(si.ssi_signo==SIGTERM) term = 1;
+            }
+            if(term){
+                logMsg("[STERNIK] SIGTERM => end.\n");
+                goto finish;
+            }
+        }
+
+        ssize_t n = 0;
+        if(ready>0 && (pfd[0].revents & POLLIN)){
+            n = read(fd_in, readbuf + rb_len, sizeof(readbuf) - rb_len);
+        }
         if(n>0){
             rb_len += n;
-            readbuf[rb_len] = '\0';
-
-            /* Rozbijamy na linie po '\n' */
-            char *start = readbuf;
-            while(1) {
-                char *nl = strchr(start, '\n');
-                if(!nl) break;
-                *nl = '\0'; // zamieniamy '\n' na '\0'
-
-                char line[256];
-                strncpy(line, start, sizeof(line));
-                line[sizeof(line)-1] = '\0';
-                start = nl + 1;
-
-                /* Parsujemy komendę */
-                if(!strncmp(line, "QUEUE_SKIP", 10)){
-                    /* Format: QUEUE_SKIP pid boat disc pass_fifo */
-                    int pid=0, bno=0, disc=0;
-                    char p_fifo[128]={0};
-
-                    int c = sscanf(line,"QUEUE_SKIP %d %d %d %s", &pid, &bno, &disc, p_fifo);
-                    if(c < 4){
-                        logMsg("[STERNIK] Błędne skip: %s\n", line);
-                        continue;
-                    }
-                    PassengerItem pi;
-                    pi.pid   = pid;
-                    pi.disc  = disc;
-                    pi.group = 0;
-                    strncpy(pi.pass_fifo, p_fifo, sizeof(pi.pass_fifo));
-
-                    pthread_mutex_lock(&mutex);
-                    if(bno==1 && boat1_active){
-                        if(!isFull(&queueBoat1_skip)){
-                            enqueue(&queueBoat1_skip, pi);
-                            logMsg("[STERNIK] skip pass %d -> boat1_skip (disc=%d)\n",
-                                   pid, pi.disc);
-                        } else {
-                            logMsg("[STERNIK] queueBoat1_skip full -> odrzucam %d\n", pid);
-                        }
-                    }
-                    else if(bno==2 && boat2_active){
-                        if(!isFull(&queueBoat2_skip)){
-                            enqueue(&queueBoat2_skip, pi);
-                            logMsg("[STERNIK] skip pass %d -> boat2_skip (disc=%d)\n",
-                                   pid, pi.disc);
-                        } else {
-                            logMsg("[STERNIK] queueBoat2_skip full -> odrzucam %d\n", pid);
-                        }
-                    }
-                    else {
-                        logMsg("[STERNIK] boat %d inactive => %d odrzucony\n", bno,pid);
-                    }
-                    pthread_mutex_unlock(&mutex);
-                }
-                else if(!strncmp(line, "QUEUE", 5)){
-                    /* Format: QUEUE pid boat disc pass_fifo */
-                    int pid=0, bno=0, disc=0;
-                    char p_fifo[128]={0};
-
-                    int c= sscanf(line,"QUEUE %d %d %d %s", &pid,&bno,&disc,p_fifo);
-                    if(c < 4){
-                        logMsg("[STERNIK] Błędne queue: %s\n", line);
-                        continue;
-                    }
-                    PassengerItem pi;
-                    pi.pid   = pid;
-                    pi.disc  = disc;
-                    pi.group = 0;
-                    strncpy(pi.pass_fifo, p_fifo, sizeof(pi.pass_fifo));
-
-                    pthread_mutex_lock(&mutex);
-                    if(bno==1 && boat1_active){
-                        if(!isFull(&queueBoat1)){
-                            enqueue(&queueBoat1, pi);
-                            logMsg("[STERNIK] pass %d->boat1 disc=%d\n", pid, disc);
-                        } else {
-                            logMsg("[STERNIK] queueBoat1 full => odrzucono %d\n", pid);
-                        }
-                    }
-                    else if(bno==2 && boat2_active){
-                        if(!isFull(&queueBoat2)){
-                            enqueue(&queueBoat2, pi);
-                            logMsg("[STERNIK] pass %d->boat2 disc=%d\n", pid, disc);
-                        } else {
-                            logMsg("[STERNIK] queueBoat2 full => odrzucono %d\n", pid);
-                        }
-                    }
-                    else {
-                        logMsg("[STERNIK] boat %d inactive => %d odrzucony\n", bno,pid);
+
+            /* Rozbijamy na linie po '\n' - bez kopiowania */
+            char *p = readbuf, *end = readbuf + rb_len, *nl;
+            int nb = 0, quit = 0;
+            while(!quit && (nl = memchr(p, '\n', end - p)) != NULL){
+                char *le = nl;
+                if(le>p && le[-1]=='\r') le--;
+
+                int pr = parse_queue_line(p, le, &batch[nb]);
+                if(pr>0){
+                    if(++nb == MAX_BATCH){
+                        flush_batch(batch, nb);
+                        nb = 0;
                     }
-                    pthread_mutex_unlock(&mutex);
                 }
-                else if(!strncmp(line, "INFO", 4)){
-                    /* Informacja diagnostyczna */
-                    pthread_mutex_lock(&mutex);
-                    const char *st = (pomost_state==FREE)?"FREE":
-                                     (pomost_state==INBOUND)?"INBOUND":"OUTBOUND";
-                    logMsg("[INFO] b1_act=%d rejs=%d, b2_act=%d rejs=%d, "
-                           "q1=%d skip=%d, q2=%d skip=%d, p_count=%d, st=%s\n",
-                           boat1_active, boat1_inrejs,
-                           boat2_active, boat2_inrejs,
-                           queueBoat1.count, queueBoat1_skip.count,
-                           queueBoat2.count, queueBoat2_skip.count,
-                           pomost_count, st);
-                    pthread_mutex_unlock(&mutex);
-                }
-                else if(!strncmp(line, "QUIT", 4)){
-                    logMsg("[STERNIK] QUIT => end.\n");
-                    goto finish;
+                else if(pr<0){
+                    logMsg("[STERNIK] Błędne queue: %.*s\n", (int)(le - p), p);
                 }
                 else {
-                    logMsg("[STERNIK] Nieznane: %s\n", line);
+                    /* komenda sterująca - najpierw wstawiamy to, co przyszło przed nią */
+                    flush_batch(batch, nb);
+                    nb = 0;
+                    quit = handle_control(p, le);
                 }
+                p = nl + 1;
             }
+            flush_batch(batch, nb);
+            if(quit) goto finish;
+
             /* Przenosimy ewentualną pozostałą część bufora (bez zakończonej linii) */
-            ssize_t rem = rb_len - (start - readbuf);
-            if(rem>0) {
-                memmove(readbuf, start, rem);
+            size_t rem = end - p;
+            if(rem>0 && p!=readbuf) {
+                memmove(readbuf, p, rem);
             }
             rb_len = rem;
+            if(rb_len == sizeof(readbuf)){
+                logMsg("[STERNIK] linia dłuższa niż bufor -> odrzucam.\n");
+                rb_len = 0;
+            }
         }
         else if(n<0) {
             if(errno!=EAGAIN && errno!=EINTR){
@@ -857,32 +1374,77 @@ int main(int argc, char* argv[])
             }
         }
 
+        /* Co CREDIT_INTERVAL_MS ogłaszamy kasjerowi wolne miejsca
+           (albo od razu, gdy zmieniły się od ostatniego ogłoszenia). */
+        long long now_ms = mono_ms();
+        int changed = 0;
+        for(int i=0; i<nboats; i++){
+            credit[i] = boats[i].active ? boat_credit(&boats[i]) : 0;
+            changed |= credit[i]!=last_credit[i];
+        }
+        if(now_ms - last_credit_ms >= CREDIT_INTERVAL_MS ||
+           (changed && now_ms - last_credit_ms >= 10)){
+            advertise_credit(credit);
+            ct_flush();   // ślad Chrome na dysk przy okazji (gdyby nas zabito)
+            last_credit_ms = now_ms;
+            memcpy(last_credit, credit, nboats * sizeof(int));
+        }
+
         /* Timeout globalny? */
         if(time(NULL) >= end_time){
             logMsg("[STERNIK] Czas się skończył => end.\n");
             break;
         }
 
-        /* Czy obie łodzie nieaktywne? */
-        pthread_mutex_lock(&mutex);
-        if(!boat1_active && !boat2_active){
-            pthread_mutex_unlock(&mutex);
-            logMsg("[STERNIK] Obie łodzie inactive -> end.\n");
+        /* Gdy nieaktywne są wszystkie łodzie - koniec */
+        int nactive = 0;
+        for(int i=0; i<nboats && !nactive; i++) nactive = boats[i].active;
+        if(!nactive){
+            logMsg("[STERNIK] Wszystkie łodzie inactive -> end.\n");
             break;
         }
-        pthread_mutex_unlock(&mutex);
     }
 
 finish:
-    pthread_mutex_lock(&mutex);
-    boat1_active = 0;
-    boat2_active = 0;
-    pthread_mutex_unlock(&mutex);
+    /* Każda łódź kończy w swoim tempie (rejs w toku jest dokończony),
+       czekamy aż wszystkie dojdą do końca pracy. */
+    for(int i=0; i<nboats; i++){
+        boats[i].active = 0;
+        boat_wake(&boats[i]);
+    }
+    pthread_mutex_lock(&done_mutex);
+    while(atomic_load(&boats_running)>0){
+        pthread_cond_wait(&cond_done, &done_mutex);
+    }
+    pthread_mutex_unlock(&done_mutex);
+    ckpt_stop = 1;
+    sched_stop(&sched);
+
+    /* Kredyt 0 dla kasjera i odprawienie wszystkich, którzy jeszcze czekają
+       w kolejkach - żaden proces pasazer nie zostaje bez odpowiedzi. */
+    advertise_credit(NULL);
+    free(credit);
+    free(last_credit);
+    for(int i=0; i<nboats; i++){
+        PassengerItem pp;
+        while(boat_dequeue(&boats[i], &pp)==0){
+            reject_passenger(&pp, "CLOSED");
+        }
+    }
 
-    pthread_join(t1, NULL);
-    pthread_join(t2, NULL);
+    write_summary();
+    lp_dump(stdout, "STERNIK");
+
+    /* Normalny koniec - plik stanu nie będzie wznawiany */
+    if(ckpt.fd>=0){
+        ckpt_mark_clean(&ckpt);
+        ckpt_close(&ckpt);
+    }
 
     close(fd_in);
+    if(fd_in_dummy>=0) close(fd_in_dummy);
+    close(sfd);
+    free(boats);
     logMsg("[STERNIK] end.\n");
     //if(sternikLog) fclose(sternikLog);
     return 0;
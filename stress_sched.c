@@ -0,0 +1,147 @@
+/*******************************************************
+ * File: stress_sched.c
+ *
+ * Test obciążeniowy harmonogramu (scheduler.h) - bez sternika.
+ * Każde zadanie w run() od razu ustawia sobie kolejny termin (sched_at,
+ * jak boat_wake_at w boat_step), a osobne wątki w tym samym czasie
+ * budzą losowe zadania (sched_wake, jak boat_wake z pętli głównej).
+ * Zadanie bywa więc uruchomione i przestawione w kole, zanim wątek koła
+ * skończy budzić listę zadań z minionym terminem.
+ * Po czasie -d budzący kończą, a koło chodzi dalej: każde zadanie musi
+ * się jeszcze uruchamiać samo z siebie. Zadanie, które przez STALL_MS
+ * nie ruszyło, zgubiło się z koła - wynik 1. Zepsuta lista w slocie
+ * potrafi też zapętlić wątek koła - wtedy test kończy strażnik (alarm).
+ *
+ * Użycie: ./stress_sched [-t zadania] [-w wątki_robocze] [-b wątki_budzące]
+ *                        [-d czas_s]
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "scheduler.h"
+
+#define MAX_WAKERS 16
+#define MAX_DELAY  20     // kolejny termin: now + 1..MAX_DELAY ms
+#define STALL_MS   500    // tyle bez uruchomienia = zadanie zgubione
+
+typedef struct {
+    SchedTask task;       // musi być pierwsze - harmonogram woła task.run
+    uint32_t rnd;         // zadanie nie działa na dwóch wątkach naraz
+    atomic_llong last_ms;
+    atomic_long  runs;
+} Job;
+
+static Scheduler sched;
+static Job *jobs;
+static int njobs = 2000, nworkers = 4, nwakers = 2, dur_s = 3;
+static atomic_int waking = 1;
+
+static uint32_t xorshift32(uint32_t *x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static void job_run(SchedTask *t)
+{
+    Job *j = (Job*)t;
+    long long now = sched_now_ms();
+    atomic_store(&j->last_ms, now);
+    atomic_fetch_add(&j->runs, 1);
+    sched_at(&sched, t, now + 1 + xorshift32(&j->rnd) % MAX_DELAY);
+}
+
+static void *waker_main(void *arg)
+{
+    uint32_t rnd = (uint32_t)(uintptr_t)arg * 2654435761u + 1;
+    while(atomic_load(&waking)){
+        sched_wake(&sched, &jobs[xorshift32(&rnd) % njobs].task);
+        if((rnd & 63)==0) sched_yield();
+    }
+    return NULL;
+}
+
+/* Strażnik: test nie skończył się w czasie - harmonogram się zapętlił */
+static void on_alarm(int sig)
+{
+    (void)sig;
+    static const char msg[] = "[SCHED] test się zawiesił (zapętlone koło?)\n";
+    write(2, msg, sizeof(msg)-1);
+    _exit(1);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Użycie: %s [-t zadania] [-w wątki_robocze] [-b wątki_budzące] [-d czas_s]\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while((opt = getopt(argc, argv, "t:w:b:d:h")) != -1){
+        switch(opt){
+        case 't': njobs    = atoi(optarg); break;
+        case 'w': nworkers = atoi(optarg); break;
+        case 'b': nwakers  = atoi(optarg); break;
+        case 'd': dur_s    = atoi(optarg); break;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if(njobs<1) njobs = 1;
+    if(nwakers<0) nwakers = 0;
+    if(nwakers>MAX_WAKERS) nwakers = MAX_WAKERS;
+    if(dur_s<1) dur_s = 1;
+
+    signal(SIGALRM, on_alarm);
+    alarm(dur_s + 10);
+
+    jobs = calloc(njobs, sizeof(Job));
+    if(!jobs){
+        fprintf(stderr, "[SCHED] brak pamięci\n");
+        return 1;
+    }
+    if(sched_start(&sched, nworkers)<0){
+        perror("[SCHED] timerfd");
+        return 1;
+    }
+    long long t0 = sched_now_ms();
+    for(int i=0; i<njobs; i++){
+        jobs[i].task.run = job_run;
+        jobs[i].rnd = (uint32_t)i * 2246822519u + 1;
+        atomic_store(&jobs[i].last_ms, t0);
+        sched_at(&sched, &jobs[i].task, t0 + 1 + i % MAX_DELAY);
+    }
+
+    pthread_t wk[MAX_WAKERS];
+    for(int i=0; i<nwakers; i++) pthread_create(&wk[i], NULL, waker_main, (void*)(uintptr_t)(i+1));
+    sleep(dur_s);
+    atomic_store(&waking, 0);
+    for(int i=0; i<nwakers; i++) pthread_join(wk[i], NULL);
+
+    /* same terminy z koła - każde zadanie musi jeszcze ruszać */
+    usleep(2*STALL_MS*1000);
+    long long now = sched_now_ms();
+    long runs = 0;
+    int lost = 0;
+    for(int i=0; i<njobs; i++){
+        runs += atomic_load(&jobs[i].runs);
+        if(now - atomic_load(&jobs[i].last_ms) > STALL_MS) lost++;
+    }
+    printf("[SCHED] zadań=%d wątków=%d budzących=%d czas=%ds: uruchomień %ld, zgubionych %d\n",
+           njobs, sched.nworkers, nwakers, dur_s, runs, lost);
+
+    for(int i=0; i<njobs; i++) sched_cancel(&sched, &jobs[i].task);
+    sched_stop(&sched);
+    free(jobs);
+    return lost ? 1 : 0;
+}
@@ -0,0 +1,358 @@
+/*******************************************************
+ * File: stress_sternik.c
+ *
+ * Samodzielny test obciążeniowy sternika - bez kasjera, orchestratora
+ * i procesów pasazer. Uruchamia sternika (z katalogu tego programu)
+ * w bieżącym katalogu albo w SIM_RUN_DIR (rundir.h), a potem:
+ *   - W wątków pisze do fifo_sternik_in komendy QUEUE/QUEUE_SKIP
+ *     (partiami <= PIPE_BUF, więc linie różnych wątków się nie mieszają),
+ *     bez limitu albo z zadaną szybkością na wątek;
+ *   - sam obsługuje FIFO odpowiedzi (jedno na wątek piszący, wielu
+ *     "pasażerów" na FIFO - odpowiedzi rozróżniamy po pid).
+ * Mierzy:
+ *   - szybkość wejścia (linie/s zapisane do fifo_sternik_in),
+ *   - przepływ łodzi (UNLOADED/s; każdy wsiadający jest raz wyładowany),
+ *   - odrzucenia wg powodu (FULL = isFull/QUEUE_LIMIT, INACTIVE, ...),
+ *   - czas od wysłania QUEUE do UNLOADED (avg, p50, p90, p99, max).
+ *
+ * Użycie: ./stress_sternik [-w wątki] [-n pasażerów_na_wątek] [-r linii/s_na_wątek]
+ *                          [-b łodzie] [-t timeout_sternika_s] [-l log_sternika]
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "rundir.h"
+
+#define MAX_WRITERS 64
+#define BASE_PID    100000   // pid-y z dala od pasażerów orchestratora
+
+/* Stan pojedynczego pasażera testowego */
+enum { PS_NEW, PS_SENT, PS_UNLOADED, PS_REJECTED };
+
+/* Powody odrzucenia - jak w REJECTED <pid> <powód> */
+static const char *reasons[] = {"FULL", "INACTIVE", "NOTIME", "GROUP", "CLOSED"};
+#define NREASONS 5
+
+static int  nwriters = 8;
+static long per_writer = 2000;
+static long rate = 0;           // linii/s na wątek, 0 = bez limitu
+static int  nboats = 2;
+static int  timeout_s = 20;
+static const char *sternik_log = "/dev/null";
+
+static long       total;
+static long long *sent_ns;      // [idx] czas wysłania QUEUE
+static _Atomic int *state;      // [idx] PS_*
+static long long *lat_ns;       // opóźnienia QUEUE -> UNLOADED
+static _Atomic long nlat;
+static _Atomic long resolved;
+static _Atomic long rejected[NREASONS + 1];   // + inne
+static _Atomic long unknown;
+static long long first_unload_ns, last_unload_ns;
+
+static long long write_t0, write_t1;
+static _Atomic long lines_written;
+static volatile int stop_reader;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+static void reply_fifo(char *out, size_t sz, int w)
+{
+    snprintf(out, sz, "fifo_stress_%d", w);
+}
+
+/* ---------- wątki piszące ---------- */
+static void *writer(void *arg)
+{
+    int w = (int)(long)arg;
+    char fifo[64];
+    reply_fifo(fifo, sizeof(fifo), w);
+
+    int fd = open("fifo_sternik_in", O_WRONLY);
+    if(fd<0){
+        perror("[STRESS] open fifo_sternik_in");
+        return NULL;
+    }
+    char buf[PIPE_BUF];
+    size_t len = 0;
+    long long t_start = now_ns();
+    for(long i=0; i<per_writer; i++){
+        long idx = (long)w * per_writer + i;
+        int pid  = BASE_PID + (int)idx;
+        int bno  = 1 + (int)(idx % nboats);
+        int skip = (i % 10 == 9);
+        char line[160];
+        int m = snprintf(line, sizeof(line), "%s %d %d %d %s\n",
+                         skip ? "QUEUE_SKIP" : "QUEUE", pid, bno, skip ? 50 : 0, fifo);
+        if(len + m > sizeof(buf)){
+            write(fd, buf, len);
+            len = 0;
+        }
+        /* czas wysłania = chwila przed zapisem partii, w której jest linia */
+        sent_ns[idx] = now_ns();
+        atomic_store(&state[idx], PS_SENT);
+        memcpy(buf + len, line, m);
+        len += m;
+
+        if(rate > 0){
+            /* równe tempo: linia i powinna wyjść w t_start + i/rate */
+            write(fd, buf, len);
+            len = 0;
+            long long due = t_start + (long long)(i + 1) * 1000000000LL / rate;
+            long long d = due - now_ns();
+            if(d > 0){
+                struct timespec ts = { d / 1000000000, d % 1000000000 };
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+    if(len) write(fd, buf, len);
+    close(fd);
+    atomic_fetch_add(&lines_written, per_writer);
+    return NULL;
+}
+
+/* ---------- odbiór odpowiedzi ---------- */
+static void handle_reply(const char *line)
+{
+    int pid;
+    char why[32];
+    long long t = now_ns();
+    if(sscanf(line, "UNLOADED %d", &pid)==1){
+        long idx = pid - BASE_PID;
+        if(idx<0 || idx>=total) goto bad;
+        int exp = PS_SENT;
+        if(!atomic_compare_exchange_strong(&state[idx], &exp, PS_UNLOADED)) goto bad;
+        lat_ns[atomic_fetch_add(&nlat, 1)] = t - sent_ns[idx];
+        if(!first_unload_ns) first_unload_ns = t;
+        last_unload_ns = t;
+        atomic_fetch_add(&resolved, 1);
+        return;
+    }
+    if(sscanf(line, "REJECTED %d %31s", &pid, why)==2){
+        long idx = pid - BASE_PID;
+        if(idx<0 || idx>=total) goto bad;
+        int exp = PS_SENT;
+        if(!atomic_compare_exchange_strong(&state[idx], &exp, PS_REJECTED)) goto bad;
+        int r = 0;
+        while(r<NREASONS && strcmp(why, reasons[r])) r++;
+        atomic_fetch_add(&rejected[r], 1);
+        atomic_fetch_add(&resolved, 1);
+        return;
+    }
+bad:
+    atomic_fetch_add(&unknown, 1);
+}
+
+typedef struct {
+    int    fd;
+    char   buf[4096];
+    size_t len;
+} ReplyFifo;
+
+static ReplyFifo replies[MAX_WRITERS];
+
+static void *reader(void *arg)
+{
+    (void)arg;
+    struct pollfd pfd[MAX_WRITERS];
+    for(int w=0; w<nwriters; w++){
+        pfd[w].fd = replies[w].fd;
+        pfd[w].events = POLLIN;
+    }
+    while(!stop_reader){
+        int r = poll(pfd, nwriters, 100);
+        if(r<=0) continue;
+        for(int w=0; w<nwriters; w++){
+            if(!(pfd[w].revents & POLLIN)) continue;
+            ReplyFifo *rf = &replies[w];
+            ssize_t n = read(rf->fd, rf->buf + rf->len, sizeof(rf->buf) - rf->len);
+            if(n<=0) continue;
+            rf->len += n;
+            char *p = rf->buf, *end = rf->buf + rf->len, *nl;
+            while((nl = memchr(p, '\n', end - p)) != NULL){
+                *nl = '\0';
+                handle_reply(p);
+                p = nl + 1;
+            }
+            rf->len = end - p;
+            if(rf->len == sizeof(rf->buf)) rf->len = 0;   // śmieci bez '\n'
+            memmove(rf->buf, p, rf->len);
+        }
+    }
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Użycie: %s [-w wątki] [-n pasażerów_na_wątek] [-r linii/s_na_wątek]\n"
+                    "          [-b łodzie] [-t timeout_sternika_s] [-l log_sternika]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while((opt = getopt(argc, argv, "w:n:r:b:t:l:h")) != -1){
+        switch(opt){
+        case 'w': nwriters   = atoi(optarg); break;
+        case 'n': per_writer = atol(optarg); break;
+        case 'r': rate       = atol(optarg); break;
+        case 'b': nboats     = atoi(optarg); break;
+        case 't': timeout_s  = atoi(optarg); break;
+        case 'l': sternik_log = optarg;      break;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if(nwriters<1) nwriters = 1;
+    if(nwriters>MAX_WRITERS) nwriters = MAX_WRITERS;
+    if(per_writer<1) per_writer = 1;
+    if(nboats<2) nboats = 2;
+    setbuf(stdout, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    total   = (long)nwriters * per_writer;
+    sent_ns = calloc(total, sizeof(long long));
+    state   = calloc(total, sizeof(*state));
+    lat_ns  = calloc(total, sizeof(long long));
+    if(!sent_ns || !state || !lat_ns){
+        fprintf(stderr, "[STRESS] brak pamięci\n");
+        return 1;
+    }
+
+    /* Sternik z katalogu tego programu, pliki w katalogu przebiegu */
+    char sternik_bin[PATH_MAX];
+    bin_path(sternik_bin, sizeof(sternik_bin), "sternik");
+    if(rundir_enter(1)<0){
+        perror("[STRESS] " RUN_DIR_ENV);
+        return 1;
+    }
+
+    /* FIFO wejścia sternika i nasze FIFO odpowiedzi. O_RDWR: sternik
+       otwiera je nieblokująco do zapisu, więc czytelnik musi być zawsze. */
+    unlink("sternik.state");
+    mkfifo("fifo_sternik_in", 0666);
+    int fd_hold = open("fifo_sternik_in", O_RDWR);
+    for(int w=0; w<nwriters; w++){
+        char name[64];
+        reply_fifo(name, sizeof(name), w);
+        unlink(name);
+        if(mkfifo(name, 0666)<0 || (replies[w].fd = open(name, O_RDWR | O_NONBLOCK))<0){
+            perror(name);
+            return 1;
+        }
+    }
+
+    pid_t st = fork();
+    if(st==0){
+        int fd = open(sternik_log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd>=0){
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
+        }
+        char t[16], b[16];
+        snprintf(t, sizeof(t), "%d", timeout_s);
+        snprintf(b, sizeof(b), "%d", nboats);
+        execl(sternik_bin, "sternik", t, b, (char*)NULL);
+        perror(sternik_bin);
+        _exit(1);
+    }
+    if(st<0){
+        perror("[STRESS] fork");
+        return 1;
+    }
+    usleep(200000);   // sternik otwiera wejście i startuje łodzie
+
+    printf("[STRESS] sternik pid=%d, łodzi=%d, wątków=%d x %ld pasażerów%s\n",
+           (int)st, nboats, nwriters, per_writer, rate ? "" : " (bez limitu)");
+
+    pthread_t rd, wr[MAX_WRITERS];
+    pthread_create(&rd, NULL, reader, NULL);
+    write_t0 = now_ns();
+    for(int w=0; w<nwriters; w++) pthread_create(&wr[w], NULL, writer, (void*)(long)w);
+    for(int w=0; w<nwriters; w++) pthread_join(wr[w], NULL);
+    write_t1 = now_ns();
+
+    /* Czekamy na odpowiedź dla każdego pasażera albo na koniec sternika */
+    long long deadline = now_ns() + (long long)(timeout_s + 10) * 1000000000LL;
+    int st_exited = 0;
+    while(atomic_load(&resolved) < total && now_ns() < deadline){
+        if(!st_exited && waitpid(st, NULL, WNOHANG)==st){
+            st_exited = 1;
+            deadline = now_ns() + 1000000000LL;   // dobieramy resztę odpowiedzi
+        }
+        usleep(20000);
+    }
+    if(!st_exited){
+        write(fd_hold, "QUIT\n", 5);
+        for(int i=0; i<100 && waitpid(st, NULL, WNOHANG)!=st; i++) usleep(50000);
+        kill(st, SIGKILL);
+        waitpid(st, NULL, 0);
+    }
+    stop_reader = 1;
+    pthread_join(rd, NULL);
+
+    /* ---------- raport ---------- */
+    double wsec = (write_t1 - write_t0) / 1e9;
+    long nunl = atomic_load(&nlat);
+    long nrej = 0;
+    for(int r=0; r<=NREASONS; r++) nrej += atomic_load(&rejected[r]);
+
+    printf("\nWejście: %ld linii w %.3f s = %.0f linii/s\n",
+           atomic_load(&lines_written), wsec, wsec > 0 ? atomic_load(&lines_written)/wsec : 0);
+    printf("Odpowiedzi: %ld/%ld (UNLOADED %ld, REJECTED %ld, bez odpowiedzi %ld, nieoczekiwane %ld)\n",
+           atomic_load(&resolved), total, nunl, nrej, total - atomic_load(&resolved),
+           atomic_load(&unknown));
+    printf("Odrzucenia:");
+    for(int r=0; r<NREASONS; r++) printf(" %s=%ld", reasons[r], atomic_load(&rejected[r]));
+    printf(" inne=%ld\n", atomic_load(&rejected[NREASONS]));
+
+    if(nunl>0){
+        double usec = (last_unload_ns - first_unload_ns) / 1e9;
+        printf("Przepływ łodzi: %ld wyładowanych w %.2f s = %.1f pasażerów/s\n",
+               nunl, usec, usec > 0 ? nunl/usec : 0);
+        qsort(lat_ns, nunl, sizeof(long long), cmp_ll);
+        double sum = 0;
+        for(long i=0; i<nunl; i++) sum += lat_ns[i];
+        #define PCT(p) (lat_ns[(long)((nunl-1)*(p))]/1e6)
+        printf("QUEUE->UNLOADED [ms]: avg=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f\n",
+               sum/nunl/1e6, PCT(0.50), PCT(0.90), PCT(0.99), lat_ns[nunl-1]/1e6);
+        #undef PCT
+    } else {
+        printf("Przepływ łodzi: brak wyładunków\n");
+    }
+
+    for(int w=0; w<nwriters; w++){
+        char name[64];
+        reply_fifo(name, sizeof(name), w);
+        close(replies[w].fd);
+        unlink(name);
+    }
+    close(fd_hold);
+    unlink("sternik.state");
+    free(sent_ns); free((void*)state); free(lat_ns);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*******************************************************
+ * File: sweep.c
+ *
+ * Przegląd parametrów: wiele niezależnych symulacji naraz, każda
+ * w osobnym katalogu przebiegu (rundir.h), wyniki w jednym CSV.
+ * Siatka = iloczyn list: pojemności łodzi (N1:N2), K, LOAD_TIMEOUT
+ * i przerwa bazowa generatora (tempo przybywania); każdy punkt -r razy.
+ * Przebieg: <katalog>/run_<nr>/ z sternik.conf, log orchestratora
+ * i podsumowaniami (orchestrator.summary, sternik.summary), z których
+ * składany jest wiersz CSV.
+ *
+ * Użycie: ./sweep [-j równolegle] [-t czas_s] [-r powtórzeń] [-d katalog]
+ *                 [-o wynik.csv] [-N "N1:N2,..."] [-K "k,..."]
+ *                 [-L "s,..."] [-I "ms,..."]
+ *   np.   ./sweep -t 15 -N "10:11,16:16" -K "4,8" -I "250,1000"
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "boatconf.h"
+#include "rundir.h"
+
+#define MAX_LIST  64
+#define GRACE_S   30     // ponad czas symulacji, zanim przebieg zostanie zabity
+
+typedef struct {
+    BoatConf conf;
+    int interval_ms;
+    int rep;
+    char dir[PATH_MAX];
+    pid_t pid;           // 0 - jeszcze nie ruszył / już zebrany
+    int stdin_fd;        // trzymamy stdin orchestratora otwarte do końca
+    time_t started;
+    int status;          // kod wyjścia albo -sygnał
+    int done;
+} Run;
+
+static int parse_list(const char *s, int *out, int max)
+{
+    int n = 0;
+    while (*s && n < max) {
+        char *e;
+        long v = strtol(s, &e, 10);
+        if (e == s) return -1;
+        out[n++] = (int)v;
+        s = (*e == ',') ? e + 1 : e;
+        if (*e && *e != ',') return -1;
+    }
+    return n;
+}
+
+/* "10:11,16" -> pary (N1, N2); sama liczba = obie łodzie tak samo */
+static int parse_pairs(const char *s, int *a, int *b, int max)
+{
+    int n = 0;
+    while (*s && n < max) {
+        char *e;
+        a[n] = (int)strtol(s, &e, 10);
+        if (e == s) return -1;
+        b[n] = a[n];
+        if (*e == ':') {
+            s = e + 1;
+            b[n] = (int)strtol(s, &e, 10);
+            if (e == s) return -1;
+        }
+        n++;
+        if (*e && *e != ',') return -1;
+        s = (*e == ',') ? e + 1 : e;
+    }
+    return n;
+}
+
+/* Wartość klucza z linii "a=1 b=2 ..." albo -1 */
+static long kv_get(const char *line, const char *key)
+{
+    size_t kl = strlen(key);
+    for (const char *p = line; (p = strstr(p, key)) != NULL; p += kl) {
+        if ((p == line || p[-1] == ' ') && p[kl] == '=') return atol(p + kl + 1);
+    }
+    return -1;
+}
+
+static void read_line(const char *dir, const char *name, char *out, size_t sz)
+{
+    char path[PATH_MAX + 64];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    out[0] = '\0';
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    if (!fgets(out, (int)sz, f)) out[0] = '\0';
+    fclose(f);
+}
+
+static int start_run(Run *r, const char *orch_bin, int sim_s)
+{
+    if (mkdir(r->dir, 0777) < 0 && errno != EEXIST) {
+        perror(r->dir);
+        return -1;
+    }
+    char path[PATH_MAX + 64], cf[128];
+    snprintf(path, sizeof(path), "%s/%s", r->dir, BOATCONF_FILE);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    boatconf_format(&r->conf, cf, sizeof(cf));
+    fprintf(f, "%s\n", cf);
+    fclose(f);
+
+    int pfd[2];
+    if (pipe(pfd) < 0) {
+        perror("[SWEEP] pipe");
+        return -1;
+    }
+    fcntl(pfd[1], F_SETFD, FD_CLOEXEC);   // inne przebiegi nie dziedziczą
+
+    pid_t c = fork();
+    if (c < 0) {
+        perror("[SWEEP] fork");
+        close(pfd[0]);
+        close(pfd[1]);
+        return -1;
+    }
+    if (c == 0) {
+        setpgid(0, 0);   // cały przebieg (z pasażerami) w jednej grupie
+        snprintf(path, sizeof(path), "%s/orchestrator.log", r->dir);
+        int lfd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (lfd >= 0) {
+            dup2(lfd, STDOUT_FILENO);
+            dup2(lfd, STDERR_FILENO);
+            close(lfd);
+        }
+        dup2(pfd[0], STDIN_FILENO);
+        close(pfd[0]);
+        char iv[16];
+        snprintf(iv, sizeof(iv), "%d", r->interval_ms);
+        setenv("ORCH_INTERVAL_MS", iv, 1);
+        setenv(RUN_DIR_ENV, r->dir, 1);
+        execl(orch_bin, "orchestrator", (char *)NULL);
+        perror(orch_bin);
+        _exit(127);
+    }
+    setpgid(c, c);
+    close(pfd[0]);
+    char t[16];
+    int n = snprintf(t, sizeof(t), "%d\n", sim_s);
+    if (write(pfd[1], t, n) != n) perror("[SWEEP] write stdin");
+    r->pid = c;
+    r->stdin_fd = pfd[1];
+    r->started = time(NULL);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Użycie: %s [-j równolegle] [-t czas_s] [-r powtórzeń] [-d katalog]\n"
+                    "          [-o wynik.csv] [-N \"N1:N2,...\"] [-K \"k,...\"]\n"
+                    "          [-L \"s,...\"] [-I \"ms,...\"]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int sim_s = 20, reps = 1;
+    const char *base = "sweep_runs", *csv = "sweep.csv";
+    const char *ns = "10:11", *ks = "8", *ls = "2", *is = "1000";
+    int opt;
+    while ((opt = getopt(argc, argv, "j:t:r:d:o:N:K:L:I:h")) != -1) {
+        switch (opt) {
+        case 'j': jobs  = atoi(optarg); break;
+        case 't': sim_s = atoi(optarg); break;
+        case 'r': reps  = atoi(optarg); break;
+        case 'd': base  = optarg; break;
+        case 'o': csv   = optarg; break;
+        case 'N': ns    = optarg; break;
+        case 'K': ks    = optarg; break;
+        case 'L': ls    = optarg; break;
+        case 'I': is    = optarg; break;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (jobs < 1) jobs = 1;
+    if (sim_s < 1) sim_s = 1;
+    if (reps < 1) reps = 1;
+    setbuf(stdout, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int n1[MAX_LIST], n2[MAX_LIST], kv[MAX_LIST], lv[MAX_LIST], iv[MAX_LIST];
+    int nn = parse_pairs(ns, n1, n2, MAX_LIST), nk = parse_list(ks, kv, MAX_LIST);
+    int nl = parse_list(ls, lv, MAX_LIST), ni = parse_list(is, iv, MAX_LIST);
+    if (nn < 1 || nk < 1 || nl < 1 || ni < 1) {
+        fprintf(stderr, "[SWEEP] błędna lista parametrów\n");
+        usage(argv[0]);
+        return 1;
+    }
+
+    char orch_bin[PATH_MAX];
+    bin_path(orch_bin, sizeof(orch_bin), "orchestrator");
+    if (mkdir(base, 0777) < 0 && errno != EEXIST) {
+        perror(base);
+        return 1;
+    }
+
+    /* Siatka: pomijamy punkty, których sternik by nie przyjął */
+    int cap = nn * nk * nl * ni * reps, nruns = 0;
+    Run *runs = calloc(cap, sizeof(Run));
+    if (!runs) {
+        perror("[SWEEP] calloc");
+        return 1;
+    }
+    for (int a = 0; a < nn; a++)
+    for (int k = 0; k < nk; k++)
+    for (int l = 0; l < nl; l++)
+    for (int i = 0; i < ni; i++)
+    for (int r = 0; r < reps; r++) {
+        BoatConf c = BOATCONF_DEFAULT;
+        c.n1 = n1[a];
+        c.n2 = n2[a];
+        c.k  = kv[k];
+        c.load_timeout = lv[l];
+        const char *why = boatconf_check(&c);
+        if (why) {
+            if (i == 0 && r == 0) {
+                printf("[SWEEP] pomijam N1=%d N2=%d K=%d LOAD_TIMEOUT=%d: %s\n",
+                       c.n1, c.n2, c.k, c.load_timeout, why);
+            }
+            continue;
+        }
+        Run *x = &runs[nruns];
+        x->conf = c;
+        x->interval_ms = iv[i];
+        x->rep = r;
+        x->stdin_fd = -1;
+        snprintf(x->dir, sizeof(x->dir), "%s/run_%04d", base, nruns);
+        nruns++;
+    }
+    printf("[SWEEP] %d przebiegów po %d s, do %d naraz -> %s\n", nruns, sim_s, jobs, csv);
+
+    time_t t0 = time(NULL);
+    int next = 0, running = 0, finished = 0;
+    while (finished < nruns) {
+        while (running < jobs && next < nruns) {
+            if (start_run(&runs[next], orch_bin, sim_s) == 0) running++;
+            else {
+                runs[next].done = 1;
+                runs[next].status = -1;
+                finished++;
+            }
+            next++;
+        }
+        if (running == 0) continue;
+
+        int st;
+        pid_t w = waitpid(-1, &st, WNOHANG);
+        if (w <= 0) {
+            /* przebieg, który się zawiesił, kończymy całą grupą */
+            for (int i = 0; i < next; i++) {
+                Run *x = &runs[i];
+                if (x->pid > 0 && time(NULL) - x->started > sim_s + GRACE_S) {
+                    printf("[SWEEP] %s przekroczył czas -> SIGKILL\n", x->dir);
+                    kill(-x->pid, SIGKILL);
+                    x->started = time(NULL);   // nie zabijamy co obrót
+                }
+            }
+            usleep(100000);
+            continue;
+        }
+        for (int i = 0; i < next; i++) {
+            Run *x = &runs[i];
+            if (x->pid != w) continue;
+            x->pid = 0;
+            x->done = 1;
+            x->status = WIFEXITED(st) ? WEXITSTATUS(st) : -WTERMSIG(st);
+            close(x->stdin_fd);
+            kill(-w, SIGKILL);   // ewentualne sieroty przebiegu
+            running--;
+            finished++;
+            printf("[SWEEP] %d/%d %s (kod %d, %lds od startu)\n",
+                   finished, nruns, x->dir, x->status, (long)(time(NULL) - t0));
+            break;
+        }
+    }
+
+    FILE *out = fopen(csv, "w");
+    if (!out) {
+        perror(csv);
+        return 1;
+    }
+    fprintf(out, "run,dir,n1,n2,k,load_timeout,interval_ms,rep,status,"
+                 "generated,rejected,timeouts,trips,carried,boarded,"
+                 "wait_p50_ms,wait_p90_ms,wait_p99_ms,wait_max_ms\n");
+    static const char *okeys[] = { "generated", "rejected", "timeouts" };
+    static const char *skeys[] = { "trips", "carried", "boarded", "wait_p50_ms",
+                                   "wait_p90_ms", "wait_p99_ms", "wait_max_ms" };
+    for (int i = 0; i < nruns; i++) {
+        Run *x = &runs[i];
+        char ol[1024], sl[1024];
+        read_line(x->dir, "orchestrator.summary", ol, sizeof(ol));
+        read_line(x->dir, "sternik.summary", sl, sizeof(sl));
+        fprintf(out, "%d,%s,%d,%d,%d,%d,%d,%d,%d", i, x->dir, x->conf.n1, x->conf.n2,
+                x->conf.k, x->conf.load_timeout, x->interval_ms, x->rep, x->status);
+        for (size_t j = 0; j < sizeof(okeys) / sizeof(okeys[0]); j++) {
+            long v = kv_get(ol, okeys[j]);
+            if (v >= 0) fprintf(out, ",%ld", v);
+            else        fputs(",", out);
+        }
+        for (size_t j = 0; j < sizeof(skeys) / sizeof(skeys[0]); j++) {
+            long v = kv_get(sl, skeys[j]);
+            if (v >= 0) fprintf(out, ",%ld", v);
+            else        fputs(",", out);
+        }
+        fputc('\n', out);
+    }
+    fclose(out);
+    printf("[SWEEP] gotowe w %lds -> %s\n", (long)(time(NULL) - t0), csv);
+    free(runs);
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*******************************************************
+ * File: trace.h
+ *
+ * Binarny ślad zdarzeń - wspólny format dla wszystkich procesów.
+ * Włączany zmienną środowiskową TRACE_DIR=<katalog>: każdy proces pisze
+ * wtedy własny plik <katalog>/<nazwa>_<pid>.trace, a trace_analyze
+ * scala je offline (znaczniki czasu z CLOCK_MONOTONIC są wspólne
+ * dla procesów na jednej maszynie).
+ *
+ * Plik: TraceHdr, potem zdarzenia TraceEv (32 B). Zapis to jedno
+ * atomic_fetch_add + kopia do zmapowanego pliku (MAP_SHARED) - bez
+ * blokad i bez wywołań systemowych; strony przeżyją nawet zabicie procesu.
+ * Zdarzenia type==0 (niezapisane do końca) czytelnik pomija.
+ ******************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_MAGIC   0x45435254u   // "TRCE"
+#define TRACE_VERSION 1
+
+/* Procesy */
+enum { TP_ORCH = 1, TP_KASJER, TP_STERNIK, TP_PASAZER };
+
+/* Zdarzenia: pid = pasażer, boat = łódź, a/b - jak niżej */
+enum {
+    TE_SPAWN = 1,   // orch: pasażer uruchomiony           a=wiek b=grupa
+    TE_BUY,         // kasjer: BUY odebrane / pasazer: wysłane  a=wiek b=grupa
+    TE_OK,          // kasjer: bilet sprzedany / pasazer: odebrany  a=zniżka b=skip
+    TE_NO,          // kasjer: odmowa (brak miejsc)
+    TE_QUEUE,       // sternik: w kolejce / pasazer: QUEUE wysłane  a=skip
+    TE_REJECT,      // sternik: REJECTED                    a=powód (TR_*)
+    TE_BOARD,       // sternik: pasażer wsiadł              a=ilu na pokładzie
+    TE_DEPART,      // sternik: łódź wypływa                a=pasażerów b=pojemność
+    TE_RETURN,      // sternik: łódź wróciła                a=pasażerów
+    TE_UNLOADED,    // sternik: UNLOADED wysłane / pasazer: odebrane
+    TE_MAX
+};
+
+/* Powody odrzucenia (TE_REJECT.a) */
+enum { TR_OTHER, TR_FULL, TR_INACTIVE, TR_NOTIME, TR_GROUP, TR_CLOSED, TR_TIMEOUT };
+
+typedef struct {
+    uint32_t magic, version;
+    uint32_t proc, os_pid;
+    uint32_t ev_size, reserved;
+} TraceHdr;
+
+typedef struct {
+    int64_t  ts_ns;      // CLOCK_MONOTONIC
+    uint16_t type, proc;
+    int32_t  pid, boat;
+    int32_t  a, b;
+    int32_t  reserved;
+} TraceEv;
+
+static TraceEv       *trace_evs;   // NULL -> śledzenie wyłączone
+static size_t         trace_cap;
+static _Atomic size_t trace_n;
+static int            trace_fd = -1;
+static int            trace_proc_id;
+
+static int trace_reason(const char *why)
+{
+    if(!why) return TR_OTHER;
+    if(!strcmp(why, "FULL"))     return TR_FULL;
+    if(!strcmp(why, "INACTIVE")) return TR_INACTIVE;
+    if(!strcmp(why, "NOTIME"))   return TR_NOTIME;
+    if(!strcmp(why, "GROUP"))    return TR_GROUP;
+    if(!strcmp(why, "CLOSED"))   return TR_CLOSED;
+    if(!strcmp(why, "TIMEOUT"))  return TR_TIMEOUT;
+    return TR_OTHER;
+}
+
+/* Zdarzenie do śladu (bezpieczne z wielu wątków) */
+static void trace_ev(int type, int pid, int boat, int a, int b)
+{
+    if(!trace_evs) return;
+    size_t i = atomic_fetch_add_explicit(&trace_n, 1, memory_order_relaxed);
+    if(i >= trace_cap) return;   // plik pełny - reszta przepada
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    TraceEv *e = &trace_evs[i];
+    e->ts_ns = (int64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+    e->proc  = (uint16_t)trace_proc_id;
+    e->pid   = pid;
+    e->boat  = boat;
+    e->a     = a;
+    e->b     = b;
+    atomic_thread_fence(memory_order_release);
+    e->type  = (uint16_t)type;
+}
+
+/* Przycina plik do faktycznej liczby zdarzeń (atexit) */
+static void trace_close(void)
+{
+    if(!trace_evs) return;
+    size_t n = atomic_load(&trace_n);
+    if(n > trace_cap) n = trace_cap;
+    TraceHdr *h = (TraceHdr*)((char*)trace_evs - sizeof(TraceHdr));
+    munmap(h, sizeof(TraceHdr) + trace_cap*sizeof(TraceEv));
+    ftruncate(trace_fd, sizeof(TraceHdr) + n*sizeof(TraceEv));
+    close(trace_fd);
+    trace_evs = NULL;
+    trace_fd = -1;
+}
+
+/* Otwiera ślad procesu, jeśli ustawiono TRACE_DIR. max_events - limit
+   zdarzeń (plik rzadki, miejsce zajmują tylko zapisane strony). */
+static void trace_open(int proc, const char *name, size_t max_events)
+{
+    const char *dir = getenv("TRACE_DIR");
+    if(!dir || !*dir) return;
+    mkdir(dir, 0755);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s_%d.trace", dir, name, (int)getpid());
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd<0) return;
+    size_t sz = sizeof(TraceHdr) + max_events*sizeof(TraceEv);
+    if(ftruncate(fd, sz)<0){
+        close(fd);
+        return;
+    }
+    TraceHdr *h = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if(h==MAP_FAILED){
+        close(fd);
+        return;
+    }
+    h->magic   = TRACE_MAGIC;
+    h->version = TRACE_VERSION;
+    h->proc    = proc;
+    h->os_pid  = getpid();
+    h->ev_size = sizeof(TraceEv);
+
+    trace_fd      = fd;
+    trace_cap     = max_events;
+    trace_proc_id = proc;
+    atomic_store(&trace_n, 0);
+    trace_evs = (TraceEv*)(h + 1);
+    atexit(trace_close);
+}
+
+#endif
@@ -0,0 +1,233 @@
+/*******************************************************
+ * File: trace_analyze.c
+ *
+ * Analiza śladów binarnych (trace.h) z jednego przebiegu.
+ * Wczytuje wszystkie pliki *.trace z katalogu, scala je po czasie
+ * i liczy:
+ *   - liczby zdarzeń wg procesu i typu
+ *   - czas czekania w kolejce (sternik: QUEUE -> BOARD)
+ *   - czas od sprzedaży do wyładunku (kasjer OK -> sternik UNLOADED)
+ *     i od uruchomienia pasażera do wyładunku (orch SPAWN -> UNLOADED)
+ *   - obłożenie rejsów wg łodzi
+ *   - przepustowość w czasie (zdarzenia na sekundę)
+ *
+ * Użycie: ./trace_analyze [katalog]   (domyślnie $TRACE_DIR albo "trace")
+ ******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "trace.h"
+
+#define MAX_BOAT 1024
+
+static const char *proc_name[] = {"?", "orchestrator", "kasjer", "sternik", "pasazer"};
+static const char *ev_name[TE_MAX] = {
+    "?", "SPAWN", "BUY", "OK", "NO", "QUEUE", "REJECT",
+    "BOARD", "DEPART", "RETURN", "UNLOADED"
+};
+
+static TraceEv *evs;
+static size_t nevs, capevs;
+
+/* Dokłada zdarzenia z jednego pliku. 0 - ok, -1 - to nie ślad. */
+static int load_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if(!f) return -1;
+    TraceHdr h;
+    if(fread(&h, sizeof(h), 1, f)!=1 || h.magic!=TRACE_MAGIC ||
+       h.version!=TRACE_VERSION || h.ev_size!=sizeof(TraceEv)){
+        fclose(f);
+        return -1;
+    }
+    TraceEv e;
+    while(fread(&e, sizeof(e), 1, f)==1){
+        if(e.type==0 || e.type>=TE_MAX) continue;   // niedokończony zapis
+        if(nevs==capevs){
+            capevs = capevs ? capevs*2 : 65536;
+            evs = realloc(evs, capevs*sizeof(TraceEv));
+            if(!evs){
+                fprintf(stderr, "brak pamięci\n");
+                exit(1);
+            }
+        }
+        evs[nevs++] = e;
+    }
+    fclose(f);
+    return 0;
+}
+
+static int cmp_ts(const void *a, const void *b)
+{
+    const TraceEv *x = a, *y = b;
+    return (x->ts_ns > y->ts_ns) - (x->ts_ns < y->ts_ns);
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/* Próbki opóźnień (ns) */
+typedef struct {
+    long long *v;
+    size_t n, cap;
+} Samples;
+
+static void push(Samples *s, long long x)
+{
+    if(s->n==s->cap){
+        s->cap = s->cap ? s->cap*2 : 1024;
+        s->v = realloc(s->v, s->cap*sizeof(long long));
+        if(!s->v) exit(1);
+    }
+    s->v[s->n++] = x;
+}
+
+static void print_lat(const char *label, Samples *s)
+{
+    if(s->n==0){
+        printf("  %-26s brak danych\n", label);
+        return;
+    }
+    qsort(s->v, s->n, sizeof(long long), cmp_ll);
+    double sum = 0;
+    for(size_t i=0; i<s->n; i++) sum += s->v[i];
+    #define PCT(p) (s->v[(size_t)((s->n-1)*(p))]/1e6)
+    printf("  %-26s n=%-6zu avg=%8.1f p50=%8.1f p90=%8.1f p99=%8.1f max=%8.1f ms\n",
+           label, s->n, sum/s->n/1e6, PCT(0.50), PCT(0.90), PCT(0.99), s->v[s->n-1]/1e6);
+    #undef PCT
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = (argc>1) ? argv[1] : getenv("TRACE_DIR");
+    if(!dir || !*dir) dir = "trace";
+
+    DIR *d = opendir(dir);
+    if(!d){
+        perror(dir);
+        return 1;
+    }
+    int nfiles = 0;
+    struct dirent *de;
+    while((de = readdir(d))){
+        size_t l = strlen(de->d_name);
+        if(l<6 || strcmp(de->d_name + l - 6, ".trace")) continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        if(load_file(path)==0) nfiles++;
+    }
+    closedir(d);
+    if(nevs==0){
+        fprintf(stderr, "%s: brak zdarzeń\n", dir);
+        return 1;
+    }
+    qsort(evs, nevs, sizeof(TraceEv), cmp_ts);
+
+    int64_t t0 = evs[0].ts_ns, t1 = evs[nevs-1].ts_ns;
+    printf("Ślad %s: %d plików, %zu zdarzeń, %.2f s\n\n", dir, nfiles, nevs, (t1-t0)/1e9);
+
+    /* 1) liczby zdarzeń */
+    long cnt[5][TE_MAX] = {{0}};
+    int maxpid = 0;
+    for(size_t i=0; i<nevs; i++){
+        if(evs[i].proc<5) cnt[evs[i].proc][evs[i].type]++;
+        if(evs[i].pid > maxpid) maxpid = evs[i].pid;
+    }
+    printf("Zdarzenia:\n  %-13s", "");
+    for(int t=1; t<TE_MAX; t++) printf(" %8s", ev_name[t]);
+    printf("\n");
+    for(int p=1; p<5; p++){
+        printf("  %-13s", proc_name[p]);
+        for(int t=1; t<TE_MAX; t++) printf(" %8ld", cnt[p][t]);
+        printf("\n");
+    }
+
+    /* 2) opóźnienia: ostatni początek per pid (pid może płynąć kilka razy) */
+    int64_t *ts_queue = calloc(maxpid+1, sizeof(int64_t));
+    int64_t *ts_ok    = calloc(maxpid+1, sizeof(int64_t));
+    int64_t *ts_spawn = calloc(maxpid+1, sizeof(int64_t));
+    if(!ts_queue || !ts_ok || !ts_spawn) return 1;
+    Samples wait = {0}, sale = {0}, e2e = {0};
+
+    /* 3) obłożenie rejsów */
+    static long trips[MAX_BOAT], pax[MAX_BOAT], cap[MAX_BOAT];
+
+    /* 4) oś czasu: sekundy od początku */
+    int nsec = (int)((t1 - t0)/1000000000) + 1;
+    long (*tl)[TE_MAX] = calloc(nsec, sizeof(*tl));
+    if(!tl) return 1;
+
+    for(size_t i=0; i<nevs; i++){
+        TraceEv *e = &evs[i];
+        int pid = e->pid;
+        int ok_pid = (pid>0 && pid<=maxpid);
+
+        if(e->proc==TP_ORCH && e->type==TE_SPAWN && ok_pid) ts_spawn[pid] = e->ts_ns;
+        if(e->proc==TP_KASJER && e->type==TE_OK && ok_pid) ts_ok[pid] = e->ts_ns;
+        if(e->proc!=TP_STERNIK){
+            if(e->proc==TP_ORCH || e->proc==TP_KASJER) tl[(e->ts_ns - t0)/1000000000][e->type]++;
+            continue;
+        }
+        tl[(e->ts_ns - t0)/1000000000][e->type]++;
+
+        switch(e->type){
+        case TE_QUEUE:
+            if(ok_pid) ts_queue[pid] = e->ts_ns;
+            break;
+        case TE_BOARD:
+            if(ok_pid && ts_queue[pid]){
+                push(&wait, e->ts_ns - ts_queue[pid]);
+                ts_queue[pid] = 0;
+            }
+            break;
+        case TE_DEPART:
+            if(e->boat>0 && e->boat<MAX_BOAT){
+                trips[e->boat]++;
+                pax[e->boat] += e->a;
+                cap[e->boat] += e->b;
+            }
+            break;
+        case TE_UNLOADED:
+            if(ok_pid && ts_ok[pid]){
+                push(&sale, e->ts_ns - ts_ok[pid]);
+                ts_ok[pid] = 0;
+            }
+            if(ok_pid && ts_spawn[pid]){
+                push(&e2e, e->ts_ns - ts_spawn[pid]);
+                ts_spawn[pid] = 0;
+            }
+            break;
+        }
+    }
+
+    printf("\nOpóźnienia:\n");
+    print_lat("kolejka (QUEUE->BOARD)", &wait);
+    print_lat("sprzedaż->wyładunek", &sale);
+    print_lat("start->wyładunek", &e2e);
+
+    printf("\nRejsy:\n");
+    for(int b=1; b<MAX_BOAT; b++){
+        if(!trips[b]) continue;
+        printf("  łódź %-4d rejsów=%-5ld pasażerów=%-6ld średnio=%5.1f obłożenie=%5.1f%%\n",
+               b, trips[b], pax[b], (double)pax[b]/trips[b],
+               cap[b] ? 100.0*pax[b]/cap[b] : 0.0);
+    }
+
+    printf("\nPrzepustowość (na sekundę):\n  %5s %7s %7s %7s %7s %7s %7s %7s\n",
+           "t[s]", "SPAWN", "OK", "QUEUE", "BOARD", "DEPART", "UNLOAD", "REJECT");
+    for(int s=0; s<nsec; s++){
+        printf("  %5d %7ld %7ld %7ld %7ld %7ld %7ld %7ld\n", s,
+               tl[s][TE_SPAWN], tl[s][TE_OK], tl[s][TE_QUEUE], tl[s][TE_BOARD],
+               tl[s][TE_DEPART], tl[s][TE_UNLOADED], tl[s][TE_REJECT]);
+    }
+
+    free(ts_queue); free(ts_ok); free(ts_spawn); free(tl); free(evs);
+    free(wait.v); free(sale.v); free(e2e.v);
+    return 0;
+}